@@ -6,6 +6,12 @@
  * dependent on compiler optimizer settings.
  */
 
+// Set to 1 to measure the 8-bit resume index backend of the coroutines
+// instead of the computed goto.
+#if ! defined(ACE_ROUTINE_RESUME_INDEX)
+  #define ACE_ROUTINE_RESUME_INDEX 0
+#endif
+
 #include <Arduino.h>
 #include <AceRoutine.h>
 #include <AceCommon.h> // printPad3To()
@@ -24,6 +30,20 @@ using ace_common::printPad3To;
 	const uint32_t NUM_ITERATIONS = 30000;
 #endif
 
+// Numbers of sleeping coroutines used by the PolledSleepers and QueuedSleepers
+// benchmarks, to show how their cost grows with the number of sleepers. The
+// SnapshotSleepers and UsageSleepers benchmarks use the largest one. Each
+// count needs its own set of coroutines, so they are kept small on AVR.
+#if defined(ARDUINO_ARCH_AVR)
+	const uint16_t NUM_SLEEPERS_SMALL = 2;
+	const uint16_t NUM_SLEEPERS_MEDIUM = 5;
+	const uint16_t NUM_SLEEPERS = 20;
+#else
+	const uint16_t NUM_SLEEPERS_SMALL = 10;
+	const uint16_t NUM_SLEEPERS_MEDIUM = 30;
+	const uint16_t NUM_SLEEPERS = 100;
+#endif
+
 #if ! defined(SERIAL_PORT_MONITOR)
 	#define SERIAL_PORT_MONITOR Serial
 #endif
@@ -44,6 +64,98 @@ COROUTINE(counterB) {
   }
 }
 
+// The ClockInterface, with a distinct type for each number of sleepers, so
+// that each count gets its own Coroutine type and list of coroutines.
+template <uint16_t N>
+class SleeperClock : public ClockInterface {};
+
+// Two separate families of Coroutine types, to compare the polling and the
+// queued modes of the CoroutineScheduler with N coroutines which never wake up
+// during the benchmark.
+template <uint16_t N>
+using PolledCoroutine = CoroutineTemplate<
+    Coroutine_Delay_32bit_Impl<UnnamedCoroutine, SleeperClock<N>>>;
+
+template <uint16_t N>
+using PolledScheduler = CoroutineSchedulerTemplate<PolledCoroutine<N>>;
+
+template <uint16_t N>
+using QueuedCoroutine = CoroutineTemplate<Coroutine_Delay_32bit_Impl<
+    Coroutine_Queue_Impl<UnnamedCoroutine>, SleeperClock<N>>>;
+
+template <uint16_t N>
+using QueuedScheduler = CoroutineSchedulerTemplate<QueuedCoroutine<N>>;
+
+// Same as PolledCoroutine, but the clock is read once per pass of the
+// scheduler instead of once per sleeping coroutine.
+using SnapshotCoroutine = CoroutineTemplate<Coroutine_Delay_32bit_Impl<
+    UnnamedCoroutine, SnapshotClockInterface<ClockInterface>>>;
+using SnapshotScheduler = CoroutineSchedulerTemplate<SnapshotCoroutine>;
+
+// Same as PolledCoroutine, but the scheduler counts the dispatches and the
+// busy cycles of each coroutine.
+using UsageCoroutine = CoroutineTemplate<Coroutine_Delay_32bit_Impl<
+    Coroutine_Usage_Impl<UnnamedCoroutine>, ClockInterface>>;
+using UsageScheduler = CoroutineSchedulerTemplate<UsageCoroutine>;
+
+template <typename T_COROUTINE>
+class Counter : public T_COROUTINE {
+  public:
+    int runCoroutine() override {
+      COROUTINE_LOOP() {
+        counter++;
+        COROUTINE_YIELD();
+      }
+    }
+};
+
+template <typename T_COROUTINE>
+class Sleeper : public T_COROUTINE {
+  public:
+    int runCoroutine() override {
+      COROUTINE_LOOP() {
+        COROUTINE_DELAY_SECONDS(1000);
+      }
+    }
+};
+
+// N sleepers and the 2 counters, in the list of T_COROUTINE.
+template <typename T_COROUTINE, uint16_t N>
+class SleeperSet {
+  public:
+    Sleeper<T_COROUTINE> sleepers[N];
+    Counter<T_COROUTINE> counterA;
+    Counter<T_COROUTINE> counterB;
+};
+
+SleeperSet<PolledCoroutine<NUM_SLEEPERS_SMALL>, NUM_SLEEPERS_SMALL>
+    polledSmallSet;
+SleeperSet<PolledCoroutine<NUM_SLEEPERS_MEDIUM>, NUM_SLEEPERS_MEDIUM>
+    polledMediumSet;
+SleeperSet<PolledCoroutine<NUM_SLEEPERS>, NUM_SLEEPERS> polledSet;
+
+SleeperSet<QueuedCoroutine<NUM_SLEEPERS_SMALL>, NUM_SLEEPERS_SMALL>
+    queuedSmallSet;
+SleeperSet<QueuedCoroutine<NUM_SLEEPERS_MEDIUM>, NUM_SLEEPERS_MEDIUM>
+    queuedMediumSet;
+SleeperSet<QueuedCoroutine<NUM_SLEEPERS>, NUM_SLEEPERS> queuedSet;
+
+Sleeper<SnapshotCoroutine> snapshotSleepers[NUM_SLEEPERS];
+Counter<SnapshotCoroutine> snapshotCounterA;
+Counter<SnapshotCoroutine> snapshotCounterB;
+
+Sleeper<UsageCoroutine> usageSleepers[NUM_SLEEPERS];
+Counter<UsageCoroutine> usageCounterA;
+Counter<UsageCoroutine> usageCounterB;
+
+// The 2 counters of the StaticScheduling benchmark. They use their own
+// Coroutine type so that they are not also in the list of the
+// CoroutineScheduler.
+using StaticCoroutine = CoroutineTemplate<
+    Coroutine_Delay_16bit_Impl<NamedCoroutine, ClockInterface>>;
+StaticScheduler<Counter<StaticCoroutine>, Counter<StaticCoroutine>>
+    staticScheduler;
+
 void checkEqual(
     const __FlashStringHelper* msg, uint32_t expected, uint32_t observed) {
   if (expected != observed) {
@@ -99,6 +211,67 @@ uint16_t doCoroutineScheduling(uint32_t iterations) {
   return end - start;
 }
 
+uint16_t doStaticScheduling(uint32_t iterations) {
+  yield();
+  counter = 0;
+  uint16_t start = millis();
+
+  // Run for 1/2 as many iterations because each pass calls 2 coroutines.
+  for (uint32_t i = 0; i < iterations / 2; i++) {
+    staticScheduler.loop();
+  }
+  uint16_t end = millis();
+  yield();
+  checkEqual(F("doStaticScheduling()"), counter, iterations);
+  return end - start;
+}
+
+uint16_t doRunAllScheduling(uint32_t iterations) {
+  yield();
+  counter = 0;
+  uint16_t start = millis();
+
+  // Run for 1/2 as many iterations because each pass calls 2 coroutines.
+  for (uint32_t i = 0; i < iterations / 2; i++) {
+    CoroutineScheduler::runAll();
+  }
+  uint16_t end = millis();
+  yield();
+  checkEqual(F("doRunAllScheduling()"), counter, iterations);
+  return end - start;
+}
+
+// The last call to runFor() may overshoot 'iterations' by up to 100 micros,
+// which is small compared to the total duration of the benchmark.
+uint16_t doRunForScheduling(uint32_t iterations) {
+  yield();
+  counter = 0;
+  uint16_t start = millis();
+  while (counter < iterations) {
+    CoroutineScheduler::runFor(100);
+  }
+  uint16_t end = millis();
+  yield();
+  return end - start;
+}
+
+// Run the scheduler until the 2 counters have been incremented 'iterations'
+// times in total, so that the time per iteration includes the cost of stepping
+// over the sleeping coroutines.
+template <typename T_SCHEDULER>
+uint16_t doSleeperScheduling(uint32_t iterations) {
+  yield();
+  counter = 0;
+  uint16_t start = millis();
+  while (counter < iterations) {
+    T_SCHEDULER::loop();
+  }
+  uint16_t end = millis();
+  yield();
+  checkEqual(F("doSleeperScheduling()"), counter, iterations);
+  return end - start;
+}
+
 void printNanosAsMicros(Print& printer, uint16_t nanos) {
   uint16_t wholeMicros = nanos / 1000;
   uint16_t fracMicros = nanos - wholeMicros * 1000;
@@ -108,11 +281,10 @@ void printNanosAsMicros(Print& printer, uint16_t nanos) {
 }
 
 // Print millis 'ms' as micros (to 3 decimal places) per iteration as a floating
-// point number. The number of 'iterations' must be divisible by 1000.
-void printStats(
-    const __FlashStringHelper* name, uint16_t ms, uint32_t iterations) {
+// point number, and the number of iterations, after the name. The number of
+// 'iterations' must be divisible by 1000.
+void printStatsValues(uint16_t ms, uint32_t iterations) {
   uint16_t nanosPerIteration = (uint32_t) ms * 1000 / (iterations / 1000);
-  SERIAL_PORT_MONITOR.print(name);
   SERIAL_PORT_MONITOR.print(' ');
   printNanosAsMicros(SERIAL_PORT_MONITOR, nanosPerIteration);
   SERIAL_PORT_MONITOR.print(' ');
@@ -120,6 +292,30 @@ void printStats(
   SERIAL_PORT_MONITOR.println();
 }
 
+void printStats(
+    const __FlashStringHelper* name, uint16_t ms, uint32_t iterations) {
+  SERIAL_PORT_MONITOR.print(name);
+  printStatsValues(ms, iterations);
+}
+
+// Same as printStats(), with the number of sleepers appended to the name,
+// e.g. "PolledSleepers/100".
+void printSleeperStats(const __FlashStringHelper* name, uint16_t numSleepers,
+    uint16_t ms, uint32_t iterations) {
+  SERIAL_PORT_MONITOR.print(name);
+  SERIAL_PORT_MONITOR.print('/');
+  SERIAL_PORT_MONITOR.print(numSleepers);
+  printStatsValues(ms, iterations);
+}
+
+// Run the sleeper benchmark of T_SCHEDULER, and print it.
+template <typename T_SCHEDULER>
+void runSleeperBenchmark(
+    const __FlashStringHelper* name, uint16_t numSleepers) {
+  uint16_t elapsedMillis = doSleeperScheduling<T_SCHEDULER>(NUM_ITERATIONS);
+  printSleeperStats(name, numSleepers, elapsedMillis, NUM_ITERATIONS);
+}
+
 void setup() {
 #if ! defined(EPOXY_DUINO)
   delay(1000);
@@ -137,8 +333,20 @@ void setup() {
   SERIAL_PORT_MONITOR.print(F("sizeof(Channel<int>): "));
   SERIAL_PORT_MONITOR.println(sizeof(Channel<int>));
 
+  SERIAL_PORT_MONITOR.print(F("sizeof(QueuedCoroutine): "));
+  SERIAL_PORT_MONITOR.println(sizeof(QueuedCoroutine<NUM_SLEEPERS>));
+
   CoroutineScheduler::setup();
   //CoroutineScheduler::list(SERIAL_PORT_MONITOR);
+  PolledScheduler<NUM_SLEEPERS_SMALL>::setup();
+  PolledScheduler<NUM_SLEEPERS_MEDIUM>::setup();
+  PolledScheduler<NUM_SLEEPERS>::setup();
+  QueuedScheduler<NUM_SLEEPERS_SMALL>::setup();
+  QueuedScheduler<NUM_SLEEPERS_MEDIUM>::setup();
+  QueuedScheduler<NUM_SLEEPERS>::setup();
+  SnapshotScheduler::setup();
+  UsageScheduler::setup();
+  staticScheduler.setupCoroutines();
 
   SERIAL_PORT_MONITOR.println(F("BENCHMARKS"));
 
@@ -151,6 +359,32 @@ void setup() {
   uint16_t schedulerMillis = doCoroutineScheduling(NUM_ITERATIONS);
   printStats(F("CoroutineScheduling"), schedulerMillis, NUM_ITERATIONS);
 
+  uint16_t staticMillis = doStaticScheduling(NUM_ITERATIONS);
+  printStats(F("StaticScheduling"), staticMillis, NUM_ITERATIONS);
+
+  uint16_t runAllMillis = doRunAllScheduling(NUM_ITERATIONS);
+  printStats(F("CoroutineRunAll"), runAllMillis, NUM_ITERATIONS);
+
+  uint16_t runForMillis = doRunForScheduling(NUM_ITERATIONS);
+  printStats(F("CoroutineRunFor"), runForMillis, NUM_ITERATIONS);
+
+  runSleeperBenchmark<PolledScheduler<NUM_SLEEPERS_SMALL>>(
+      F("PolledSleepers"), NUM_SLEEPERS_SMALL);
+  runSleeperBenchmark<PolledScheduler<NUM_SLEEPERS_MEDIUM>>(
+      F("PolledSleepers"), NUM_SLEEPERS_MEDIUM);
+  runSleeperBenchmark<PolledScheduler<NUM_SLEEPERS>>(
+      F("PolledSleepers"), NUM_SLEEPERS);
+
+  runSleeperBenchmark<SnapshotScheduler>(F("SnapshotSleepers"), NUM_SLEEPERS);
+  runSleeperBenchmark<UsageScheduler>(F("UsageSleepers"), NUM_SLEEPERS);
+
+  runSleeperBenchmark<QueuedScheduler<NUM_SLEEPERS_SMALL>>(
+      F("QueuedSleepers"), NUM_SLEEPERS_SMALL);
+  runSleeperBenchmark<QueuedScheduler<NUM_SLEEPERS_MEDIUM>>(
+      F("QueuedSleepers"), NUM_SLEEPERS_MEDIUM);
+  runSleeperBenchmark<QueuedScheduler<NUM_SLEEPERS>>(
+      F("QueuedSleepers"), NUM_SLEEPERS);
+
   SERIAL_PORT_MONITOR.println(F("END"));
 
 #if defined(EPOXY_DUINO)
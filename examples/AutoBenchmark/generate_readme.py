@@ -36,6 +36,35 @@ a baseline. This is represented by the `base` column.
 The difference between the 2 benchmarks (represented by the `diff` column below)
 is the overhead caused by the `Coroutine` context switch.
 
+The `StaticScheduling` benchmark runs 2 identical counter coroutines through a
+`StaticScheduler`, whose `loop()` is unrolled at compile time into direct calls
+to each `runCoroutine()`. It should be close to `DirectScheduling`, without
+the virtual dispatch and the linked list traversal of `CoroutineScheduling`.
+
+The `CoroutineRunAll` and `CoroutineRunFor` benchmarks perform the same context
+switches as `CoroutineScheduling`, but through `CoroutineScheduler::runAll()`
+and `CoroutineScheduler::runFor(100)` instead of `CoroutineScheduler::loop()`,
+to show how much of the per-coroutine overhead is amortized.
+
+The `PolledSleepers/N` and `QueuedSleepers/N` benchmarks add N coroutines
+which sit in a long `COROUTINE_DELAY()`. Each one runs with 3 values of N (2, 5
+and 20 on AVR, 10, 30 and 100 on others), to show how the cost grows with the
+number of sleepers. The `PolledSleepers` benchmark uses the normal round-robin
+scheduling which calls `runCoroutine()` on each sleeping coroutine, so its cost
+grows linearly with N. The `QueuedSleepers` benchmark uses a Coroutine type
+with the `Coroutine_Queue_Impl` layer, so that the `CoroutineScheduler` keeps
+the sleepers in its `SleepQueue` and never visits them until they wake up, so
+its cost stays flat. The `SnapshotSleepers` benchmark is the same as the
+largest `PolledSleepers`, but uses a `SnapshotClockInterface`, so that the
+sleepers share one reading of `micros()` per pass instead of calling it each.
+The `UsageSleepers` benchmark is the same as the largest `PolledSleepers`, with
+the `Coroutine_Usage_Impl` layer, which reads `cycles()` at the start and at the
+end of each dispatch to count the busy cycles of each coroutine.
+
+The benchmarks use the computed goto to resume the coroutines. To measure the
+8-bit resume index instead, set `ACE_ROUTINE_RESUME_INDEX` to 1 at the top of
+`AutoBenchmark.ino`.
+
 All times in below are in microseconds.
 
 **Version**: AceRoutine v1.4.2
@@ -144,6 +173,24 @@ $ make README.md
         * ESP8266 Core from 2.7.4 to 3.0.2
         * ESP32 Core from 1.0.6 to 2.0.2
         * Teensyduino from 1.54 to 1.56
+* Unreleased
+    * Add `PolledSleepers` and `QueuedSleepers` benchmarks.
+        * Measures the cost of the sleeping coroutines in the normal and queued
+          scheduling modes of `CoroutineScheduler`.
+    * Add `CoroutineRunAll` and `CoroutineRunFor` benchmarks.
+    * Add `StaticScheduling` benchmark.
+        * Measures the devirtualized `StaticScheduler` next to
+          `DirectScheduling` and `CoroutineScheduling`.
+    * Add `SnapshotSleepers` benchmark.
+        * Measures the saving of a `SnapshotClockInterface` over
+          `PolledSleepers`.
+    * Add the `ACE_ROUTINE_RESUME_INDEX` option to `AutoBenchmark.ino`.
+    * Add `UsageSleepers` benchmark.
+        * Measures the cost of the usage counters of `Coroutine_Usage_Impl`
+          over `PolledSleepers`.
+    * Run `PolledSleepers` and `QueuedSleepers` with 3 numbers of sleepers.
+        * Shows that the cost of the queued mode does not grow with the number
+          of sleepers.
 
 ## Arduino Nano
 
@@ -59,16 +59,16 @@ END {
   print ""
   print "CPU:"
 
-  printf("+---------------------+--------+-------------+--------+\n")
-  printf("| Functionality       |  iters | micros/iter |   diff |\n")
+  printf("+-----------------------+--------+-------------+--------+\n")
+  printf("| Functionality         |  iters | micros/iter |   diff |\n")
   for (i = 0; i < TOTAL_BENCHMARKS; i++) {
     name = u[i]["name"]
     if (name ~ /^EmptyLoop$/ || name ~ /^DirectScheduler$/){
-      printf("|---------------------+--------+-------------+--------|\n")
+      printf("|-----------------------+--------+-------------+--------|\n")
     }
 
-    printf("| %-19s | %6d | %11.3f | %6.3f |\n",
+    printf("| %-21s | %6d | %11.3f | %6.3f |\n",
       u[i]["name"], u[i]["iterations"], u[i]["micros"], u[i]["diff"])
   }
-  printf("+---------------------+--------+-------------+--------+\n")
+  printf("+-----------------------+--------+-------------+--------+\n")
 }
@@ -12,6 +12,14 @@
  * programming, the yield() call cause additional latency of a Channel because
  * the synchronization provided by the Channel causes additional loops through
  * the Coroutine::loop() method, which causes additional calls to yield().
+ *
+ * The Generator benchmark moves the same payloads from a Generator to a reader
+ * coroutine which pulls one value on each run using Generator::next(),
+ * without a Channel handshake and without a scheduler pass for the writer.
+ *
+ * The PolledIdle and QueuedIdle benchmarks measure the cost of NUM_IDLE_READERS
+ * coroutines blocked in COROUTINE_CHANNEL_READ() on channels which are never
+ * written, with the polling and the queued CoroutineScheduler.
  */
 
 #include <stdint.h> // uint32_t
@@ -41,6 +49,14 @@ using ace_common::printUint32AsFloat3To;
   const uint32_t NUM_COUNT = 300000;
 #endif
 
+// Number of readers blocked on an empty channel, in the PolledIdle and
+// QueuedIdle benchmarks.
+#if defined(ARDUINO_ARCH_AVR)
+  const uint16_t NUM_IDLE_READERS = 20;
+#else
+  const uint16_t NUM_IDLE_READERS = 100;
+#endif
+
 static volatile uint32_t counter = 0;
 static volatile uint32_t writeCounter = 0;
 static volatile uint32_t readCounter = 0;
@@ -99,14 +115,97 @@ class ReadCoroutine: public Coroutine {
 
 ReadCoroutine readCoroutine(channel);
 
+// A generator of the same payloads as the WriteCoroutine.
+class WriteGenerator: public Generator<uint32_t> {
+  public:
+    int runCoroutine() override {
+      COROUTINE_LOOP() {
+        writeCounter++;
+        COROUTINE_YIELD_VALUE(writeCounter);
+      }
+    }
+};
+
+WriteGenerator writeGenerator;
+
+// A class that pulls one value from a generator on each run.
+class PullCoroutine: public Coroutine {
+  public:
+    PullCoroutine(Generator<uint32_t>& generator):
+        mGenerator(generator)
+        {}
+
+    int runCoroutine() override {
+      COROUTINE_LOOP() {
+        readCounter++;
+        uint32_t payload;
+        mGenerator.next(payload);
+        readPayload = payload;
+        COROUTINE_YIELD();
+      }
+    }
+
+  private:
+    Generator<uint32_t>& mGenerator;
+};
+
+PullCoroutine pullCoroutine(writeGenerator);
+
+//-----------------------------------------------------------------------------
+
+// Separate Coroutine types for the idle reader benchmarks, so that their
+// coroutines do not slow down the other benchmarks. The QueuedCoroutine moves
+// the blocked readers into the wait list of their Channel.
+using PolledCoroutine = CoroutineTemplate<
+    Coroutine_Delay_32bit_Impl<UnnamedCoroutine, ClockInterface>>;
+using PolledScheduler = CoroutineSchedulerTemplate<PolledCoroutine>;
+
+using QueuedCoroutine = CoroutineTemplate<Coroutine_Delay_32bit_Impl<
+    Coroutine_Queue_Impl<UnnamedCoroutine>, ClockInterface>>;
+using QueuedScheduler = CoroutineSchedulerTemplate<QueuedCoroutine>;
+
+template <typename T_COROUTINE>
+class IdleCounter : public T_COROUTINE {
+  public:
+    int runCoroutine() override {
+      COROUTINE_LOOP() {
+        counter++;
+        COROUTINE_YIELD();
+      }
+    }
+};
+
+// A reader of a channel which is never written.
+template <typename T_COROUTINE>
+class IdleReader : public T_COROUTINE {
+  public:
+    int runCoroutine() override {
+      COROUTINE_LOOP() {
+        COROUTINE_CHANNEL_READ(mChannel, mPayload);
+        readPayload = mPayload;
+      }
+    }
+
+  private:
+    Channel<uint32_t, T_COROUTINE> mChannel;
+    uint32_t mPayload;
+};
+
+IdleReader<PolledCoroutine> polledIdleReaders[NUM_IDLE_READERS];
+IdleCounter<PolledCoroutine> polledIdleCounter;
+
+IdleReader<QueuedCoroutine> queuedIdleReaders[NUM_IDLE_READERS];
+IdleCounter<QueuedCoroutine> queuedIdleCounter;
+
 //-----------------------------------------------------------------------------
 
 // Determine time taken by just the counter.
 uint32_t benchmarkCountCoroutine() {
-  // Disable the channel writer and reader.
+  // Disable the channel writer and reader, and the generator reader.
   countCoroutine.resume();
   writeCoroutine.suspend();
   readCoroutine.suspend();
+  pullCoroutine.suspend();
 
   counter = writeCounter = readCounter = 0;
   yield();
@@ -124,6 +223,7 @@ uint32_t benchmarkReadWriteChannels() {
   countCoroutine.resume();
   writeCoroutine.resume();
   readCoroutine.resume();
+  pullCoroutine.suspend();
 
   counter = writeCounter = readCounter = 0;
   yield();
@@ -136,6 +236,39 @@ uint32_t benchmarkReadWriteChannels() {
   return elapsedMillis;
 }
 
+// Determine time taken by adding the coroutine which pulls from the generator.
+uint32_t benchmarkGenerator() {
+  countCoroutine.resume();
+  writeCoroutine.suspend();
+  readCoroutine.suspend();
+  pullCoroutine.resume();
+
+  counter = writeCounter = readCounter = 0;
+  yield();
+  uint32_t startMillis = millis();
+  while (counter < NUM_COUNT) {
+    CoroutineScheduler::loop();
+  }
+  uint32_t elapsedMillis = millis() - startMillis;
+  yield();
+  return elapsedMillis;
+}
+
+// Determine time taken by the counter, with NUM_IDLE_READERS readers blocked on
+// their channels.
+template <typename T_SCHEDULER>
+uint32_t benchmarkIdleReaders() {
+  counter = writeCounter = readCounter = 0;
+  yield();
+  uint32_t startMillis = millis();
+  while (counter < NUM_COUNT) {
+    T_SCHEDULER::loop();
+  }
+  uint32_t elapsedMillis = millis() - startMillis;
+  yield();
+  return elapsedMillis;
+}
+
 void printStats(
     const __FlashStringHelper* name,
     uint32_t durationMillis,
@@ -165,6 +298,8 @@ void setup() {
   while (!Serial); // Leonardo/Micro
 
   CoroutineScheduler::setup();
+  PolledScheduler::setup();
+  QueuedScheduler::setup();
 
   SERIAL_PORT_MONITOR.println(F("BENCHMARKS"));
 
@@ -176,6 +311,18 @@ void setup() {
   printStats(F("Channels"), durationMillis, NUM_COUNT,
       writeCounter, readCounter);
 
+  durationMillis = benchmarkGenerator();
+  printStats(F("Generator"), durationMillis, NUM_COUNT,
+      writeCounter, readCounter);
+
+  durationMillis = benchmarkIdleReaders<PolledScheduler>();
+  printStats(F("PolledIdle"), durationMillis, NUM_COUNT,
+      writeCounter, readCounter);
+
+  durationMillis = benchmarkIdleReaders<QueuedScheduler>();
+  printStats(F("QueuedIdle"), durationMillis, NUM_COUNT,
+      writeCounter, readCounter);
+
   SERIAL_PORT_MONITOR.println(F("END"));
 
 #if defined(EPOXY_DUINO)
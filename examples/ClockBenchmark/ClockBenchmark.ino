@@ -0,0 +1,123 @@
+/*
+ * This sketch measures the cost of reading the cycles() of each ClockInterface
+ * which can be given as the T_CLOCK of Coroutine_Delay_32bit_Profiler_Impl,
+ * which is paid twice per dispatch of a profiled coroutine:
+ *
+ *  * ClockInterface: micros()
+ *  * MonotonicRawClockInterface: clock_gettime(CLOCK_MONOTONIC_RAW)
+ *  * TscClockInterface: rdtsc, x86 only
+ *
+ * It prints the number of reads, the cost of one read in nanoseconds, the
+ * resolution (the smallest non-zero difference between 2 consecutive reads)
+ * in nanoseconds, and the cycles_per_second() of the clock. The cost is
+ * measured with clock_gettime(CLOCK_MONOTONIC), so this sketch runs only on
+ * EpoxyDuino under Linux.
+ */
+
+#include <Arduino.h>
+#include <AceRoutine.h>
+using namespace ace_routine;
+
+#if ! defined(SERIAL_PORT_MONITOR)
+  #define SERIAL_PORT_MONITOR Serial
+#endif
+
+#if defined(EPOXY_DUINO) && defined(__linux__)
+
+#include <time.h> // clock_gettime()
+
+const uint32_t NUM_READS = 10000000;
+
+volatile unsigned long sink;
+
+uint64_t nowNanos() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Return the elapsed nanoseconds of NUM_READS calls to T_CLOCK::cycles().
+template <typename T_CLOCK>
+uint64_t measureReads() {
+  unsigned long sum = 0;
+  uint64_t startNanos = nowNanos();
+  for (uint32_t i = 0; i < NUM_READS; i++) {
+    sum += T_CLOCK::cycles();
+  }
+  uint64_t elapsedNanos = nowNanos() - startNanos;
+  sink = sum;
+  return elapsedNanos;
+}
+
+// Return the smallest non-zero difference between 2 consecutive reads, in
+// cycles.
+template <typename T_CLOCK>
+unsigned long measureResolution() {
+  unsigned long smallest = 0;
+  unsigned long previous = T_CLOCK::cycles();
+  for (uint32_t i = 0; i < NUM_READS / 10; i++) {
+    unsigned long now = T_CLOCK::cycles();
+    unsigned long delta = now - previous;
+    if (delta != 0 && (smallest == 0 || delta < smallest)) smallest = delta;
+    previous = now;
+  }
+  return smallest;
+}
+
+// Print a uint64_t, which Print does not support.
+void printUint64(uint64_t n) {
+  if (n >= 10) printUint64(n / 10);
+  SERIAL_PORT_MONITOR.print((char) ('0' + n % 10));
+}
+
+template <typename T_CLOCK>
+void runBenchmark(const __FlashStringHelper* name) {
+  // Calibrate before the measurement.
+  uint64_t hz = T_CLOCK::cycles_per_second();
+  uint64_t elapsedNanos = measureReads<T_CLOCK>();
+  unsigned long resolution = measureResolution<T_CLOCK>();
+
+  SERIAL_PORT_MONITOR.print(name);
+  SERIAL_PORT_MONITOR.print(' ');
+  SERIAL_PORT_MONITOR.print(NUM_READS);
+  SERIAL_PORT_MONITOR.print(' ');
+  SERIAL_PORT_MONITOR.print((float) elapsedNanos / NUM_READS, 1);
+  SERIAL_PORT_MONITOR.print(' ');
+  SERIAL_PORT_MONITOR.print((float) resolution * 1e9f / hz, 1);
+  SERIAL_PORT_MONITOR.print(' ');
+  printUint64(hz);
+  SERIAL_PORT_MONITOR.println();
+}
+
+void setup() {
+  SERIAL_PORT_MONITOR.begin(115200);
+  while (!SERIAL_PORT_MONITOR); // Leonardo/Micro
+
+  SERIAL_PORT_MONITOR.println(F("BENCHMARKS"));
+  SERIAL_PORT_MONITOR.println(
+      F("name reads nanos_per_read resolution_nanos cycles_per_second"));
+  runBenchmark<ClockInterface>(F("ClockInterface"));
+#if ACE_ROUTINE_MONOTONIC_RAW_CLOCK
+  runBenchmark<MonotonicRawClockInterface>(F("MonotonicRawClockInterface"));
+#endif
+#if ACE_ROUTINE_TSC_CLOCK
+  runBenchmark<TscClockInterface>(F("TscClockInterface"));
+#endif
+  SERIAL_PORT_MONITOR.println(F("END"));
+
+  exit(0);
+}
+
+#else
+
+void setup() {
+  SERIAL_PORT_MONITOR.begin(115200);
+  while (!SERIAL_PORT_MONITOR); // Leonardo/Micro
+
+  SERIAL_PORT_MONITOR.println(F("ClockBenchmark requires EpoxyDuino on Linux"));
+}
+
+#endif
+
+void loop() {
+}
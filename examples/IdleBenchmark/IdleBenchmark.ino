@@ -0,0 +1,132 @@
+/*
+ * This sketch measures the CPU time consumed by the CoroutineScheduler over a
+ * fixed wall-clock window, for a set of coroutines which spend most of their
+ * time in COROUTINE_DELAY(). It runs the same window twice:
+ *
+ *  * Busy: the scheduler spins, calling loop() continuously.
+ *  * Tickless: an idle hook installed with CoroutineScheduler::setIdleHook()
+ *    sleeps until the next wake time whenever no coroutine is runnable.
+ *
+ * The CPU time is available only on EpoxyDuino (Linux or MacOS), through
+ * clock_gettime(CLOCK_PROCESS_CPUTIME_ID). On microcontrollers, the idle hook
+ * simply calls delayMicroseconds(), which does not save power, so only the
+ * number of loop() iterations is printed as a proxy.
+ */
+
+#include <Arduino.h>
+#include <AceRoutine.h>
+#if defined(EPOXY_DUINO)
+  #include <time.h> // nanosleep(), clock_gettime()
+#endif
+using namespace ace_routine;
+
+#if ! defined(SERIAL_PORT_MONITOR)
+  #define SERIAL_PORT_MONITOR Serial
+#endif
+
+// Duration of each measurement window.
+const uint16_t WINDOW_MILLIS = 2000;
+
+// Number of mostly-idle coroutines.
+const uint8_t NUM_COROUTINES = 10;
+
+using IdleCoroutine = CoroutineTemplate<Coroutine_Delay_32bit_Impl<
+    Coroutine_Queue_Impl<UnnamedCoroutine>, ClockInterface>>;
+using IdleScheduler = CoroutineSchedulerTemplate<IdleCoroutine>;
+
+uint32_t wakeCount = 0;
+
+// Each coroutine wakes up every 10, 20, ..., 100 millis, does a trivial amount
+// of work, then goes back to sleep.
+class Ticker : public IdleCoroutine {
+  public:
+    int runCoroutine() override {
+      COROUTINE_LOOP() {
+        wakeCount++;
+        COROUTINE_DELAY(mPeriodMillis);
+      }
+    }
+
+    uint16_t mPeriodMillis;
+};
+
+Ticker tickers[NUM_COROUTINES];
+
+// Sleep until the wake time of the next coroutine.
+void sleepUntil(uint32_t wakeMicros) {
+  int32_t sleepMicros = (int32_t) (wakeMicros - micros());
+  if (sleepMicros <= 0) return;
+
+#if defined(EPOXY_DUINO)
+  struct timespec duration;
+  duration.tv_sec = sleepMicros / 1000000;
+  duration.tv_nsec = (sleepMicros % 1000000) * 1000;
+  nanosleep(&duration, nullptr);
+#else
+  // On a real microcontroller, this would enter a sleep mode and set up a
+  // timer interrupt to wake up at 'wakeMicros'.
+  delayMicroseconds(sleepMicros);
+#endif
+}
+
+// Return the CPU time consumed by this process, or 0 if unknown.
+uint32_t cpuMicros() {
+#if defined(EPOXY_DUINO)
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (uint32_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#else
+  return 0;
+#endif
+}
+
+void runWindow(const __FlashStringHelper* name,
+    IdleScheduler::IdleHook idleHook) {
+  IdleScheduler::setIdleHook(idleHook);
+  wakeCount = 0;
+  uint32_t loopCount = 0;
+
+  uint32_t startCpuMicros = cpuMicros();
+  uint16_t startMillis = millis();
+  while ((uint16_t) ((uint16_t) millis() - startMillis) < WINDOW_MILLIS) {
+    IdleScheduler::loop();
+    loopCount++;
+  }
+  uint32_t elapsedCpuMicros = cpuMicros() - startCpuMicros;
+
+  SERIAL_PORT_MONITOR.print(name);
+  SERIAL_PORT_MONITOR.print(' ');
+  SERIAL_PORT_MONITOR.print(elapsedCpuMicros);
+  SERIAL_PORT_MONITOR.print(' ');
+  SERIAL_PORT_MONITOR.print(wakeCount);
+  SERIAL_PORT_MONITOR.print(' ');
+  SERIAL_PORT_MONITOR.print(loopCount);
+  SERIAL_PORT_MONITOR.println();
+}
+
+void setup() {
+#if ! defined(EPOXY_DUINO)
+  delay(1000);
+#endif
+
+  SERIAL_PORT_MONITOR.begin(115200);
+  while (!SERIAL_PORT_MONITOR); // Leonardo/Micro
+
+  for (uint8_t i = 0; i < NUM_COROUTINES; i++) {
+    tickers[i].mPeriodMillis = (i + 1) * 10;
+  }
+  IdleScheduler::setup();
+
+  SERIAL_PORT_MONITOR.println(F("BENCHMARKS"));
+  SERIAL_PORT_MONITOR.println(F("name cpu_micros wakes loops"));
+  runWindow(F("Busy"), nullptr);
+  runWindow(F("Tickless"), sleepUntil);
+  SERIAL_PORT_MONITOR.println(F("END"));
+
+#if defined(EPOXY_DUINO)
+  exit(0);
+#endif
+}
+
+void loop() {
+}
@@ -36,6 +36,22 @@
 #define FEATURE_SCHEDULER_MANUAL_SETUP_TWO_COROUTINES 18
 #define FEATURE_BLINK_FUNCTION 19
 #define FEATURE_BLINK_COROUTINE 20
+#define FEATURE_SCHEDULER_ONE_COROUTINE_INDEX 21
+#define FEATURE_SCHEDULER_TWO_COROUTINES_INDEX 22
+#define FEATURE_SCHEDULER_ONE_COROUTINE_COMPACT 23
+#define FEATURE_SCHEDULER_TWO_COROUTINES_COMPACT 24
+#define FEATURE_SCHEDULER_ONE_COROUTINE_32BIT 25
+#define FEATURE_SCHEDULER_TWO_COROUTINES_32BIT 26
+#define FEATURE_SCHEDULER_ONE_COROUTINE_PROFILER 27
+#define FEATURE_SCHEDULER_TWO_COROUTINES_PROFILER 28
+#define FEATURE_SCHEDULER_ONE_COROUTINE_HISTOGRAM 29
+#define FEATURE_SCHEDULER_ONE_COROUTINE_HISTOGRAM16 30
+
+// Select the 8-bit resume index backend instead of the computed goto.
+#if FEATURE == FEATURE_SCHEDULER_ONE_COROUTINE_INDEX \
+    || FEATURE == FEATURE_SCHEDULER_TWO_COROUTINES_INDEX
+  #define ACE_ROUTINE_RESUME_INDEX 1
+#endif
 
 #if FEATURE != FEATURE_BASELINE
   #include <AceRoutine.h>
@@ -430,6 +446,224 @@ volatile int disableCompilerOptimization = 0;
     }
   }
 
+#elif FEATURE == FEATURE_SCHEDULER_ONE_COROUTINE_INDEX
+
+  class MyCoroutine : public Coroutine {
+    public:
+      int runCoroutine() override {
+        COROUTINE_LOOP() {
+          disableCompilerOptimization = 1;
+          COROUTINE_DELAY(10);
+        }
+      }
+  };
+
+  MyCoroutine a;
+
+#elif FEATURE == FEATURE_SCHEDULER_TWO_COROUTINES_INDEX
+
+  class MyCoroutineA : public Coroutine {
+    public:
+      int runCoroutine() override {
+        COROUTINE_LOOP() {
+          disableCompilerOptimization = 1;
+          COROUTINE_DELAY(10);
+        }
+      }
+  };
+
+  class MyCoroutineB : public Coroutine {
+    public:
+      int runCoroutine() override {
+        COROUTINE_LOOP() {
+          disableCompilerOptimization = 1;
+          COROUTINE_DELAY(10);
+        }
+      }
+  };
+
+  MyCoroutineA a;
+  MyCoroutineB b;
+
+#elif FEATURE == FEATURE_SCHEDULER_ONE_COROUTINE_COMPACT
+
+  // Delay state in a single 16-bit word.
+  using CompactCoroutine = CoroutineTemplate<Coroutine_Delay_Compact_Impl<
+      UnnamedCoroutine, ClockInterface, uint16_t>>;
+  using CompactScheduler = CoroutineSchedulerTemplate<CompactCoroutine>;
+
+  class MyCoroutine : public CompactCoroutine {
+    public:
+      int runCoroutine() override {
+        COROUTINE_LOOP() {
+          disableCompilerOptimization = 1;
+          COROUTINE_DELAY(10);
+        }
+      }
+  };
+
+  MyCoroutine a;
+
+#elif FEATURE == FEATURE_SCHEDULER_TWO_COROUTINES_COMPACT
+
+  // Delay state in a single 16-bit word.
+  using CompactCoroutine = CoroutineTemplate<Coroutine_Delay_Compact_Impl<
+      UnnamedCoroutine, ClockInterface, uint16_t>>;
+  using CompactScheduler = CoroutineSchedulerTemplate<CompactCoroutine>;
+
+  class MyCoroutineA : public CompactCoroutine {
+    public:
+      int runCoroutine() override {
+        COROUTINE_LOOP() {
+          disableCompilerOptimization = 1;
+          COROUTINE_DELAY(10);
+        }
+      }
+  };
+
+  class MyCoroutineB : public CompactCoroutine {
+    public:
+      int runCoroutine() override {
+        COROUTINE_LOOP() {
+          disableCompilerOptimization = 1;
+          COROUTINE_DELAY(10);
+        }
+      }
+  };
+
+  MyCoroutineA a;
+  MyCoroutineB b;
+
+#elif FEATURE == FEATURE_SCHEDULER_ONE_COROUTINE_32BIT
+
+  // 32-bit delays, without profiling.
+  using Coroutine32 = CoroutineTemplate<
+      Coroutine_Delay_32bit_Impl<UnnamedCoroutine, ClockInterface>>;
+  using Coroutine32Scheduler = CoroutineSchedulerTemplate<Coroutine32>;
+
+  class MyCoroutine : public Coroutine32 {
+    public:
+      int runCoroutine() override {
+        COROUTINE_LOOP() {
+          disableCompilerOptimization = 1;
+          COROUTINE_DELAY(10);
+        }
+      }
+  };
+
+  MyCoroutine a;
+
+#elif FEATURE == FEATURE_SCHEDULER_TWO_COROUTINES_32BIT
+
+  // 32-bit delays, without profiling.
+  using Coroutine32 = CoroutineTemplate<
+      Coroutine_Delay_32bit_Impl<UnnamedCoroutine, ClockInterface>>;
+  using Coroutine32Scheduler = CoroutineSchedulerTemplate<Coroutine32>;
+
+  class MyCoroutineA : public Coroutine32 {
+    public:
+      int runCoroutine() override {
+        COROUTINE_LOOP() {
+          disableCompilerOptimization = 1;
+          COROUTINE_DELAY(10);
+        }
+      }
+  };
+
+  class MyCoroutineB : public Coroutine32 {
+    public:
+      int runCoroutine() override {
+        COROUTINE_LOOP() {
+          disableCompilerOptimization = 1;
+          COROUTINE_DELAY(10);
+        }
+      }
+  };
+
+  MyCoroutineA a;
+  MyCoroutineB b;
+
+#elif FEATURE == FEATURE_SCHEDULER_ONE_COROUTINE_PROFILER
+
+  // 32-bit delays, with the profiler layer but no profiler attached.
+  using ProfiledCoroutine = CoroutineTemplate<
+      Coroutine_Delay_32bit_Profiler_Impl<UnnamedCoroutine, ClockInterface>>;
+  using ProfiledCoroutineScheduler = CoroutineSchedulerTemplate<ProfiledCoroutine>;
+
+  class MyCoroutine : public ProfiledCoroutine {
+    public:
+      int runCoroutine() override {
+        COROUTINE_LOOP() {
+          disableCompilerOptimization = 1;
+          COROUTINE_DELAY(10);
+        }
+      }
+  };
+
+  MyCoroutine a;
+
+#elif FEATURE == FEATURE_SCHEDULER_TWO_COROUTINES_PROFILER
+
+  // 32-bit delays, with the profiler layer but no profiler attached.
+  using ProfiledCoroutine = CoroutineTemplate<
+      Coroutine_Delay_32bit_Profiler_Impl<UnnamedCoroutine, ClockInterface>>;
+  using ProfiledCoroutineScheduler = CoroutineSchedulerTemplate<ProfiledCoroutine>;
+
+  class MyCoroutineA : public ProfiledCoroutine {
+    public:
+      int runCoroutine() override {
+        COROUTINE_LOOP() {
+          disableCompilerOptimization = 1;
+          COROUTINE_DELAY(10);
+        }
+      }
+  };
+
+  class MyCoroutineB : public ProfiledCoroutine {
+    public:
+      int runCoroutine() override {
+        COROUTINE_LOOP() {
+          disableCompilerOptimization = 1;
+          COROUTINE_DELAY(10);
+        }
+      }
+  };
+
+  MyCoroutineA a;
+  MyCoroutineB b;
+
+#elif FEATURE == FEATURE_SCHEDULER_ONE_COROUTINE_HISTOGRAM \
+    || FEATURE == FEATURE_SCHEDULER_ONE_COROUTINE_HISTOGRAM16
+
+  // 32-bit delays, with a run and a wait profiler of 20 bins attached. The
+  // bins are member arrays, so no heap is used.
+  using ProfiledCoroutine = CoroutineTemplate<
+      Coroutine_Delay_32bit_Profiler_Impl<UnnamedCoroutine, ClockInterface>>;
+  using ProfiledCoroutineScheduler = CoroutineSchedulerTemplate<ProfiledCoroutine>;
+
+  Profiler* Profiler::root;
+
+  #if FEATURE == FEATURE_SCHEDULER_ONE_COROUTINE_HISTOGRAM
+    using BinCount = uint32_t;
+  #else
+    using BinCount = uint16_t;
+  #endif
+
+  Log2HistogramCoroutineProfiler<20, BinCount> runProfiler;
+  Log2HistogramCoroutineProfiler<20, BinCount> waitProfiler;
+
+  class MyCoroutine : public ProfiledCoroutine {
+    public:
+      int runCoroutine() override {
+        COROUTINE_LOOP() {
+          disableCompilerOptimization = 1;
+          COROUTINE_DELAY(10);
+        }
+      }
+  };
+
+  MyCoroutine a;
+
 #endif
 
 // TeensyDuino seems to pull in malloc() and free() when a class with virtual
@@ -458,9 +692,25 @@ void setup() {
   foo = new FooClass();
 #endif
 
-#if FEATURE >= FEATURE_SCHEDULER_ONE_COROUTINE \
-    && FEATURE <= FEATURE_SCHEDULER_MANUAL_SETUP_TWO_COROUTINES
+#if (FEATURE >= FEATURE_SCHEDULER_ONE_COROUTINE \
+    && FEATURE <= FEATURE_SCHEDULER_MANUAL_SETUP_TWO_COROUTINES) \
+    || FEATURE == FEATURE_SCHEDULER_ONE_COROUTINE_INDEX \
+    || FEATURE == FEATURE_SCHEDULER_TWO_COROUTINES_INDEX
    CoroutineScheduler::setup();
+#elif FEATURE == FEATURE_SCHEDULER_ONE_COROUTINE_COMPACT \
+    || FEATURE == FEATURE_SCHEDULER_TWO_COROUTINES_COMPACT
+   CompactScheduler::setup();
+#elif FEATURE == FEATURE_SCHEDULER_ONE_COROUTINE_32BIT \
+    || FEATURE == FEATURE_SCHEDULER_TWO_COROUTINES_32BIT
+   Coroutine32Scheduler::setup();
+#elif FEATURE == FEATURE_SCHEDULER_ONE_COROUTINE_PROFILER \
+    || FEATURE == FEATURE_SCHEDULER_TWO_COROUTINES_PROFILER
+   ProfiledCoroutineScheduler::setup();
+#elif FEATURE == FEATURE_SCHEDULER_ONE_COROUTINE_HISTOGRAM \
+    || FEATURE == FEATURE_SCHEDULER_ONE_COROUTINE_HISTOGRAM16
+   ProfiledCoroutineScheduler::setup();
+   a.setRunProfiler(&runProfiler);
+   a.setWaitProfiler(&waitProfiler);
 
   #if FEATURE == FEATURE_SCHEDULER_SETUP_ONE_COROUTINE \
       || FEATURE == FEATURE_SCHEDULER_SETUP_TWO_COROUTINES
@@ -526,5 +776,24 @@ void loop() {
   blink.runCoroutine();
 #elif FEATURE == FEATURE_BLINK_FUNCTION
   blink();
+#elif FEATURE == FEATURE_SCHEDULER_ONE_COROUTINE_INDEX
+  CoroutineScheduler::loop();
+#elif FEATURE == FEATURE_SCHEDULER_TWO_COROUTINES_INDEX
+  CoroutineScheduler::loop();
+#elif FEATURE == FEATURE_SCHEDULER_ONE_COROUTINE_COMPACT
+  CompactScheduler::loop();
+#elif FEATURE == FEATURE_SCHEDULER_TWO_COROUTINES_COMPACT
+  CompactScheduler::loop();
+#elif FEATURE == FEATURE_SCHEDULER_ONE_COROUTINE_32BIT
+  Coroutine32Scheduler::loop();
+#elif FEATURE == FEATURE_SCHEDULER_TWO_COROUTINES_32BIT
+  Coroutine32Scheduler::loop();
+#elif FEATURE == FEATURE_SCHEDULER_ONE_COROUTINE_PROFILER
+  ProfiledCoroutineScheduler::loop();
+#elif FEATURE == FEATURE_SCHEDULER_TWO_COROUTINES_PROFILER
+  ProfiledCoroutineScheduler::loop();
+#elif FEATURE == FEATURE_SCHEDULER_ONE_COROUTINE_HISTOGRAM \
+    || FEATURE == FEATURE_SCHEDULER_ONE_COROUTINE_HISTOGRAM16
+  ProfiledCoroutineScheduler::loop();
 #endif
 }
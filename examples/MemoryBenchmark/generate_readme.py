@@ -125,6 +125,36 @@ calculated flash size can jump around in unexpected ways.
         * ESP8266 Core from 2.7.4 to 3.0.2
         * ESP32 Core from 1.0.6 to 2.0.2
         * Teensyduino from 1.54 to 1.56
+* Unreleased
+    * Add `Scheduler, One Coroutine (index)` and `Scheduler, Two Coroutines
+      (index)`, which compile the `Scheduler` features with
+      `ACE_ROUTINE_RESUME_INDEX` set to 1.
+        * The 8-bit resume index shares a 16-bit word with the status, instead
+          of a `void*` label pointer, so the static RAM per coroutine goes
+          down by 1 byte on AVR, 4 bytes on 32-bit processors, and 8 bytes
+          on 64-bit Linux.
+    * Add `Scheduler, One Coroutine (compact)` and `Scheduler, Two Coroutines
+      (compact)`, which use `Coroutine_Delay_Compact_Impl` with a 16-bit wake
+      time.
+        * The delay state goes down from 4 bytes (`Coroutine_Delay_16bit_Impl`)
+          to 2 bytes per coroutine.
+    * Remove the 6 virtual profiling methods of `UnnamedCoroutine`.
+        * The profiling hooks are resolved at compile time, so the vtable of
+          every `Coroutine` loses 6 slots (12 bytes of flash on AVR, 24 bytes
+          on 32-bit processors), and the empty hooks are no longer linked in.
+        * Add `Scheduler, One Coroutine (32bit)`, `Scheduler, Two Coroutines
+          (32bit)`, `Scheduler, One Coroutine (profiler)` and `Scheduler, Two
+          Coroutines (profiler)` to compare the delay and profiler policies.
+    * Make the histogram profilers heap-free.
+        * The bins are a member array sized by a template parameter, instead
+          of a `new uint32_t[nbins]`, so `malloc()` and `free()` are no longer
+          linked in by a profiled build, and the bins show up in the static
+          RAM.
+        * Add `Scheduler, One Coroutine (histogram)` and `Scheduler, One
+          Coroutine (histogram16)`, with a run and a wait
+          `Log2HistogramCoroutineProfiler<20>` of `uint32_t` and `uint16_t`
+          bins attached. On 64-bit Linux (EpoxyDuino), the pair of 16-bit
+          profilers uses 96 bytes of RAM less than the 32-bit ones.
 
 ## How to Generate
 
@@ -27,6 +27,16 @@ BEGIN {
   labels[18] = "Scheduler, Two Coroutines (man setup)"
   labels[19] = "Blink Function"
   labels[20] = "Blink Coroutine"
+  labels[21] = "Scheduler, One Coroutine (index)"
+  labels[22] = "Scheduler, Two Coroutines (index)"
+  labels[23] = "Scheduler, One Coroutine (compact)"
+  labels[24] = "Scheduler, Two Coroutines (compact)"
+  labels[25] = "Scheduler, One Coroutine (32bit)"
+  labels[26] = "Scheduler, Two Coroutines (32bit)"
+  labels[27] = "Scheduler, One Coroutine (profiler)"
+  labels[28] = "Scheduler, Two Coroutines (profiler)"
+  labels[29] = "Scheduler, One Coroutine (histogram)"
+  labels[30] = "Scheduler, One Coroutine (histogram16)"
   record_index = 0
 }
 {
@@ -58,6 +68,11 @@ END {
       || labels[i] ~ /^Scheduler, One Coroutine \(setup\)$/ \
       || labels[i] ~ /^Scheduler, One Coroutine \(man setup\)$/ \
       || labels[i] ~ /^Blink Function$/ \
+      || labels[i] ~ /^Scheduler, One Coroutine \(index\)$/ \
+      || labels[i] ~ /^Scheduler, One Coroutine \(compact\)$/ \
+      || labels[i] ~ /^Scheduler, One Coroutine \(32bit\)$/ \
+      || labels[i] ~ /^Scheduler, One Coroutine \(profiler\)$/ \
+      || labels[i] ~ /^Scheduler, One Coroutine \(histogram\)$/ \
     ) {
       printf("|---------------------------------------+--------------+-------------|\n")
     }
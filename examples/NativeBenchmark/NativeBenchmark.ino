@@ -0,0 +1,121 @@
+/*
+ * This sketch compares the computed goto implementation of the coroutines
+ * (the COROUTINE_*() macros) with the C++20 implementation
+ * (NativeCoroutineTemplate). Each runs NUM_COROUTINES instances of a
+ * coroutine class which increments a counter then yields, through the
+ * CoroutineScheduler, for NUM_ITERATIONS dispatches. It prints the time per
+ * dispatch in nanoseconds, and the memory used by each instance: the size of
+ * the object, plus the size of its frame for the native coroutine.
+ *
+ * The C++20 coroutines are available only on EpoxyDuino (Linux or MacOS), see
+ * the Makefile.
+ */
+
+#include <Arduino.h>
+#include <AceRoutine.h>
+using namespace ace_routine;
+
+#if ! defined(SERIAL_PORT_MONITOR)
+  #define SERIAL_PORT_MONITOR Serial
+#endif
+
+#if ! ACE_ROUTINE_NATIVE_COROUTINE
+  #error This benchmark requires the C++20 coroutines, see Makefile
+#endif
+
+// Number of instances of each coroutine class.
+const uint16_t NUM_COROUTINES = 100;
+
+// Number of coroutine dispatches per measurement.
+const uint32_t NUM_ITERATIONS = 10000000;
+
+volatile uint32_t counter = 0;
+
+// The computed goto coroutines. Since the local variables are lost across a
+// COROUTINE_YIELD(), the state is kept in member variables.
+class GotoCounter : public Coroutine {
+  public:
+    int runCoroutine() override {
+      COROUTINE_LOOP() {
+        counter = counter + 1;
+        COROUTINE_YIELD();
+      }
+    }
+};
+
+// The native coroutines. The state would be kept in the local variables of the
+// frame. The clock is the same as ClockInterface, but a distinct type, so that
+// they are in a separate list from the Coroutine instances.
+class NativeClock : public ClockInterface {};
+
+using NativeBase = Coroutine_Delay_16bit_Impl<UnnamedCoroutine, NativeClock>;
+using NativeScheduler = CoroutineSchedulerTemplate<CoroutineTemplate<
+    NativeBase>>;
+
+FrameArenaTemplate<128, NUM_COROUTINES> arena;
+
+class NativeCounter : public NativeCoroutineTemplate<NativeBase> {
+  public:
+    NativeCounter() : NativeCoroutineTemplate<NativeBase>(arena) {}
+
+    NativeTask run() override {
+      while (true) {
+        counter = counter + 1;
+        co_await coroutineYield();
+      }
+    }
+};
+
+GotoCounter gotoCounters[NUM_COROUTINES];
+NativeCounter nativeCounters[NUM_COROUTINES];
+
+template <typename T_SCHEDULER>
+uint32_t measureNanos() {
+  T_SCHEDULER::setup();
+  uint32_t startMicros = micros();
+  for (uint32_t i = 0; i < NUM_ITERATIONS; i++) {
+    T_SCHEDULER::loop();
+  }
+  uint32_t elapsedMicros = micros() - startMicros;
+  return (uint32_t) ((uint64_t) elapsedMicros * 1000 / NUM_ITERATIONS);
+}
+
+void printResult(const __FlashStringHelper* name, uint32_t nanos,
+    size_t objectSize, size_t frameSize) {
+  SERIAL_PORT_MONITOR.print(name);
+  SERIAL_PORT_MONITOR.print(' ');
+  SERIAL_PORT_MONITOR.print(nanos);
+  SERIAL_PORT_MONITOR.print(' ');
+  SERIAL_PORT_MONITOR.print(objectSize);
+  SERIAL_PORT_MONITOR.print(' ');
+  SERIAL_PORT_MONITOR.print(frameSize);
+  SERIAL_PORT_MONITOR.println();
+}
+
+void setup() {
+#if ! defined(EPOXY_DUINO)
+  delay(1000);
+#endif
+
+  SERIAL_PORT_MONITOR.begin(115200);
+  while (!SERIAL_PORT_MONITOR); // Leonardo/Micro
+
+  SERIAL_PORT_MONITOR.println(F("BENCHMARKS"));
+  SERIAL_PORT_MONITOR.println(F("name nanos object_bytes frame_bytes"));
+
+  uint32_t gotoNanos = measureNanos<CoroutineScheduler>();
+  printResult(F("ComputedGoto"), gotoNanos, sizeof(GotoCounter), 0);
+
+  uint32_t nativeNanos = measureNanos<NativeScheduler>();
+  printResult(F("Native"), nativeNanos, sizeof(NativeCounter),
+      FrameArena::kHeaderSize + arena.getMaxFrameSize());
+
+  SERIAL_PORT_MONITOR.println(F("END"));
+
+#if defined(EPOXY_DUINO)
+  exit(0);
+#endif
+}
+
+void loop() {
+}
@@ -9,7 +9,9 @@
 
 #define CHANNEL_TYPE_SYNC 0
 #define CHANNEL_TYPE_NO_SYNC 1
-#define CHANNEL_TYPE CHANNEL_TYPE_SYNC
+#if ! defined(CHANNEL_TYPE)
+  #define CHANNEL_TYPE CHANNEL_TYPE_SYNC
+#endif
 
 #define TEST_TYPE_LOOP 0
 #define TEST_TYPE_SEQ 1
@@ -91,42 +93,46 @@ struct Message {
   int value;
 };
 
+// Each coroutine keeps its loop counter and message in its COROUTINE_STATE(),
+// which reserves up to 16 bytes per coroutine, instead of static variables.
+using StateCoroutine = CoroutineTemplate<Coroutine_Delay_16bit_Impl<
+    Coroutine_State_Impl<UnnamedCoroutine, 16>, ClockInterface>>;
+
 #if CHANNEL_TYPE == CHANNEL_TYPE_NO_SYNC
   NoSyncChannel<Message> channel;
 #elif CHANNEL_TYPE == CHANNEL_TYPE_SYNC
   // This is a synchronized unbuffered Channel.
-  Channel<Message> channel;
+  Channel<Message, StateCoroutine> channel;
 #endif
 
 #if TEST_TYPE == TEST_TYPE_LOOP
 // Test the ordering of sending 10 integers and receiving 10 integers.
-COROUTINE(writer) {
-  static int i;
-  static Message message;
+COROUTINE(StateCoroutine, writer) {
+  COROUTINE_STATE(struct { int i; Message message; });
   COROUTINE_BEGIN();
-  for (i = 0; i < 10; i++) {
+  for (state.i = 0; state.i < 10; state.i++) {
     Serial.print("Writer: sending ");
-    Serial.println(i);
-    message = {Message::kStatusOk, i};
-    COROUTINE_CHANNEL_WRITE(channel, message);
+    Serial.println(state.i);
+    state.message = {Message::kStatusOk, state.i};
+    COROUTINE_CHANNEL_WRITE(channel, state.message);
   }
   Serial.println("Writer: done");
   COROUTINE_END();
 }
 
-COROUTINE(reader) {
-  static Message message;
+COROUTINE(StateCoroutine, reader) {
+  COROUTINE_STATE(struct { Message message; });
   COROUTINE_LOOP() {
-    COROUTINE_CHANNEL_READ(channel, message);
+    COROUTINE_CHANNEL_READ(channel, state.message);
     Serial.print("Reader: received ");
-    Serial.println(message.value);
+    Serial.println(state.message.value);
   }
 }
 
 #else
 
 // Test the sequencing of the writer and reader.
-COROUTINE(writer) {
+COROUTINE(StateCoroutine, writer) {
   COROUTINE_BEGIN();
   Serial.println("Writer: sending data");
   COROUTINE_CHANNEL_WRITE(channel, 42);
@@ -134,7 +140,7 @@ COROUTINE(writer) {
   COROUTINE_END();
 }
 
-COROUTINE(reader) {
+COROUTINE(StateCoroutine, reader) {
   COROUTINE_BEGIN();
   Serial.println("Reader: sleeping for 1 second");
   COROUTINE_DELAY(1000);
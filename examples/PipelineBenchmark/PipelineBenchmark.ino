@@ -0,0 +1,208 @@
+/*
+ * This sketch compares a 5-stage pipeline (source, map, filter, batch, sink)
+ * written in 2 ways:
+ *
+ *  * Fused: a single PipelineTemplate coroutine, whose stages are fused by
+ *    the compiler into its runCoroutine(),
+ *  * Unfused: 5 coroutines connected by 4 Channels, in the style of
+ *    examples/Pipe.
+ *
+ * Both run until the source has produced NUM_ITEMS values, and print the
+ * number of values, the elapsed time, and the time per value in nanoseconds.
+ *
+ * The number of values is meant for EpoxyDuino (Linux or MacOS). It is much
+ * smaller on microcontrollers.
+ */
+
+#include <Arduino.h>
+#include <AceRoutine.h>
+using namespace ace_routine;
+
+#if ! defined(SERIAL_PORT_MONITOR)
+  #define SERIAL_PORT_MONITOR Serial
+#endif
+
+#if defined(EPOXY_DUINO)
+  const uint32_t NUM_ITEMS = 2000000;
+#else
+  const uint32_t NUM_ITEMS = 10000;
+#endif
+
+const uint8_t BATCH_SIZE = 4;
+
+// The unfused stages are of a separate Coroutine type, so that they are not
+// run by the scheduler of the fused pipeline, and vice versa.
+class UnfusedClock : public ClockInterface {};
+using UnfusedCoroutine = CoroutineTemplate<Coroutine_Delay_16bit_Impl<
+    UnnamedCoroutine, UnfusedClock>>;
+using UnfusedScheduler = CoroutineSchedulerTemplate<UnfusedCoroutine>;
+
+using ItemBatch = pipe::Batch<uint32_t, BATCH_SIZE>;
+
+volatile uint32_t numProduced = 0;
+volatile uint32_t total = 0;
+
+uint32_t scale(uint32_t x) { return x * 3; }
+bool isEven(uint32_t x) { return (x & 1) == 0; }
+
+void consume(const ItemBatch& batch) {
+  uint32_t sum = 0;
+  for (uint8_t i = 0; i < batch.size; i++) sum += batch.items[i];
+  total = total + sum;
+}
+
+//-----------------------------------------------------------------------------
+// Fused.
+//-----------------------------------------------------------------------------
+
+class Counter : public Generator<uint32_t> {
+  public:
+    int runCoroutine() override {
+      COROUTINE_LOOP() {
+        numProduced = numProduced + 1;
+        COROUTINE_YIELD_VALUE(numProduced);
+      }
+    }
+};
+
+Counter counter;
+
+PIPELINE(fused,
+    pipe::from(counter)
+    | pipe::map(scale)
+    | pipe::filter(isEven)
+    | pipe::batch<BATCH_SIZE>()
+    | pipe::sink(consume));
+
+//-----------------------------------------------------------------------------
+// Unfused.
+//-----------------------------------------------------------------------------
+
+Channel<uint32_t, UnfusedCoroutine> sourceToMap;
+Channel<uint32_t, UnfusedCoroutine> mapToFilter;
+Channel<uint32_t, UnfusedCoroutine> filterToBatch;
+Channel<ItemBatch, UnfusedCoroutine> batchToSink;
+
+class SourceStage : public UnfusedCoroutine {
+  public:
+    int runCoroutine() override {
+      COROUTINE_LOOP() {
+        numProduced = numProduced + 1;
+        mValue = numProduced;
+        COROUTINE_CHANNEL_WRITE(sourceToMap, mValue);
+      }
+    }
+
+  private:
+    uint32_t mValue;
+};
+
+class MapStage : public UnfusedCoroutine {
+  public:
+    int runCoroutine() override {
+      COROUTINE_LOOP() {
+        COROUTINE_CHANNEL_READ(sourceToMap, mValue);
+        mValue = scale(mValue);
+        COROUTINE_CHANNEL_WRITE(mapToFilter, mValue);
+      }
+    }
+
+  private:
+    uint32_t mValue;
+};
+
+class FilterStage : public UnfusedCoroutine {
+  public:
+    int runCoroutine() override {
+      COROUTINE_LOOP() {
+        COROUTINE_CHANNEL_READ(mapToFilter, mValue);
+        if (isEven(mValue)) {
+          COROUTINE_CHANNEL_WRITE(filterToBatch, mValue);
+        }
+      }
+    }
+
+  private:
+    uint32_t mValue;
+};
+
+class BatchStage : public UnfusedCoroutine {
+  public:
+    int runCoroutine() override {
+      COROUTINE_LOOP() {
+        for (mBatch.size = 0; mBatch.size < BATCH_SIZE; mBatch.size++) {
+          COROUTINE_CHANNEL_READ(filterToBatch, mBatch.items[mBatch.size]);
+        }
+        COROUTINE_CHANNEL_WRITE(batchToSink, mBatch);
+      }
+    }
+
+  private:
+    ItemBatch mBatch;
+};
+
+class SinkStage : public UnfusedCoroutine {
+  public:
+    int runCoroutine() override {
+      COROUTINE_LOOP() {
+        COROUTINE_CHANNEL_READ(batchToSink, mBatch);
+        consume(mBatch);
+      }
+    }
+
+  private:
+    ItemBatch mBatch;
+};
+
+SourceStage sourceStage;
+MapStage mapStage;
+FilterStage filterStage;
+BatchStage batchStage;
+SinkStage sinkStage;
+
+//-----------------------------------------------------------------------------
+
+template <typename T_SCHEDULER>
+void runPipeline(const __FlashStringHelper* name) {
+  T_SCHEDULER::setup();
+  numProduced = 0;
+  total = 0;
+
+  uint32_t startMicros = micros();
+  while (numProduced < NUM_ITEMS) {
+    T_SCHEDULER::loop();
+  }
+  uint32_t elapsedMicros = micros() - startMicros;
+
+  SERIAL_PORT_MONITOR.print(name);
+  SERIAL_PORT_MONITOR.print(' ');
+  SERIAL_PORT_MONITOR.print(numProduced);
+  SERIAL_PORT_MONITOR.print(' ');
+  SERIAL_PORT_MONITOR.print(elapsedMicros);
+  SERIAL_PORT_MONITOR.print(' ');
+  SERIAL_PORT_MONITOR.print(
+      (uint32_t) ((uint64_t) elapsedMicros * 1000 / numProduced));
+  SERIAL_PORT_MONITOR.println();
+}
+
+void setup() {
+#if ! defined(EPOXY_DUINO)
+  delay(1000);
+#endif
+
+  SERIAL_PORT_MONITOR.begin(115200);
+  while (!SERIAL_PORT_MONITOR); // Leonardo/Micro
+
+  SERIAL_PORT_MONITOR.println(F("BENCHMARKS"));
+  SERIAL_PORT_MONITOR.println(F("name items micros nanos_per_item"));
+  runPipeline<CoroutineScheduler>(F("Fused"));
+  runPipeline<UnfusedScheduler>(F("Unfused"));
+  SERIAL_PORT_MONITOR.println(F("END"));
+
+#if defined(EPOXY_DUINO)
+  exit(0);
+#endif
+}
+
+void loop() {
+}
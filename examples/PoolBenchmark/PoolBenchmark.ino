@@ -0,0 +1,113 @@
+/*
+ * This sketch is a stress test of the CoroutinePool. It spawns NUM_JOBS
+ * short-lived coroutines, at most POOL_SIZE at a time, each of which yields
+ * a few times then ends, and lets the CoroutineScheduler return them to the
+ * pool. It does so in the polling mode and in the queued mode, and prints the
+ * number of jobs, the elapsed time, and the time per job in nanoseconds.
+ *
+ * The number of jobs is meant for EpoxyDuino (Linux or MacOS). It is much
+ * smaller on microcontrollers.
+ */
+
+#include <Arduino.h>
+#include <AceRoutine.h>
+using namespace ace_routine;
+
+#if ! defined(SERIAL_PORT_MONITOR)
+  #define SERIAL_PORT_MONITOR Serial
+#endif
+
+#if defined(EPOXY_DUINO)
+  const uint32_t NUM_JOBS = 2000000;
+#else
+  const uint32_t NUM_JOBS = 10000;
+#endif
+
+// Maximum number of jobs alive at the same time.
+const uint16_t POOL_SIZE = 32;
+
+using PolledCoroutine = CoroutineTemplate<Coroutine_Delay_16bit_Impl<
+    Coroutine_Pool_Impl<UnnamedCoroutine>, ClockInterface>>;
+using PolledScheduler = CoroutineSchedulerTemplate<PolledCoroutine>;
+
+using QueuedCoroutine = CoroutineTemplate<Coroutine_Delay_32bit_Impl<
+    Coroutine_Pool_Impl<Coroutine_Queue_Impl<UnnamedCoroutine>>,
+    ClockInterface>>;
+using QueuedScheduler = CoroutineSchedulerTemplate<QueuedCoroutine>;
+
+volatile uint32_t counter = 0;
+
+// A job which works in 'mSteps' slices, then ends.
+template <typename T_COROUTINE>
+class Job : public T_COROUTINE {
+  public:
+    explicit Job(uint8_t steps) : mSteps(steps) {}
+
+    int runCoroutine() override {
+      COROUTINE_BEGIN();
+      for (mCount = 0; mCount < mSteps; mCount++) {
+        counter++;
+        COROUTINE_YIELD();
+      }
+      COROUTINE_END();
+    }
+
+  private:
+    uint8_t mSteps;
+    uint8_t mCount;
+};
+
+CoroutinePool<Job<PolledCoroutine>, POOL_SIZE> polledPool;
+CoroutinePool<Job<QueuedCoroutine>, POOL_SIZE> queuedPool;
+
+// Spawn a job whenever a slot is free, until NUM_JOBS were spawned, then run
+// until all of them were reclaimed.
+template <typename T_POOL, typename T_SCHEDULER>
+void runJobs(const __FlashStringHelper* name, T_POOL& pool) {
+  T_SCHEDULER::setup();
+
+  uint32_t startMicros = micros();
+  uint32_t spawned = 0;
+  while (spawned < NUM_JOBS) {
+    if (pool.spawn((uint8_t) (spawned % 4)) != nullptr) {
+      spawned++;
+    }
+    T_SCHEDULER::loop();
+  }
+  while (pool.getNumFree() != POOL_SIZE) {
+    T_SCHEDULER::loop();
+  }
+  uint32_t elapsedMicros = micros() - startMicros;
+
+  SERIAL_PORT_MONITOR.print(name);
+  SERIAL_PORT_MONITOR.print(' ');
+  SERIAL_PORT_MONITOR.print(spawned);
+  SERIAL_PORT_MONITOR.print(' ');
+  SERIAL_PORT_MONITOR.print(elapsedMicros);
+  SERIAL_PORT_MONITOR.print(' ');
+  SERIAL_PORT_MONITOR.print(
+      (uint32_t) ((uint64_t) elapsedMicros * 1000 / spawned));
+  SERIAL_PORT_MONITOR.println();
+}
+
+void setup() {
+#if ! defined(EPOXY_DUINO)
+  delay(1000);
+#endif
+
+  SERIAL_PORT_MONITOR.begin(115200);
+  while (!SERIAL_PORT_MONITOR); // Leonardo/Micro
+
+  SERIAL_PORT_MONITOR.println(F("BENCHMARKS"));
+  SERIAL_PORT_MONITOR.println(F("name jobs micros nanos_per_job"));
+  runJobs<decltype(polledPool), PolledScheduler>(F("Polled"), polledPool);
+  runJobs<decltype(queuedPool), QueuedScheduler>(F("Queued"), queuedPool);
+  SERIAL_PORT_MONITOR.println(F("END"));
+
+#if defined(EPOXY_DUINO)
+  exit(0);
+#endif
+}
+
+void loop() {
+}
@@ -17,9 +17,18 @@
 const int LED_ON = HIGH;
 const int LED_OFF = LOW;
 
-/***** enable one of these three ******/
+/***** enable one of these four ******/
+// Set to 1 to give blinkLed a higher priority than printHelloWorld, then
+// compare the wait histograms of blinkLed.
+#define USE_PRIORITIES 0
+
+#if USE_PRIORITIES
+// with profiling, queued scheduling and 2 priority levels
+using Coroutine = ace_routine::CoroutineTemplate< ace_routine::Coroutine_Delay_32bit_Profiler_Impl< ace_routine::Coroutine_Queue_Impl< ace_routine::NamedCoroutine, 2 >,ace_routine::ClockInterface >>;
+#else
 // with profiling
 using Coroutine = ace_routine::CoroutineTemplate< ace_routine::Coroutine_Delay_32bit_Profiler_Impl< ace_routine::NamedCoroutine,ace_routine::ClockInterface >>;
+#endif
 using CoroutineScheduler = ace_routine::CoroutineSchedulerTemplate<Coroutine>;
 using Profiler = ace_routine::Profiler;
 Profiler *Profiler::root;
@@ -69,12 +78,13 @@ COROUTINE(printHelloWorld) {
 /*  Runtime of blinkLed should be 0-10µs, so for the sake of example,
     let's use a linear profiler.
     It uses microseconds as units by defaults, so let's use 
-      first parameter: 30 histogram bine
-      second parameter: each bin is 500µs
+      template parameter: 30 histogram bins
+      constructor parameter: each bin is 1µs
+    The bins are a member array, so no memory is allocated on the heap.
 */
-ace_routine::LinearHistogramCoroutineProfiler run_prof( 30, 1 );
+ace_routine::LinearHistogramCoroutineProfiler<30> run_prof( 1 );
 
-// ace_routine::Log2HistogramCoroutineProfiler run_prof(10);
+// ace_routine::Log2HistogramCoroutineProfiler<10> run_prof;
 
 /*  Wait time is measured as the difference between what was requested by
     COROUTINE_DELAY and what delay actually happened. So it won't plot
@@ -86,7 +96,7 @@ ace_routine::LinearHistogramCoroutineProfiler run_prof( 30, 1 );
 
     20 bins means it will record from 2^0 to 2^20 microseconds.
 */
-ace_routine::Log2HistogramCoroutineProfiler wait_prof( 20 );
+ace_routine::Log2HistogramCoroutineProfiler<20> wait_prof;
 
 
 void setup() {
@@ -101,6 +111,11 @@ void setup() {
   printHelloWorld.setName( "hello" );
   blinkLed.setName( "blinkLed" );
 
+#if USE_PRIORITIES
+  // blinkLed runs first whenever both coroutines are ready.
+  blinkLed.setPriority( 1 );
+#endif
+
   /* set profilers manually */
   blinkLed.setRunProfiler( &run_prof );
   blinkLed.setWaitProfiler( &wait_prof );
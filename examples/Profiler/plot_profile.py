@@ -60,6 +60,14 @@ for coroutine_index, (coroutine_name, profile_data) in enumerate( sorted( coros.
             times = profile["exp"]**np.arange( len( histo )) * cycle_time
         elif hist_type == "lin":
             times = np.arange( len( histo )) * cycle_time * profile["div"]
+        elif hist_type == "hdr":
+            # lowest value of each bin, see HdrHistogramCoroutineProfiler
+            sub_bits = profile["sub_bits"]
+            index = np.arange( len( histo ))
+            bucket = index >> sub_bits
+            lowest = np.where( bucket == 0, index,
+                (index - ((bucket - 1) << sub_bits)) * 2.0**np.maximum( bucket - 1, 0 ))
+            times = lowest * cycle_time
 
         hsum    = np.cumsum( histo )
         print( coroutine_name, wait_run, hsum[-1], " runs" )
@@ -73,6 +81,10 @@ for coroutine_index, (coroutine_name, profile_data) in enumerate( sorted( coros.
             x = []
             sumy = []
             histoy = []
+        elif hist_type == "hdr":
+            x = []
+            sumy = []
+            histoy = []
         elif hist_type == "lin":
             x = [0]
             sumy = [0]
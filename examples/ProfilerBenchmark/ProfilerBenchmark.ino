@@ -0,0 +1,115 @@
+/*
+ * This sketch measures the cost of recording one sample in each type of
+ * histogram Profiler, which is paid in profileRun() and profileWait() on every
+ * dispatch of a profiled coroutine. The samples are taken from a table of
+ * NUM_VALUES pseudo-random values spread over 0 to about 2^24 cycles, so that
+ * all the bins are used. The cost of the loop itself is measured by the
+ * Baseline, and subtracted from the other results.
+ *
+ * It prints the number of samples, the elapsed time in microseconds, and the
+ * cost of one sample in nanoseconds.
+ */
+
+#include <Arduino.h>
+#include <AceRoutine.h>
+using namespace ace_routine;
+
+#if ! defined(SERIAL_PORT_MONITOR)
+  #define SERIAL_PORT_MONITOR Serial
+#endif
+
+#if defined(EPOXY_DUINO)
+  const uint32_t NUM_SAMPLES = 10000000;
+#else
+  const uint32_t NUM_SAMPLES = 10000;
+#endif
+
+const uint16_t NUM_VALUES = 256;
+
+Profiler* Profiler::root;
+
+uint32_t values[NUM_VALUES];
+volatile uint32_t total;
+
+LinearHistogramCoroutineProfiler<64> linearProfiler(16);
+Log2HistogramCoroutineProfiler<25> log2Profiler;
+LogHistogramCoroutineProfiler<25> logProfiler(2.0);
+HdrHistogramCoroutineProfiler<3> hdrProfiler;
+HdrHistogramCoroutineProfiler<5> hdr5Profiler;
+
+// Fill the table with a xorshift generator, each value keeping a random
+// number of its lower bits.
+void fillValues() {
+  uint32_t x = 2463534242UL;
+  for (uint16_t i = 0; i < NUM_VALUES; i++) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    values[i] = x >> (8 + (x & 0x1F) % 24);
+  }
+}
+
+// Same loop as runProfiler(), without the profiler.
+uint32_t runBaseline() {
+  uint32_t startMicros = micros();
+  uint32_t sum = 0;
+  for (uint32_t n = 0; n < NUM_SAMPLES; n++) {
+    sum += values[n % NUM_VALUES];
+  }
+  total = sum;
+  return micros() - startMicros;
+}
+
+// Call through a pointer to the base class, like the Coroutine does.
+uint32_t runProfiler(Profiler* profiler) {
+  uint32_t startMicros = micros();
+  for (uint32_t n = 0; n < NUM_SAMPLES; n++) {
+    profiler->profileRun(values[n % NUM_VALUES]);
+  }
+  return micros() - startMicros;
+}
+
+void printResult(
+    const __FlashStringHelper* name, uint32_t elapsedMicros,
+    uint32_t baselineMicros) {
+  uint32_t netMicros = (elapsedMicros > baselineMicros)
+      ? elapsedMicros - baselineMicros : 0;
+  SERIAL_PORT_MONITOR.print(name);
+  SERIAL_PORT_MONITOR.print(' ');
+  SERIAL_PORT_MONITOR.print(NUM_SAMPLES);
+  SERIAL_PORT_MONITOR.print(' ');
+  SERIAL_PORT_MONITOR.print(elapsedMicros);
+  SERIAL_PORT_MONITOR.print(' ');
+  SERIAL_PORT_MONITOR.print(
+      (uint32_t) ((uint64_t) netMicros * 1000 / NUM_SAMPLES));
+  SERIAL_PORT_MONITOR.println();
+}
+
+void setup() {
+#if ! defined(EPOXY_DUINO)
+  delay(1000);
+#endif
+
+  SERIAL_PORT_MONITOR.begin(115200);
+  while (!SERIAL_PORT_MONITOR); // Leonardo/Micro
+
+  fillValues();
+
+  SERIAL_PORT_MONITOR.println(F("BENCHMARKS"));
+  SERIAL_PORT_MONITOR.println(F("name samples micros nanos_per_sample"));
+  uint32_t baselineMicros = runBaseline();
+  printResult(F("Baseline"), baselineMicros, 0);
+  printResult(F("Linear"), runProfiler(&linearProfiler), baselineMicros);
+  printResult(F("Log2"), runProfiler(&log2Profiler), baselineMicros);
+  printResult(F("Log"), runProfiler(&logProfiler), baselineMicros);
+  printResult(F("Hdr<3>"), runProfiler(&hdrProfiler), baselineMicros);
+  printResult(F("Hdr<5>"), runProfiler(&hdr5Profiler), baselineMicros);
+  SERIAL_PORT_MONITOR.println(F("END"));
+
+#if defined(EPOXY_DUINO)
+  exit(0);
+#endif
+}
+
+void loop() {
+}
@@ -0,0 +1,135 @@
+/*
+ * This sketch measures the time from boot to the first dispatch of a control
+ * coroutine, when NUM_DEVICES other coroutines have an expensive
+ * setupCoroutine() (e.g. a sensor calibration), which takes SETUP_MICROS
+ * each. It compares 3 ways of setting them up:
+ *
+ *  * Eager: CoroutineScheduler::setupCoroutines() before the first loop(),
+ *  * Lazy: the Coroutine_LazySetup_Impl layer, which sets up each coroutine
+ *    just before its first dispatch,
+ *  * Staged: the same layer, with a setup budget of 1 coroutine per pass,
+ *    and a higher setup priority for the control coroutine.
+ *
+ * It prints the time to the first dispatch of the control coroutine, and the
+ * time until all coroutines have been set up, in microseconds.
+ */
+
+#include <Arduino.h>
+#include <AceRoutine.h>
+using namespace ace_routine;
+
+#if ! defined(SERIAL_PORT_MONITOR)
+  #define SERIAL_PORT_MONITOR Serial
+#endif
+
+const uint8_t NUM_DEVICES = 8;
+const uint32_t SETUP_MICROS = 2000;
+
+// Each method uses its own Coroutine type, hence its own scheduler.
+class EagerClock : public ClockInterface {};
+using EagerCoroutine = CoroutineTemplate<Coroutine_Delay_16bit_Impl<
+    UnnamedCoroutine, EagerClock>>;
+using EagerScheduler = CoroutineSchedulerTemplate<EagerCoroutine>;
+
+class LazyClock : public ClockInterface {};
+using LazyCoroutine = CoroutineTemplate<Coroutine_Delay_16bit_Impl<
+    Coroutine_LazySetup_Impl<UnnamedCoroutine>, LazyClock>>;
+using LazyScheduler = CoroutineSchedulerTemplate<LazyCoroutine>;
+
+class StagedClock : public ClockInterface {};
+using StagedCoroutine = CoroutineTemplate<Coroutine_Delay_16bit_Impl<
+    Coroutine_LazySetup_Impl<UnnamedCoroutine>, StagedClock>>;
+using StagedScheduler = CoroutineSchedulerTemplate<StagedCoroutine>;
+
+uint8_t numSetups;
+uint32_t firstDispatchMicros;
+
+// The control coroutine, whose first dispatch is measured. It is defined
+// first, so it is the last one in the list of the scheduler.
+template <typename T_COROUTINE>
+class Control : public T_COROUTINE {
+  public:
+    void setupCoroutine() override {
+      numSetups++;
+    }
+
+    int runCoroutine() override {
+      COROUTINE_LOOP() {
+        if (firstDispatchMicros == 0) firstDispatchMicros = micros();
+        COROUTINE_YIELD();
+      }
+    }
+};
+
+// A coroutine with an expensive setup.
+template <typename T_COROUTINE>
+class Device : public T_COROUTINE {
+  public:
+    void setupCoroutine() override {
+      uint32_t startMicros = micros();
+      while (micros() - startMicros < SETUP_MICROS) {}
+      numSetups++;
+    }
+
+    int runCoroutine() override {
+      COROUTINE_LOOP() {
+        COROUTINE_YIELD();
+      }
+    }
+};
+
+Control<EagerCoroutine> eagerControl;
+Device<EagerCoroutine> eagerDevices[NUM_DEVICES];
+
+Control<LazyCoroutine> lazyControl;
+Device<LazyCoroutine> lazyDevices[NUM_DEVICES];
+
+Control<StagedCoroutine> stagedControl;
+Device<StagedCoroutine> stagedDevices[NUM_DEVICES];
+
+template <typename T_SCHEDULER>
+void runBoot(const __FlashStringHelper* name, bool eager) {
+  numSetups = 0;
+  firstDispatchMicros = 0;
+
+  uint32_t startMicros = micros();
+  T_SCHEDULER::setup();
+  if (eager) T_SCHEDULER::setupCoroutines();
+  while (numSetups < NUM_DEVICES + 1 || firstDispatchMicros == 0) {
+    T_SCHEDULER::loop();
+  }
+  uint32_t allSetupMicros = micros() - startMicros;
+
+  SERIAL_PORT_MONITOR.print(name);
+  SERIAL_PORT_MONITOR.print(' ');
+  SERIAL_PORT_MONITOR.print(firstDispatchMicros - startMicros);
+  SERIAL_PORT_MONITOR.print(' ');
+  SERIAL_PORT_MONITOR.print(allSetupMicros);
+  SERIAL_PORT_MONITOR.println();
+}
+
+void setup() {
+#if ! defined(EPOXY_DUINO)
+  delay(1000);
+#endif
+
+  SERIAL_PORT_MONITOR.begin(115200);
+  while (!SERIAL_PORT_MONITOR); // Leonardo/Micro
+
+  StagedScheduler::setSetupBudget(1);
+  stagedControl.setSetupPriority(1);
+
+  SERIAL_PORT_MONITOR.println(F("BENCHMARKS"));
+  SERIAL_PORT_MONITOR.println(F("name first_dispatch_micros all_setup_micros"));
+  runBoot<EagerScheduler>(F("Eager"), true);
+  runBoot<LazyScheduler>(F("Lazy"), false);
+  runBoot<StagedScheduler>(F("Staged"), false);
+  SERIAL_PORT_MONITOR.println(F("END"));
+
+#if defined(EPOXY_DUINO)
+  exit(0);
+#endif
+}
+
+void loop() {
+}
@@ -0,0 +1,93 @@
+/*
+ * Record the dispatches and the status transitions of 3 coroutines into a
+ * TraceRing for about 200 milliseconds, then print the ring to the serial
+ * port. The output can be converted into the Chrome trace format with
+ * trace_to_chrome.py, then opened in https://ui.perfetto.dev or
+ * chrome://tracing to see the timeline of each coroutine.
+ */
+
+#include <Arduino.h>
+#include <AceRoutine.h>
+using namespace ace_routine;
+
+#if ! defined(SERIAL_PORT_MONITOR)
+  #define SERIAL_PORT_MONITOR Serial
+#endif
+
+using TracedCoroutine = CoroutineTemplate<Coroutine_Delay_16bit_Impl<
+    Coroutine_Trace_Impl<NamedCoroutine>, ClockInterface>>;
+using TracedScheduler = CoroutineSchedulerTemplate<TracedCoroutine>;
+
+// 256 events of 8 bytes on 32-bit processors. Use a smaller ring on AVR.
+#if defined(ARDUINO_ARCH_AVR)
+  TraceRing<64> traceRing;
+#else
+  TraceRing<256> traceRing;
+#endif
+
+const uint16_t TRACE_MILLIS = 200;
+uint32_t startMillis;
+
+// Blinks quickly, with a short busy period.
+COROUTINE(TracedCoroutine, fast) {
+  COROUTINE_LOOP() {
+    delayMicroseconds(50);
+    COROUTINE_DELAY(10);
+  }
+}
+
+// Blinks slowly, with a long busy period which delays the other coroutines.
+COROUTINE(TracedCoroutine, slow) {
+  COROUTINE_LOOP() {
+    delayMicroseconds(2000);
+    COROUTINE_DELAY(50);
+  }
+}
+
+// Runs 3 steps, then ends.
+COROUTINE(TracedCoroutine, worker) {
+  COROUTINE_BEGIN();
+  static uint8_t i;
+  for (i = 0; i < 3; i++) {
+    delayMicroseconds(500);
+    COROUTINE_DELAY(20);
+  }
+  COROUTINE_END();
+}
+
+void setup() {
+#if ! defined(EPOXY_DUINO)
+  delay(1000);
+#endif
+
+  SERIAL_PORT_MONITOR.begin(115200);
+  while (!SERIAL_PORT_MONITOR); // Leonardo/Micro
+
+  // The names appear in the trace, ids are given by setup().
+  fast.setName("fast");
+  slow.setName("slow");
+  worker.setName("worker");
+
+  TracedScheduler::setTraceRing(&traceRing);
+  TracedScheduler::setup();
+  startMillis = millis();
+}
+
+void loop() {
+  static bool done = false;
+  if (done) return;
+
+  TracedScheduler::loop();
+
+  if ((uint32_t) (millis() - startMillis) >= TRACE_MILLIS) {
+    // Nothing is recorded while the ring is printed, since the coroutines
+    // only run inside loop().
+    TracedScheduler::printTraceTo(SERIAL_PORT_MONITOR);
+    TracedScheduler::setTraceRing(nullptr);
+    done = true;
+
+  #if defined(EPOXY_DUINO)
+    exit(0);
+  #endif
+  }
+}
@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+#
+# Convert the output of CoroutineScheduler::printTraceTo() into the Chrome
+# trace event format (JSON), which can be opened in https://ui.perfetto.dev or
+# chrome://tracing. Each coroutine is a thread, each dispatch is a slice from
+# the dispatch to the status which gives up the CPU (yielding, delaying,
+# waiting, ending), and the transitions outside a dispatch (e.g. suspend() and
+# resume()) are instant events.
+#
+# Usage:
+#   $ ./Tracing.out | ./trace_to_chrome.py > trace.json
+#   $ ./trace_to_chrome.py capture.txt > trace.json
+
+import fileinput
+import json
+import sys
+
+# The kStatusXxx constants of the Coroutine, and TraceEvent::kEventDispatch.
+SUSPENDED = 0
+YIELDING = 1
+DELAYING = 2
+RUNNING = 3
+ENDING = 4
+TERMINATED = 5
+WAITING = 6
+DISPATCH = 16
+
+STATUS_NAMES = {
+    SUSPENDED: 'suspended',
+    YIELDING: 'yielding',
+    DELAYING: 'delaying',
+    RUNNING: 'running',
+    ENDING: 'ending',
+    TERMINATED: 'terminated',
+    WAITING: 'waiting',
+}
+
+# The statuses which end the slice of a dispatch.
+END_OF_DISPATCH = (YIELDING, DELAYING, WAITING, ENDING, SUSPENDED, TERMINATED)
+
+
+def parse(lines):
+    """Return (hz, lost, names, events) from the lines of the dump. The
+    events are (cycles, id, event), with the cycles unwrapped to 64 bits."""
+    hz = 1000000
+    lost = 0
+    names = {}
+    events = []
+    started = False
+    last = None
+    offset = 0
+    for line in lines:
+        fields = line.split()
+        if not fields:
+            continue
+        if fields[0] == 'TRACE':
+            hz = int(fields[1])
+            lost = int(fields[2])
+            names = {}
+            events = []
+            started = True
+            last = None
+            offset = 0
+        elif not started:
+            continue
+        elif fields[0] == 'NAME':
+            names[int(fields[1])] = ' '.join(fields[2:])
+        elif fields[0] == 'END':
+            break
+        elif len(fields) == 3:
+            cycles, id, event = (int(f) for f in fields)
+            if last is not None and cycles + offset < last:
+                offset += 1 << 32
+            last = cycles + offset
+            events.append((last, id, event))
+    return hz, lost, names, events
+
+
+def convert(hz, lost, names, events):
+    """Return the Chrome trace events."""
+    trace = []
+    for id, name in sorted(names.items()):
+        trace.append({'name': 'thread_name', 'ph': 'M', 'pid': 1, 'tid': id,
+                      'args': {'name': name}})
+
+    # The timeline starts at the oldest event.
+    base = events[0][0] if events else 0
+
+    def micros(cycles):
+        return (cycles - base) * 1000000.0 / hz
+
+    # The dispatch of each id which is not finished: [start, ran].
+    open_slices = {}
+
+    def close(id, cycles, status):
+        start, ran = open_slices.pop(id)
+        trace.append({
+            'name': 'run' if ran else 'start',
+            'ph': 'X', 'pid': 1, 'tid': id,
+            'ts': micros(start), 'dur': (cycles - start) * 1000000.0 / hz,
+            'args': {'status': STATUS_NAMES.get(status, str(status))},
+        })
+
+    for cycles, id, event in events:
+        if event == DISPATCH:
+            # A dispatch without an end, e.g. the first one after a loss.
+            if id in open_slices:
+                close(id, cycles, RUNNING)
+            open_slices[id] = [cycles, False]
+        elif id in open_slices and event == RUNNING:
+            open_slices[id][1] = True
+        elif id in open_slices and event in END_OF_DISPATCH:
+            close(id, cycles, event)
+        else:
+            trace.append({
+                'name': STATUS_NAMES.get(event, str(event)),
+                'ph': 'i', 's': 't', 'pid': 1, 'tid': id,
+                'ts': micros(cycles),
+            })
+
+    if lost:
+        sys.stderr.write('%d events were lost\n' % lost)
+    return trace
+
+
+def main():
+    hz, lost, names, events = parse(fileinput.input())
+    json.dump({'traceEvents': convert(hz, lost, names, events),
+               'displayTimeUnit': 'ms'}, sys.stdout)
+    sys.stdout.write('\n')
+
+
+if __name__ == '__main__':
+    main()
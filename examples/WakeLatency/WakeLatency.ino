@@ -0,0 +1,222 @@
+/*
+ * This sketch measures the latency between an asynchronous event (here a POSIX
+ * timer signal, standing in for an interrupt) and the moment a coroutine starts
+ * handling it. A periodic timer fires every PERIOD_MICROS, and its signal
+ * handler wakes up a handler coroutine in one of two ways:
+ *
+ *  * Flag: the signal handler sets a volatile flag, which the handler coroutine
+ *    polls using COROUTINE_AWAIT(). It is seen when the round-robin of the
+ *    scheduler reaches the handler, after up to NUM_BUSY other coroutines.
+ *  * Ring: the signal handler posts the handler coroutine into a WakeRing,
+ *    which the CoroutineScheduler drains at the start of the next loop(). The
+ *    handler is parked in COROUTINE_AWAIT_EVENT() in the meantime, so it
+ *    costs nothing while there is no event.
+ *
+ * NUM_BUSY coroutines, which yield after a small amount of work, keep the
+ * scheduler busy. The latency is measured with clock_gettime(CLOCK_MONOTONIC),
+ * so this sketch runs only on EpoxyDuino under Linux.
+ */
+
+#include <Arduino.h>
+#include <AceRoutine.h>
+using namespace ace_routine;
+
+#if ! defined(SERIAL_PORT_MONITOR)
+  #define SERIAL_PORT_MONITOR Serial
+#endif
+
+#if defined(EPOXY_DUINO) && defined(__linux__)
+
+#include <signal.h> // sigaction()
+#include <time.h> // timer_create(), clock_gettime()
+
+// Duration of each measurement window.
+const uint16_t WINDOW_MILLIS = 2000;
+
+// Period of the timer signal.
+const long PERIOD_MICROS = 1000;
+
+// Number of coroutines which keep the scheduler busy.
+const uint8_t NUM_BUSY = 20;
+
+using QueuedCoroutine = CoroutineTemplate<Coroutine_Delay_32bit_Impl<
+    Coroutine_Queue_Impl<UnnamedCoroutine>, ClockInterface>>;
+using QueuedScheduler = CoroutineSchedulerTemplate<QueuedCoroutine>;
+
+// Return the monotonic time in nanoseconds. Async-signal-safe.
+uint64_t monotonicNanos() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Latency statistics, in nanoseconds.
+struct Stats {
+  void clear() { count = 0; sum = 0; min = UINT64_MAX; max = 0; }
+
+  void add(uint64_t latency) {
+    count++;
+    sum += latency;
+    if (latency < min) min = latency;
+    if (latency > max) max = latency;
+  }
+
+  uint32_t count;
+  uint64_t sum;
+  uint64_t min;
+  uint64_t max;
+};
+
+Stats stats;
+
+// Time of the last signal, written by the signal handler.
+uint64_t postNanos;
+
+// Set by the signal handler in the Flag mode.
+volatile bool timerFlag = false;
+
+// Selects the mode of the signal handler.
+volatile bool useRing = false;
+
+WakeRing<QueuedCoroutine, 4> wakeRing;
+
+// Never notified. The Ring handler is woken up only by the WakeRing.
+EventTemplate<QueuedCoroutine> timerEvent;
+
+class BusyCoroutine : public QueuedCoroutine {
+  public:
+    int runCoroutine() override {
+      COROUTINE_LOOP() {
+        for (uint8_t i = 0; i < 50; i++) mWork += i;
+        COROUTINE_YIELD();
+      }
+    }
+
+  private:
+    volatile uint32_t mWork = 0;
+};
+
+class FlagHandler : public QueuedCoroutine {
+  public:
+    int runCoroutine() override {
+      COROUTINE_LOOP() {
+        COROUTINE_AWAIT(timerFlag);
+        timerFlag = false;
+        stats.add(monotonicNanos()
+            - __atomic_load_n(&postNanos, __ATOMIC_ACQUIRE));
+      }
+    }
+};
+
+class RingHandler : public QueuedCoroutine {
+  public:
+    int runCoroutine() override {
+      COROUTINE_LOOP() {
+        COROUTINE_AWAIT_EVENT(timerEvent);
+        stats.add(monotonicNanos()
+            - __atomic_load_n(&postNanos, __ATOMIC_ACQUIRE));
+      }
+    }
+};
+
+BusyCoroutine busy[NUM_BUSY];
+FlagHandler flagHandler;
+RingHandler ringHandler;
+
+void onTimer(int /*signal*/) {
+  __atomic_store_n(&postNanos, monotonicNanos(), __ATOMIC_RELEASE);
+  if (useRing) {
+    wakeRing.post(&ringHandler);
+  } else {
+    timerFlag = true;
+  }
+}
+
+void startTimer() {
+  struct sigaction action = {};
+  action.sa_handler = onTimer;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGRTMIN, &action, nullptr);
+
+  struct sigevent event = {};
+  event.sigev_notify = SIGEV_SIGNAL;
+  event.sigev_signo = SIGRTMIN;
+  timer_t timer;
+  timer_create(CLOCK_MONOTONIC, &event, &timer);
+
+  struct itimerspec spec = {};
+  spec.it_value.tv_nsec = PERIOD_MICROS * 1000;
+  spec.it_interval.tv_nsec = PERIOD_MICROS * 1000;
+  timer_settime(timer, 0, &spec, nullptr);
+}
+
+void printNanosAsMicros(uint64_t nanos) {
+  SERIAL_PORT_MONITOR.print((uint32_t) (nanos / 1000));
+  SERIAL_PORT_MONITOR.print('.');
+  uint32_t fraction = (nanos % 1000);
+  if (fraction < 100) SERIAL_PORT_MONITOR.print('0');
+  if (fraction < 10) SERIAL_PORT_MONITOR.print('0');
+  SERIAL_PORT_MONITOR.print(fraction);
+}
+
+void runWindow(const __FlashStringHelper* name, bool ring) {
+  if (ring) {
+    flagHandler.suspend();
+    ringHandler.resume();
+  } else {
+    ringHandler.suspend();
+    flagHandler.resume();
+  }
+  useRing = ring;
+  stats.clear();
+
+  uint16_t startMillis = millis();
+  while ((uint16_t) ((uint16_t) millis() - startMillis) < WINDOW_MILLIS) {
+    QueuedScheduler::loop();
+  }
+
+  SERIAL_PORT_MONITOR.print(name);
+  SERIAL_PORT_MONITOR.print(' ');
+  SERIAL_PORT_MONITOR.print(stats.count);
+  SERIAL_PORT_MONITOR.print(' ');
+  printNanosAsMicros(stats.count ? stats.min : 0);
+  SERIAL_PORT_MONITOR.print(' ');
+  printNanosAsMicros(stats.count ? stats.sum / stats.count : 0);
+  SERIAL_PORT_MONITOR.print(' ');
+  printNanosAsMicros(stats.max);
+  SERIAL_PORT_MONITOR.print(' ');
+  SERIAL_PORT_MONITOR.print(wakeRing.getOverflows());
+  SERIAL_PORT_MONITOR.println();
+}
+
+void setup() {
+  SERIAL_PORT_MONITOR.begin(115200);
+  while (!SERIAL_PORT_MONITOR); // Leonardo/Micro
+
+  QueuedScheduler::addWakeRing(&wakeRing);
+  QueuedScheduler::setup();
+  startTimer();
+
+  SERIAL_PORT_MONITOR.println(F("BENCHMARKS"));
+  SERIAL_PORT_MONITOR.println(
+      F("name events min_micros avg_micros max_micros overflows"));
+  runWindow(F("Flag"), false);
+  runWindow(F("Ring"), true);
+  SERIAL_PORT_MONITOR.println(F("END"));
+
+  exit(0);
+}
+
+#else
+
+void setup() {
+  SERIAL_PORT_MONITOR.begin(115200);
+  while (!SERIAL_PORT_MONITOR); // Leonardo/Micro
+
+  SERIAL_PORT_MONITOR.println(F("WakeLatency requires EpoxyDuino on Linux"));
+}
+
+#endif
+
+void loop() {
+}
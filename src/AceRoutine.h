@@ -49,7 +49,22 @@ SOFTWARE.
 #include "ace_routine/Coroutine.h"
 #include "ace_routine/Profiler.h"
 #include "ace_routine/Coroutine32bit.h"
+#include "ace_routine/CoroutineCompact.h"
+#include "ace_routine/CycleClock.h"
+#include "ace_routine/CoroutineNative.h"
+#include "ace_routine/CoroutineQueue.h"
+#include "ace_routine/CoroutinePool.h"
+#include "ace_routine/FrameArena.h"
+#include "ace_routine/CoroutineState.h"
+#include "ace_routine/CoroutineSetup.h"
+#include "ace_routine/CoroutineTrace.h"
+#include "ace_routine/CoroutineUsage.h"
+#include "ace_routine/WakeRing.h"
 #include "ace_routine/CoroutineScheduler.h"
+#include "ace_routine/StaticScheduler.h"
+#include "ace_routine/Event.h"
 #include "ace_routine/Channel.h"
+#include "ace_routine/Generator.h"
+#include "ace_routine/Pipeline.h"
 
 #endif
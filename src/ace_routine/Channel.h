@@ -3,20 +3,54 @@
 
 #include <stdint.h>
 #include "Coroutine.h"
+#include "Event.h"
 
-/** Write the given value x to the given channel within a Coroutine. */
+/**
+ * Write the given value x to the given channel within a Coroutine. The
+ * coroutine waits on the event of the channel between attempts, so it is not
+ * run again until the reader has made progress. A channel without a
+ * getEvent() method, e.g. a user-defined one, is polled instead, as with
+ * COROUTINE_AWAIT().
+ */
 #define COROUTINE_CHANNEL_WRITE(channel, x) \
 do { \
   (channel).setValue(x); \
-  COROUTINE_AWAIT((channel).write()); \
+  while (!(channel).write()) { \
+    COROUTINE_AWAIT_EVENT(ace_routine::channelEvent(channel, 0)); \
+  } \
 } while (false)
 
 /** Read the value in the channel to variable x within a Coroutine. */
 #define COROUTINE_CHANNEL_READ(channel, x) \
-  COROUTINE_AWAIT((channel).read(x))
+do { \
+  while (!(channel).read(x)) { \
+    COROUTINE_AWAIT_EVENT(ace_routine::channelEvent(channel, 0)); \
+  } \
+} while (false)
 
 namespace ace_routine {
 
+/**
+ * Used by COROUTINE_CHANNEL_WRITE() and COROUTINE_CHANNEL_READ(). Return the
+ * event of a channel which has a getEvent() method. The `int` argument makes
+ * this overload preferred over the other one.
+ */
+template <typename T_CHANNEL>
+auto channelEvent(T_CHANNEL& channel, int) -> decltype(channel.getEvent()) {
+  return channel.getEvent();
+}
+
+/**
+ * Used by COROUTINE_CHANNEL_WRITE() and COROUTINE_CHANNEL_READ(). Return an
+ * empty polling event for a channel without a getEvent() method, so that the
+ * caller yields once between attempts.
+ */
+template <typename T_CHANNEL>
+EventTemplate<Coroutine, false>& channelEvent(T_CHANNEL& /*channel*/, long) {
+  static EventTemplate<Coroutine, false> event;
+  return event;
+}
+
 /**
  * An unbuffered synchronized channel. Readers and writers block until the
  * writer is ready to send and the receiver is ready to receive. Then the
@@ -38,13 +72,29 @@ namespace ace_routine {
  * @endcode
  *
  * This sequence of events matches the user's expectations.
+ *
+ * Every change of state notifies the event of the channel, which the
+ * COROUTINE_CHANNEL_WRITE() and COROUTINE_CHANNEL_READ() macros wait on. If
+ * T_COROUTINE includes the Coroutine_Queue_Impl layer, a blocked reader or
+ * writer is then not run by the CoroutineScheduler until the other side acts.
+ * The event is a private base class rather than a member, so that the empty
+ * event of the polling mode takes no space.
+ *
+ * @tparam T type of the value
+ * @tparam T_COROUTINE the Coroutine type of the readers and writers
  */
-template<typename T>
-class Channel {
+template<typename T, typename T_COROUTINE = Coroutine>
+class Channel : private EventTemplate<T_COROUTINE> {
   public:
     /** Constructor. */
     Channel() {}
 
+    /**
+     * Return the event which is notified on every change of state. Used by
+     * COROUTINE_CHANNEL_WRITE() and COROUTINE_CHANNEL_READ().
+     */
+    EventTemplate<T_COROUTINE>& getEvent() { return *this; }
+
     /**
      * Used by COROUTINE_CHANNEL_WRITE() to preserve the value of the write
      * across multiple COROUTINE_YIELD() calls. Not designed to be used
@@ -65,12 +115,12 @@ class Channel {
           return false;
         case kReaderReady:
           mValue = mValueToWrite;
-          mChannelState = kDataProduced;
+          setState(kDataProduced);
           return false;
         case kDataProduced:
           return false;
         case kDataConsumed:
-          mChannelState = kWriterReady;
+          setState(kWriterReady);
           return true;
         default:
           return false;
@@ -87,12 +137,12 @@ class Channel {
           return false;
         case kReaderReady:
           mValue = value;
-          mChannelState = kDataProduced;
+          setState(kDataProduced);
           return false;
         case kDataProduced:
           return false;
         case kDataConsumed:
-          mChannelState = kWriterReady;
+          setState(kWriterReady);
           return true;
         default:
           return false;
@@ -106,13 +156,13 @@ class Channel {
     bool read(T& value) {
       switch (mChannelState) {
         case kWriterReady:
-          mChannelState = kReaderReady;
+          setState(kReaderReady);
           return false;
         case kReaderReady:
           return false;
         case kDataProduced:
           value = mValue;
-          mChannelState = kDataConsumed;
+          setState(kDataConsumed);
           return true;
         case kDataConsumed:
           return false;
@@ -131,6 +181,12 @@ class Channel {
     static const uint8_t kDataProduced = 2;
     static const uint8_t kDataConsumed = 3;
 
+    /** Change the state, and wake up the other side. */
+    void setState(uint8_t state) {
+      mChannelState = state;
+      getEvent().notifyAll();
+    }
+
     uint8_t mChannelState = kWriterReady;
     T mValue;
     T mValueToWrite;
@@ -73,6 +73,111 @@ class ClockInterface {
     static unsigned long seconds() { return ::millis() / 1000; }
 };
 
+/**
+ * A clock which caches the millis() and micros() of the underlying T_CLOCK,
+ * so that the delay checks of all the coroutines in a pass of the scheduler
+ * share one reading instead of calling the clock each. The
+ * CoroutineSchedulerTemplate and the StaticScheduler call refreshPass() at
+ * the start of each pass over the coroutines (and each call to runAll()), and
+ * refreshDispatch() before each coroutine is run.
+ *
+ * A refresh only discards the cached values. The underlying clock is read
+ * again on the next call to millis() or micros(), so a pass in which no
+ * coroutine looks at the clock costs nothing, and millis() is never read by a
+ * program which uses only micros().
+ *
+ * With T_PER_DISPATCH set to false (the default), the clock is read at most
+ * once per pass. The snapshot is then older than the real time by up to the
+ * duration of a pass, so the error goes both ways: a delay starts early, and
+ * may therefore expire early relative to the real time, and its expiry may be
+ * noticed late. Set T_PER_DISPATCH to true to read the clock once per coroutine
+ * instead, which is exact as seen by each coroutine, and still saves the
+ * repeated readings in COROUTINE_DELAY() and the profiler layer.
+ *
+ * The cycles() function is not cached because it measures the run time of a
+ * coroutine. Code which calls millis() or micros() outside of the scheduler
+ * (e.g. with Direct Scheduling) must call refreshPass() itself.
+ *
+ * @tparam T_CLOCK the underlying clock, e.g. ClockInterface
+ * @tparam T_PER_DISPATCH refresh before each coroutine instead of each pass
+ */
+template <typename T_CLOCK, bool T_PER_DISPATCH = false>
+class SnapshotClockInterface {
+  public:
+    /** Get the millis of the current snapshot. */
+    static unsigned long millis() {
+      if (! (sValid & kValidMillis)) {
+        sMillis = T_CLOCK::millis();
+        sValid |= kValidMillis;
+      }
+      return sMillis;
+    }
+
+    /** Get the micros of the current snapshot. */
+    static unsigned long micros() {
+      if (! (sValid & kValidMicros)) {
+        sMicros = T_CLOCK::micros();
+        sValid |= kValidMicros;
+      }
+      return sMicros;
+    }
+
+    /** Get the seconds of the current snapshot. */
+    static unsigned long seconds() { return millis() / 1000; }
+
+    /** Get the cycles of the underlying clock, never cached. */
+    static unsigned long cycles() { return T_CLOCK::cycles(); }
+
+    /** Same as the underlying clock. */
+    static uint64_t cycles_per_second() {
+      return T_CLOCK::cycles_per_second();
+    }
+
+    /** Discard the snapshot at the start of a pass. */
+    static void refreshPass() { sValid = 0; }
+
+    /** Discard the snapshot before a coroutine is run, if T_PER_DISPATCH. */
+    static void refreshDispatch() {
+      if (T_PER_DISPATCH) sValid = 0;
+    }
+
+  private:
+    static const uint8_t kValidMillis = 0x01;
+    static const uint8_t kValidMicros = 0x02;
+
+    static unsigned long sMillis;
+    static unsigned long sMicros;
+    static uint8_t sValid;
+};
+
+template <typename T_CLOCK, bool T_PER_DISPATCH>
+unsigned long SnapshotClockInterface<T_CLOCK, T_PER_DISPATCH>::sMillis;
+
+template <typename T_CLOCK, bool T_PER_DISPATCH>
+unsigned long SnapshotClockInterface<T_CLOCK, T_PER_DISPATCH>::sMicros;
+
+template <typename T_CLOCK, bool T_PER_DISPATCH>
+uint8_t SnapshotClockInterface<T_CLOCK, T_PER_DISPATCH>::sValid;
+
+/**
+ * Called by the delay policies to refresh the clock T_CLOCK. Does nothing,
+ * except for a SnapshotClockInterface, so that other clocks do not need to
+ * provide refreshPass() and refreshDispatch().
+ */
+template <typename T_CLOCK>
+struct ClockSnapshot {
+  static void refreshPass() {}
+  static void refreshDispatch() {}
+};
+
+template <typename T_CLOCK, bool T_PER_DISPATCH>
+struct ClockSnapshot<SnapshotClockInterface<T_CLOCK, T_PER_DISPATCH>> {
+  typedef SnapshotClockInterface<T_CLOCK, T_PER_DISPATCH> Clock;
+
+  static void refreshPass() { Clock::refreshPass(); }
+  static void refreshDispatch() { Clock::refreshDispatch(); }
+};
+
 }
 
 #endif
@@ -39,6 +39,7 @@ static const char kStatusDelayingString[] PROGMEM = "Delaying";
 static const char kStatusRunningString[] PROGMEM = "Running";
 static const char kStatusEndingString[] PROGMEM = "Ending";
 static const char kStatusTerminatedString[] PROGMEM = "Terminated";
+static const char kStatusWaitingString[] PROGMEM = "Waiting";
 
 const __FlashStringHelper* const sStatusStrings[] = {
   FPSTR(kStatusSuspendedString),
@@ -47,6 +48,7 @@ const __FlashStringHelper* const sStatusStrings[] = {
   FPSTR(kStatusRunningString),
   FPSTR(kStatusEndingString),
   FPSTR(kStatusTerminatedString),
+  FPSTR(kStatusWaitingString),
 };
 
 }
@@ -26,8 +26,14 @@ SOFTWARE.
 #define ACE_ROUTINE_COROUTINE_H
 
 #include <stdint.h> // UINT16_MAX
+#include <new> // placement new
 #include <Print.h> // Print
 #include "ClockInterface.h"
+#include "CoroutineQueue.h"
+#include "CoroutinePool.h"
+#include "CoroutineState.h"
+#include "CoroutineTrace.h"
+#include "CoroutineUsage.h"
 
 class AceRoutineTest_statusStrings;
 class SuspendTest_suspendAndResume;
@@ -48,7 +54,25 @@ class SuspendTest_suspendAndResume;
  * The __noinline__ and __noclone__ attributes make sure that label pointers are
  * always the same. I'm not 100% sure they are needed here, but they don't seem
  * to hurt.
+ *
+ * If ACE_ROUTINE_RESUME_INDEX is defined to 1 before including this file, the
+ * continuation point is stored as an 8-bit index instead of a label pointer,
+ * and the macros resume the coroutine through a switch statement (Duff's
+ * device) instead of a computed goto. See COROUTINE_BEGIN().
+ */
+
+/**
+ * Select the resume backend of the coroutines. If 0 (the default), the
+ * continuation point is the address of a label (`void*`), used by a computed
+ * goto. If 1, it is an 8-bit index into a switch statement, which shares a
+ * 16-bit word with the status and saves the size of a pointer per coroutine
+ * (1 byte on AVR after padding, 4 bytes on 32-bit processors), but imposes
+ * the restrictions listed in COROUTINE_BEGIN(). All the files of a program
+ * must use the same value.
  */
+#if ! defined(ACE_ROUTINE_RESUME_INDEX)
+  #define ACE_ROUTINE_RESUME_INDEX 0
+#endif
 
 // https://stackoverflow.com/questions/295120
 /** Macro that indicates a deprecation. */
@@ -138,6 +162,96 @@ struct className##_##name : className { \
 }; \
 extern className##_##name name
 
+/**
+ * Declare the state of the coroutine, which is preserved across the
+ * COROUTINE_YIELD(), COROUTINE_DELAY(), etc, unlike its local variables. The
+ * argument is the type of the state, usually an unnamed struct, and the state
+ * is available as the `state` variable. It must appear before
+ * COROUTINE_BEGIN() or COROUTINE_LOOP(). For example:
+ *
+ * @code
+ * COROUTINE(StateCoroutine, counter) {
+ *   COROUTINE_STATE(struct { uint16_t i; });
+ *   COROUTINE_BEGIN();
+ *   for (state.i = 0; state.i < 10; state.i++) {
+ *     COROUTINE_DELAY(100);
+ *   }
+ *   COROUTINE_END();
+ * }
+ * @endcode
+ *
+ * Each instance has its own state, which is value-initialized (i.e. zeroed,
+ * or set by its default member initializers) when the coroutine starts, and
+ * after reset(). The type must be trivially destructible. The Coroutine type
+ * must include the Coroutine_State_Impl or the Coroutine_StateArena_Impl
+ * layer, which decides where the state is stored. If the state cannot be
+ * allocated, the coroutine returns without starting.
+ */
+#define COROUTINE_STATE(...) \
+    using CoroutineState = __VA_ARGS__; \
+    CoroutineState* const coroutineState = \
+        this->template acquireState<CoroutineState>(); \
+    if (coroutineState == nullptr) return 0; \
+    CoroutineState& state = *coroutineState
+
+#if ACE_ROUTINE_RESUME_INDEX
+
+/**
+ * Mark the beginning of a coroutine. With the resume index backend, this opens
+ * a switch statement on the index of the continuation point, which is closed
+ * by COROUTINE_END(). Each COROUTINE_YIELD_INTERNAL() adds a case label, whose
+ * value is derived from `__COUNTER__`. This implies that:
+ *
+ *  - COROUTINE_BEGIN() must be paired with COROUTINE_END(), and
+ *    COROUTINE_END() cannot be used inside COROUTINE_LOOP() (use
+ *    COROUTINE_BEGIN() followed by a while-loop, and `break` out of it),
+ *  - the coroutine cannot yield from within a switch statement of its own,
+ *  - the coroutine cannot yield past the declaration of a local variable with
+ *    an initializer in the same scope ("jump to case label crosses
+ *    initialization"),
+ *  - a coroutine can have at most 255 continuation points.
+ */
+#define COROUTINE_BEGIN() \
+    enum { kResumeBase = __COUNTER__ }; \
+    switch (this->getResume()) { \
+      case 0:
+
+/**
+ * Mark the beginning of a coroutine loop. Can be used instead of
+ * COROUTINE_BEGIN() at the beginning of a Coroutine. The body of the forever
+ * loop is the body of the switch statement, so COROUTINE_END() is not needed.
+ * The `default` label tells the compiler that every index enters the loop, so
+ * that it does not warn about the end of runCoroutine() being reachable.
+ */
+#define COROUTINE_LOOP() \
+    enum { kResumeBase = __COUNTER__ }; \
+    switch (this->getResume()) \
+      default: \
+      case 0: \
+        while (true)
+
+/**
+ * Implement the common logic for COROUTINE_YIELD(), COROUTINE_AWAIT(),
+ * COROUTINE_DELAY().
+ */
+#define COROUTINE_YIELD_INTERNAL() \
+    COROUTINE_YIELD_AT(__COUNTER__ - kResumeBase)
+
+/**
+ * Save the continuation point 'index', return, and resume at the case label of
+ * the same index. The `__COUNTER__` of the caller is expanded only once, when
+ * this macro's arguments are expanded.
+ */
+#define COROUTINE_YIELD_AT(index) \
+    do { \
+      static_assert((index) <= 255, "Too many continuation points"); \
+      this->setResume(index); \
+      return 0; \
+      case (index): ; \
+    } while (false)
+
+#else
+
 /** Mark the beginning of a coroutine. */
 #define COROUTINE_BEGIN() \
     void* p = this->getJump(); \
@@ -165,6 +279,8 @@ extern className##_##name name
       jumpLabel: ; \
     } while (false)
 
+#endif
+
 /** Yield execution to another coroutine. 
  *  bx: see definitions of profileExit and profileEnter in Coroutine32bit.h
  * */
@@ -267,6 +383,93 @@ extern className##_##name name
       this->profileEnterSeconds(); \
     } while (false)
 
+/**
+ * Yield until the next deadline of a fixed period of periodMillis. Unlike
+ * COROUTINE_DELAY(), the deadline advances by exactly one period from the
+ * previous deadline, instead of from the current time, so the run time of the
+ * coroutine and the lateness of the scheduler do not accumulate as drift.
+ * Requires the Coroutine_Periodic_Impl layer.
+ */
+#define COROUTINE_DELAY_PERIODIC(periodMillis) \
+    do { \
+      this->profileExit( ); \
+      this->setDelayPeriodicMillis(periodMillis); \
+      this->setDelaying(); \
+      do { \
+        COROUTINE_YIELD_INTERNAL(); \
+      } while (!this->isDelayExpired()); \
+      this->setRunning(); \
+      this->profileEnterMillis(); \
+    } while (false)
+
+/** Same as COROUTINE_DELAY_PERIODIC() with a period of periodMicros. */
+#define COROUTINE_DELAY_PERIODIC_MICROS(periodMicros) \
+    do { \
+      this->profileExit( ); \
+      this->setDelayPeriodicMicros(periodMicros); \
+      this->setDelaying(); \
+      do { \
+        COROUTINE_YIELD_INTERNAL(); \
+      } while (!this->isDelayMicrosExpired()); \
+      this->setRunning(); \
+      this->profileEnterMicros(); \
+    } while (false)
+
+/**
+ * Yield until the child coroutine has ended, i.e. isDone() is true, then
+ * execution continues. Equivalent to COROUTINE_JOIN_ALL(child).
+ */
+#define COROUTINE_JOIN(child) COROUTINE_JOIN_ALL(child)
+
+/**
+ * Yield until all the child coroutines have ended, then execution continues.
+ * The children are coroutine objects of the same Coroutine type as the
+ * caller. If one of them ended already, it is skipped.
+ *
+ * With the queued CoroutineScheduler, the caller is moved out of the ready
+ * list into the join list, and is woken up by the first child which reaches
+ * COROUTINE_END(), so it costs nothing per scheduler pass. It then waits
+ * again for the remaining children, if any. A child has at most one joiner in
+ * the join list. Another coroutine which joins the same child stays in the
+ * ready list, and polls the children on every pass instead.
+ * With the polling CoroutineScheduler, it is equivalent to
+ * `COROUTINE_AWAIT(a.isDone() && b.isDone() && ...)`.
+ *
+ * The children keep their member variables after they end, so the caller can
+ * read the results from them directly.
+ */
+#define COROUTINE_JOIN_ALL(...) \
+    do { \
+      this->profileExit(); \
+      this->setDelayZero(); \
+      while (! this->isAllDone(__VA_ARGS__)) { \
+        this->setWaiting(); \
+        this->joinAll(__VA_ARGS__); \
+        COROUTINE_YIELD_INTERNAL(); \
+      } \
+      this->setRunning(); \
+      this->profileEnterZero(); \
+    } while (false)
+
+#if ACE_ROUTINE_RESUME_INDEX
+
+/**
+ * Mark the end of a coroutine. Subsequent calls to Coroutine::runCoroutine()
+ * will do nothing. Closes the switch statement opened by COROUTINE_BEGIN().
+ */
+#define COROUTINE_END() \
+    COROUTINE_END_AT(__COUNTER__ - kResumeBase)
+
+/** Implement COROUTINE_END() with the continuation point 'index'. */
+#define COROUTINE_END_AT(index) \
+        this->setEnding(); \
+        this->setResume(index); \
+      case (index): ; \
+    } \
+    return 0
+
+#else
+
 /**
  * Mark the end of a coroutine. Subsequent calls to Coroutine::runCoroutine()
  * will do nothing.
@@ -280,6 +483,8 @@ extern className##_##name name
       return 0; \
     } while (false)
 
+#endif
+
 namespace ace_routine {
 
 /** A lookup table from Status integer to human-readable strings. */
@@ -288,6 +493,9 @@ extern const __FlashStringHelper* const sStatusStrings[];
 // Forward declaration of CoroutineSchedulerTemplate<T>
 template <typename T> class CoroutineSchedulerTemplate;
 
+// Forward declaration of StaticScheduler<T...>
+template <typename... T> class StaticScheduler;
+
 /**   bx:
  *    Base class for the Profiler. We need to declare it for the 
  *    dummy functions below.
@@ -308,16 +516,64 @@ class Profiler;
  */
 class UnnamedCoroutine {
   public:
+    /**
+     * The coroutine does not carry the intrusive queue links, so the
+     * CoroutineScheduler uses the polling mode. See Coroutine_Queue_Impl.
+     */
+    static const bool kHasQueue = false;
+
+    /**
+     * The coroutine cannot be spawned from a CoroutinePool, so the
+     * CoroutineScheduler never reclaims it. See Coroutine_Pool_Impl.
+     */
+    static const bool kHasPool = false;
+
+    /**
+     * The coroutine does not collect profiling statistics. Set to true by the
+     * Coroutine_Delay_32bit_Profiler_Impl layer.
+     */
+    static const bool kHasProfiler = false;
+
+    /**
+     * The CoroutineScheduler does not call setupCoroutine() by itself, see
+     * Coroutine_LazySetup_Impl.
+     */
+    static const bool kHasLazySetup = false;
+
+    /**
+     * The coroutine and the CoroutineScheduler do not record trace events.
+     * See Coroutine_Trace_Impl.
+     */
+    static const bool kHasTrace = false;
+
+    /**
+     * The CoroutineScheduler does not count the dispatches and the busy
+     * cycles of the coroutines. See Coroutine_Usage_Impl.
+     */
+    static const bool kHasUsage = false;
+
+    /**
+     * Nothing to release without a COROUTINE_STATE() layer. See
+     * Coroutine_State_Impl and Coroutine_StateArena_Impl.
+     */
+    void releaseState() {}
+
     const char* getName() const { return nullptr; }
     void setName( const char *_name ) { }
 
-    // dummy functions so user code compiles even with profiling off.
-    virtual void setWaitProfiler( Profiler *profiler ) { }
-    virtual void setRunProfiler ( Profiler *profiler ) { }
-    virtual Profiler* getWaitProfiler( ) { return nullptr; }
-    virtual Profiler* getRunProfiler ( ) { return nullptr; }
-    virtual bool printProfilingStats( Print& printer ) { return false; }
-    virtual void clearProfilingStats( ) { }
+    /**
+     * Dummy functions so user code compiles even with profiling off. They are
+     * not virtual: the profiler layer hides them with its own versions, and
+     * since the CoroutineSchedulerTemplate and the user code always hold the
+     * complete Coroutine type, the call is resolved at compile time. They add
+     * no vtable slots, and no code unless they are called.
+     */
+    void setWaitProfiler( Profiler *profiler ) { }
+    void setRunProfiler ( Profiler *profiler ) { }
+    Profiler* getWaitProfiler( ) { return nullptr; }
+    Profiler* getRunProfiler ( ) { return nullptr; }
+    bool printProfilingStats( Print& printer ) { return false; }
+    void clearProfilingStats( ) { }
 };
 
 /**
@@ -350,6 +606,30 @@ class Coroutine_Delay_16bit_Impl : public T_BASE {
     static unsigned long coroutineMicros()  {   return T_CLOCK::micros();    }
     static unsigned long coroutineSeconds() {   return T_CLOCK::seconds();   }
     static unsigned long coroutineCycles()  {   return T_CLOCK::cycles();    }
+    static uint64_t coroutineCyclesPerSecond() {
+      return T_CLOCK::cycles_per_second();
+    }
+
+    /** Refresh a SnapshotClockInterface at the start of a pass. */
+    static void coroutineSnapshotPass() {
+      ClockSnapshot<T_CLOCK>::refreshPass();
+    }
+
+    /** Refresh a SnapshotClockInterface before running a coroutine. */
+    static void coroutineSnapshotDispatch() {
+      ClockSnapshot<T_CLOCK>::refreshDispatch();
+    }
+
+    /**
+     * The unit of mDelayStart and mDelayDuration depends on which
+     * COROUTINE_DELAY*() macro was used, so the absolute wake time cannot be
+     * recovered, and the queued CoroutineScheduler must keep polling delaying
+     * coroutines of this type.
+     */
+    static const bool kHasWakeTime = false;
+
+    /** Not available, see kHasWakeTime. */
+    uint32_t getDelayWakeMicros() const { return 0; }
 
     /** Check if delay millis time is over. */
     bool isDelayExpired() const {
@@ -430,6 +710,9 @@ class Coroutine_Delay_16bit_Impl : public T_BASE {
      */
     void setDelayZero() {}
 
+    /** Periodic delays are not supported by this policy, nothing to reset. */
+    void resetPeriod() {}
+
     /** bx:
      * ...and if the profiler is enabled, this will look at the timestamp
      * recorded by setDelay() and thus the profiler will know how long we
@@ -465,6 +748,7 @@ class Coroutine_Delay_16bit_Impl : public T_BASE {
 template <typename T_BASE>
 class CoroutineTemplate : public T_BASE {
   friend class CoroutineSchedulerTemplate<CoroutineTemplate<T_BASE>>;
+  template <typename... T> friend class StaticScheduler;
   friend class ::AceRoutineTest_statusStrings;
   friend class ::SuspendTest_suspendAndResume;
 
@@ -510,6 +794,8 @@ class CoroutineTemplate : public T_BASE {
     void suspend() {
       if (isDone()) return;
       mStatus = kStatusSuspended;
+      noteStatus();
+      park(SchedulingMode<T_BASE::kHasQueue>());
     }
 
     /**
@@ -527,6 +813,8 @@ class CoroutineTemplate : public T_BASE {
       // COROUTINE_DELAY() and COROUTINE_AWAIT() are written to restore their
       // status.
       mStatus = kStatusYielding;
+      noteStatus();
+      makeReady(SchedulingMode<T_BASE::kHasQueue>());
     }
 
     /**
@@ -543,8 +831,26 @@ class CoroutineTemplate : public T_BASE {
      * Coroutine upon the next iteration.
      */
     void reset() {
+      this->releaseState();
       mStatus = kStatusYielding;
+    #if ACE_ROUTINE_RESUME_INDEX
+      mResume = 0;
+    #else
       mJumpPoint = nullptr;
+    #endif
+      this->resetPeriod();
+      noteStatus();
+      makeReady(SchedulingMode<T_BASE::kHasQueue>());
+    }
+
+    /**
+     * Set the priority level of the coroutine, from 0 (the default, lowest)
+     * to `kNumPriorities - 1` (highest). It can be called from the
+     * constructor of the coroutine. Available only if the Coroutine type
+     * includes the Coroutine_Queue_Impl layer.
+     */
+    void setPriority(uint8_t priority) {
+      RunQueues<CoroutineTemplate>::getInstance()->setPriority(this, priority);
     }
 
     /** The coroutine was suspended with a call to suspend(). */
@@ -556,6 +862,9 @@ class CoroutineTemplate : public T_BASE {
     /** The coroutine returned using COROUTINE_DELAY(). */
     bool isDelaying() const { return mStatus == kStatusDelaying; }
 
+    /** The coroutine returned using COROUTINE_AWAIT_EVENT(). */
+    bool isWaiting() const { return mStatus == kStatusWaiting; }
+
     /** The coroutine is currently running. True only within the coroutine. */
     bool isRunning() const { return mStatus == kStatusRunning; }
 
@@ -651,6 +960,9 @@ class CoroutineTemplate : public T_BASE {
      *              v
      *         Terminated
      * @endverbatim
+     *
+     * The Waiting state of COROUTINE_AWAIT_EVENT() is a variant of Yielding,
+     * with the same transitions.
      */
     typedef uint8_t Status;
 
@@ -677,6 +989,13 @@ class CoroutineTemplate : public T_BASE {
     /** Coroutine has ended and no longer in the scheduler queue. */
     static const Status kStatusTerminated = 5;
 
+    /**
+     * Coroutine returned using the COROUTINE_AWAIT_EVENT() statement. It
+     * behaves like Yielding, except that the queued CoroutineScheduler does
+     * not run it until the event is notified.
+     */
+    static const Status kStatusWaiting = 6;
+
     /** Constructor. Automatically insert self into singly-linked list. */
     CoroutineTemplate() {
       insertAtRoot();
@@ -704,6 +1023,19 @@ class CoroutineTemplate : public T_BASE {
       printer.print(sStatusStrings[mStatus]);
     }
 
+  #if ACE_ROUTINE_RESUME_INDEX
+    /**
+     * Index of the case label where execution will start on the next call to
+     * runCoroutine(). 0 is the beginning of the coroutine.
+     */
+    void setResume(uint8_t index) { mResume = index; }
+
+    /**
+     * Index of the case label where execution will start on the next call to
+     * runCoroutine().
+     */
+    uint8_t getResume() const { return mResume; }
+  #else
     /**
      * Pointer to label where execute will start on the next call to
      * runCoroutine().
@@ -715,28 +1047,99 @@ class CoroutineTemplate : public T_BASE {
      * runCoroutine().
      */
     void* getJump() const { return mJumpPoint; }
+  #endif
 
     /** Set the kStatusRunning state. */
-    void setRunning() { mStatus = kStatusRunning; }
+    void setRunning() {
+      mStatus = kStatusRunning;
+      noteStatus();
+    }
 
-    /** Set the kStatusDelaying state. */
-    void setYielding() { mStatus = kStatusYielding; }
+    /** Set the kStatusYielding state. */
+    void setYielding() {
+      mStatus = kStatusYielding;
+      noteStatus();
+    }
 
     /** Set the kStatusDelaying state. */
-    void setDelaying() { mStatus = kStatusDelaying; }
+    void setDelaying() {
+      mStatus = kStatusDelaying;
+      noteStatus();
+    }
 
-    /** Set the kStatusEnding state. */
-    void setEnding() { mStatus = kStatusEnding; }
+    /**
+     * Set the kStatusEnding state, release the COROUTINE_STATE(), which is
+     * no longer used, and wake up the coroutine in COROUTINE_JOIN(), if any.
+     */
+    void setEnding() {
+      mStatus = kStatusEnding;
+      noteStatus();
+      this->releaseState();
+      notifyJoiner(SchedulingMode<T_BASE::kHasQueue>());
+    }
+
+    /** Used by COROUTINE_JOIN_ALL(). Return true if all children are done. */
+    static bool isAllDone() { return true; }
+
+    /** Used by COROUTINE_JOIN_ALL(). Return true if all children are done. */
+    template <typename T_CHILD, typename... T_REST>
+    static bool isAllDone(const T_CHILD& child, const T_REST&... rest) {
+      return child.isDone() && isAllDone(rest...);
+    }
 
     /**
-     * Set status to indicate that the Coroutine has been removed from the
-     * Scheduler queue. Should be used only by the CoroutineScheduler.
+     * Used by COROUTINE_JOIN_ALL(). Become the joiner of the children, and
+     * move into the join list of the queued CoroutineScheduler.
+     */
+    template <typename... T_CHILDREN>
+    void joinAll(T_CHILDREN&... children) {
+      joinChildren(SchedulingMode<T_BASE::kHasQueue>(), children...);
+    }
+
+    /**
+     * Return the state declared by COROUTINE_STATE(). Before the coroutine
+     * starts, i.e. before its first continuation point, a new state is
+     * created. Return nullptr if it cannot be allocated, or if the coroutine
+     * has ended.
      */
-    void setTerminated() { mStatus = kStatusTerminated; }
+    template <typename T_STATE>
+    T_STATE* acquireState() {
+      static_assert(__has_trivial_destructor(T_STATE),
+          "COROUTINE_STATE() must be trivially destructible");
+      if (isStarted()) {
+        return static_cast<T_STATE*>(this->getStateBlock());
+      }
+      void* block = this->template allocateStateBlock<sizeof(T_STATE)>();
+      if (block == nullptr) return nullptr;
+      return new (block) T_STATE();
+    }
 
+    /** Set the kStatusWaiting state. */
+    void setWaiting() {
+      mStatus = kStatusWaiting;
+      noteStatus();
+    }
 
+    /**
+     * Set status to indicate that the Coroutine has been removed from the
+     * Scheduler queue. Should be used only by the CoroutineScheduler.
+     */
+    void setTerminated() {
+      mStatus = kStatusTerminated;
+      noteStatus();
+      park(SchedulingMode<T_BASE::kHasQueue>());
+    }
 
   private:
+    /** Return true if the coroutine has passed a continuation point. */
+    bool isStarted() const {
+    #if ACE_ROUTINE_RESUME_INDEX
+      return mResume != 0;
+    #else
+      return mJumpPoint != nullptr;
+    #endif
+    }
+
     // Disable copy-constructor and assignment operator
     CoroutineTemplate(const CoroutineTemplate&) = delete;
     CoroutineTemplate& operator=(const CoroutineTemplate&) = delete;
@@ -753,15 +1156,101 @@ class CoroutineTemplate : public T_BASE {
       *root = this;
     }
 
+    /** Nothing to do if there are no scheduler queues. */
+    void makeReady(SchedulingMode<false>) {}
+
+    /** Move into the ready list of the queued CoroutineScheduler. */
+    void makeReady(SchedulingMode<true>) {
+      RunQueues<CoroutineTemplate>::getInstance()->makeReady(this);
+    }
+
+    /** Nothing to do if there are no scheduler queues. */
+    void park(SchedulingMode<false>) {}
+
+    /** Move into the parked list of the queued CoroutineScheduler. */
+    void park(SchedulingMode<true>) {
+      RunQueues<CoroutineTemplate>::getInstance()->park(this);
+    }
+
+    /** Nothing to do, the joiner polls the children. */
+    template <typename... T_CHILDREN>
+    void joinChildren(SchedulingMode<false>, T_CHILDREN&...) {}
+
+    /**
+     * Become the joiner of the children, and wait in the join list. If one of
+     * them is already joined by another coroutine, stay in the ready list and
+     * poll the children instead, as in the polling mode.
+     */
+    template <typename... T_CHILDREN>
+    void joinChildren(SchedulingMode<true>, T_CHILDREN&... children) {
+      if (claimChildren(children...)) {
+        RunQueues<CoroutineTemplate>::getInstance()->waitJoin(this);
+      }
+    }
+
+    /** Return true if every child is done or will notify this coroutine. */
+    bool claimChildren() { return true; }
+
+    /** Become the joiner of the first child, then of the others. */
+    template <typename... T_REST>
+    bool claimChildren(CoroutineTemplate& child, T_REST&... rest) {
+      // A child which has ended will never notify its joiner.
+      bool claimed = child.isDone()
+          || RunQueues<CoroutineTemplate>::getInstance()->setJoiner(
+              &child, this);
+      return claimChildren(rest...) && claimed;
+    }
+
+    /** Notify the optional trace and usage layers of a new status. */
+    void noteStatus() {
+      traceStatus(TraceMode<T_BASE::kHasTrace>());
+      countStatus(UsageMode<T_BASE::kHasUsage>());
+    }
+
+    /** Nothing to record without the Coroutine_Trace_Impl layer. */
+    void traceStatus(TraceMode<false>) {}
+
+    /** Record the new status into the TraceRing, if any. */
+    void traceStatus(TraceMode<true>) {
+      CoroutineTrace<CoroutineTemplate>::getInstance()->record(this, mStatus);
+    }
+
+    /** Nothing to count without the Coroutine_Usage_Impl layer. */
+    static void countStatus(UsageMode<false>) {}
+
+    /** Tell the scheduler that the dispatch was not an idle pass. */
+    static void countStatus(UsageMode<true>) {
+      CoroutineUsageCounter<CoroutineTemplate>::getInstance()->noteTransition();
+    }
+
+    /** Nothing to do, the joiner polls the children. */
+    void notifyJoiner(SchedulingMode<false>) {}
+
+    /** Wake up the joiner, if any. */
+    void notifyJoiner(SchedulingMode<true>) {
+      RunQueues<CoroutineTemplate>::getInstance()->notifyJoiner(this);
+    }
+
   protected:
     /** Pointer to the next coroutine in a singly-linked list. */
     CoroutineTemplate* mNext = nullptr;
 
+  #if ACE_ROUTINE_RESUME_INDEX
+    /** Run-state of the coroutine. */
+    Status mStatus = kStatusYielding;
+
+    /**
+     * Index of the continuation point. Shares a 16-bit word with mStatus,
+     * instead of a full pointer followed by a padded byte.
+     */
+    uint8_t mResume = 0;
+  #else
     /** Address of the label used by the computed-goto. */
     void* mJumpPoint = nullptr;
 
     /** Run-state of the coroutine. */
     Status mStatus = kStatusYielding;
+  #endif
 
 };
 
@@ -20,6 +20,34 @@ class Coroutine_Delay_32bit_Impl : public T_BASE  {
     static unsigned long coroutineMicros()  {   return T_CLOCK::micros();    }
     static unsigned long coroutineSeconds() {   return T_CLOCK::seconds();   }
     static unsigned long coroutineCycles()  {   return T_CLOCK::cycles();    }
+    static uint64_t coroutineCyclesPerSecond() {
+      return T_CLOCK::cycles_per_second();
+    }
+
+    /** Refresh a SnapshotClockInterface at the start of a pass. */
+    static void coroutineSnapshotPass() {
+      ClockSnapshot<T_CLOCK>::refreshPass();
+    }
+
+    /** Refresh a SnapshotClockInterface before running a coroutine. */
+    static void coroutineSnapshotDispatch() {
+      ClockSnapshot<T_CLOCK>::refreshDispatch();
+    }
+
+    /**
+     * All delays are stored in micros, so the absolute wake time is known and
+     * the queued CoroutineScheduler can keep delaying coroutines in its
+     * SleepQueue instead of polling them.
+     */
+    static const bool kHasWakeTime = true;
+
+    /**
+     * Return the micros() at which the current delay expires. Only meaningful
+     * while the coroutine is delaying.
+     */
+    uint32_t getDelayWakeMicros() const {
+      return mDelayStart + mDelayDuration;
+    }
 
     /**
      *    All functions store delays as 32 bit micros.
@@ -66,6 +94,7 @@ class Coroutine_Delay_32bit_Impl : public T_BASE  {
      *    Profiler functions are in the next class.
      */
     void setDelayZero() {}
+    void resetPeriod() {}
     void profileEnterMillis ( ) {}
     void profileEnterMicros ( ) {}
     void profileEnterSeconds( ) {}
@@ -102,6 +131,8 @@ class Coroutine_Delay_32bit_Profiler_Impl: public Coroutine_Delay_32bit_Impl<T_B
     Profiler *mRunProfiler = nullptr;
 
   public:
+    /** This layer collects profiling statistics. */
+    static const bool kHasProfiler = true;
 
     void setWaitProfiler( Profiler *profiler ) { mWaitProfiler = profiler; profiler->begin( this->getName(), "wait", 1000000 ); }
     void setRunProfiler ( Profiler *profiler ) { mRunProfiler  = profiler; profiler->begin( this->getName(), "run" , T_CLOCK::cycles_per_second() ); }
@@ -148,13 +179,110 @@ class Coroutine_Delay_32bit_Profiler_Impl: public Coroutine_Delay_32bit_Impl<T_B
      *  mDelayStart. So, we don't need to call micros() again.
      */
     void profileExit( ) {
-      unsigned long ticks = T_CLOCK::cycles();
+      // mDelayStart holds the low 32 bits of a 64-bit cycles(), e.g. the
+      // TscClockInterface on Linux, so the difference is taken on 32 bits.
+      uint32_t ticks = (uint32_t) T_CLOCK::cycles();
       if( mRunProfiler )
-        mRunProfiler->profileRun( ticks - this->mDelayStart );
+        mRunProfiler->profileRun( (uint32_t) (ticks - this->mDelayStart) );
     }
 };
 
 
+/**
+ * Catch-up policies of Coroutine_Periodic_Impl, used when one or more periods
+ * were missed because the coroutine ran too late.
+ */
+struct PeriodicCatchUp {
+  /** Drop the missed periods, and wait for the next deadline in phase. */
+  static const uint8_t kSkip = 0;
+
+  /** Run the missed periods back to back until the deadline is caught up. */
+  static const uint8_t kBurst = 1;
+
+  /** Same as kSkip, but count the missed periods in getPeriodOverruns(). */
+  static const uint8_t kCount = 2;
+};
+
+/**
+ *    This layer goes on top of Coroutine_Delay_32bit_Impl or
+ *    Coroutine_Delay_32bit_Profiler_Impl, and adds the
+ *    COROUTINE_DELAY_PERIODIC() and COROUTINE_DELAY_PERIODIC_MICROS() macros.
+ *
+ *    COROUTINE_DELAY() restarts the delay from the current time, so the run
+ *    time of the loop body and any lateness of the scheduler accumulate as
+ *    drift. A periodic delay instead advances an absolute deadline by exactly
+ *    one period each time, so the average rate is exact. The first periodic
+ *    delay (and the first one after reset()) is anchored at the current time.
+ *
+ *    The deadline is expressed as a regular delay which started one period
+ *    before it, so the profiler's profileWait() receives the lateness with
+ *    respect to the deadline, and the queued CoroutineScheduler sees the
+ *    deadline as the wake time.
+ *
+ * @tparam T_DELAY one of the 32-bit delay policies
+ * @tparam T_CATCH_UP one of the PeriodicCatchUp constants
+ */
+template <typename T_DELAY, uint8_t T_CATCH_UP = PeriodicCatchUp::kSkip>
+class Coroutine_Periodic_Impl : public T_DELAY {
+  public:
+    /** Wait until the next deadline, periodMillis after the previous one. */
+    void setDelayPeriodicMillis(uint16_t periodMillis) {
+      setDelayPeriodicMicros((uint32_t) periodMillis * 1000);
+    }
+
+    /** Wait until the next deadline, periodMicros after the previous one. */
+    void setDelayPeriodicMicros(uint32_t periodMicros) {
+      uint32_t nowMicros = this->coroutineMicros();
+      if (periodMicros >= UINT32_MAX / 2) periodMicros = UINT32_MAX / 2;
+      if (periodMicros == 0) periodMicros = 1;
+
+      uint32_t deadline = mPeriodStarted
+          ? mPeriodDeadline + periodMicros
+          : nowMicros + periodMicros;
+      mPeriodStarted = true;
+
+      int32_t lateMicros = (int32_t) (nowMicros - deadline);
+      if (lateMicros > 0 && T_CATCH_UP != PeriodicCatchUp::kBurst) {
+        uint32_t missed = (uint32_t) lateMicros / periodMicros + 1;
+        deadline += missed * periodMicros;
+        if (T_CATCH_UP == PeriodicCatchUp::kCount) {
+          mPeriodOverruns = (mPeriodOverruns + missed > UINT16_MAX)
+              ? UINT16_MAX
+              : mPeriodOverruns + missed;
+        }
+      }
+      mPeriodDeadline = deadline;
+
+      this->mDelayStart = deadline - periodMicros;
+      this->mDelayDuration = periodMicros;
+    }
+
+    /** Anchor the next periodic delay at the current time. */
+    void resetPeriod() { mPeriodStarted = false; }
+
+    /** Return the deadline of the current periodic delay. */
+    uint32_t getPeriodDeadline() const { return mPeriodDeadline; }
+
+    /**
+     * Return the number of missed periods, saturated at UINT16_MAX. Counted
+     * only with PeriodicCatchUp::kCount.
+     */
+    uint16_t getPeriodOverruns() const { return mPeriodOverruns; }
+
+    /** Clear the number of missed periods. */
+    void clearPeriodOverruns() { mPeriodOverruns = 0; }
+
+  protected:
+    /** Absolute deadline of the current (or last) periodic delay. */
+    uint32_t mPeriodDeadline = 0;
+
+    /** Number of missed periods for PeriodicCatchUp::kCount. */
+    uint16_t mPeriodOverruns = 0;
+
+    /** False until the first periodic delay, and after reset(). */
+    bool mPeriodStarted = false;
+};
+
 }
 
 #endif
@@ -0,0 +1,174 @@
+/*
+MIT License
+
+Copyright (c) 2021 Brian T. Park
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ACE_ROUTINE_COROUTINE_COMPACT_H
+#define ACE_ROUTINE_COROUTINE_COMPACT_H
+
+#include <stdint.h>
+
+namespace ace_routine {
+
+/**
+ *    This is one possible base class for Coroutine.
+ *
+ *    Compact delay implementation. Instead of a start time and a duration,
+ *    a single T_WORD holds the absolute wake time, in the unit of the
+ *    COROUTINE_DELAY*() macro which was used, in its upper bits, and that unit
+ *    in its lowest 2 bits. The millis, micros and seconds delays then share
+ *    the same expiration check, which is a single subtraction from the
+ *    current time and a test of the sign bit, with no multiplication.
+ *
+ *    With T_WORD = uint32_t (the default), a delay takes the same 4 bytes as
+ *    Coroutine_Delay_16bit_Impl, but can be as long as 2^29 - 1 units (about
+ *    6 days in millis, or 536 seconds in micros). With T_WORD = uint16_t, it
+ *    takes 2 bytes, for a maximum of 8191 units. Longer delays are clamped to
+ *    the maximum.
+ *
+ *    Like with the 16-bit delays, the time between two successive checks of
+ *    a delaying coroutine must be shorter than the maximum delay, otherwise
+ *    the wake time is seen in the future again. The unit of the wake time is
+ *    lost when converted to micros, so the queued CoroutineScheduler must keep
+ *    polling the delaying coroutines of this type.
+ *
+ * @tparam T_BASE the UnnamedCoroutine or NamedCoroutine
+ * @tparam T_CLOCK the clock, e.g. ClockInterface
+ * @tparam T_WORD the unsigned type of the wake time, uint16_t or uint32_t
+ */
+template <typename T_BASE, typename T_CLOCK, typename T_WORD = uint32_t>
+class Coroutine_Delay_Compact_Impl : public T_BASE {
+  public:
+    static unsigned long coroutineMillis()  {   return T_CLOCK::millis();    }
+    static unsigned long coroutineMicros()  {   return T_CLOCK::micros();    }
+    static unsigned long coroutineSeconds() {   return T_CLOCK::seconds();   }
+    static unsigned long coroutineCycles()  {   return T_CLOCK::cycles();    }
+    static uint64_t coroutineCyclesPerSecond() {
+      return T_CLOCK::cycles_per_second();
+    }
+
+    /** Refresh a SnapshotClockInterface at the start of a pass. */
+    static void coroutineSnapshotPass() {
+      ClockSnapshot<T_CLOCK>::refreshPass();
+    }
+
+    /** Refresh a SnapshotClockInterface before running a coroutine. */
+    static void coroutineSnapshotDispatch() {
+      ClockSnapshot<T_CLOCK>::refreshDispatch();
+    }
+
+    /** The wake time is not known in micros, see above. */
+    static const bool kHasWakeTime = false;
+
+    /** Not available, see kHasWakeTime. */
+    uint32_t getDelayWakeMicros() const { return 0; }
+
+    /** Unit of the delay, stored in the lowest bits of mDelayWake. */
+    static const uint8_t kUnitMillis = 0;
+    static const uint8_t kUnitMicros = 1;
+    static const uint8_t kUnitSeconds = 2;
+
+    /** Longest delay, in any unit. */
+    static const T_WORD kMaxDelay = ((T_WORD) 1 << (sizeof(T_WORD) * 8 - 3)) - 1;
+
+    /** Return the unit of the current delay. */
+    uint8_t getDelayUnit() const { return mDelayWake & kUnitMask; }
+
+    /**
+     * Check if the delay is over, whatever its unit. Used by all the
+     * COROUTINE_DELAY*() macros.
+     */
+    bool isDelayExpired() const {
+      unsigned long now;
+      switch (getDelayUnit()) {
+        case kUnitMicros: now = coroutineMicros(); break;
+        case kUnitSeconds: now = coroutineSeconds(); break;
+        default: now = coroutineMillis(); break;
+      }
+      return isExpiredAt(now);
+    }
+
+    /** Same as isDelayExpired(). */
+    bool isDelayMicrosExpired() const { return isDelayExpired(); }
+
+    /** Same as isDelayExpired(). */
+    bool isDelaySecondsExpired() const { return isDelayExpired(); }
+
+    /** Configure the delay timer for delayMillis, up to kMaxDelay. */
+    void setDelayMillis(uint32_t delayMillis) {
+      setDelay(coroutineMillis(), delayMillis, kUnitMillis);
+    }
+
+    /** Configure the delay timer for delayMicros, up to kMaxDelay. */
+    void setDelayMicros(uint32_t delayMicros) {
+      setDelay(coroutineMicros(), delayMicros, kUnitMicros);
+    }
+
+    /** Configure the delay timer for delaySeconds, up to kMaxDelay. */
+    void setDelaySeconds(uint32_t delaySeconds) {
+      setDelay(coroutineSeconds(), delaySeconds, kUnitSeconds);
+    }
+
+    /** Profiling is not supported by this policy. */
+    void setDelayZero() {}
+
+    /** Periodic delays are not supported by this policy, nothing to reset. */
+    void resetPeriod() {}
+
+    void profileEnterZero() {}
+    void profileEnterMillis () {}
+    void profileEnterMicros () {}
+    void profileEnterSeconds() {}
+    void profileExit( ) {}
+
+  protected:
+    /** Number of low bits of mDelayWake which hold the unit. */
+    static const uint8_t kUnitBits = 2;
+    static const T_WORD kUnitMask = (1 << kUnitBits) - 1;
+    static const T_WORD kSignBit = (T_WORD) 1 << (sizeof(T_WORD) * 8 - 1);
+
+    /** Set the wake time to now + delay, in the given unit. */
+    void setDelay(unsigned long now, uint32_t delay, uint8_t unit) {
+      // If delay is a compile-time constant, the compiler should optimize away
+      // this bounds checking code.
+      if (delay > kMaxDelay) delay = kMaxDelay;
+      mDelayWake = (T_WORD) (((now + delay) << kUnitBits) | unit);
+    }
+
+    /**
+     * The wake time is reached if `now - wake`, computed modulo the width of
+     * the time field, is not negative. Shifting `now` into the upper bits
+     * makes the sign of that field the sign bit of T_WORD.
+     */
+    bool isExpiredAt(unsigned long now) const {
+      T_WORD diff = (T_WORD) ((T_WORD) (now << kUnitBits)
+          - (T_WORD) (mDelayWake & ~kUnitMask));
+      return (diff & kSignBit) == 0;
+    }
+
+    /** Wake time in its upper bits, unit in its lowest kUnitBits. */
+    T_WORD mDelayWake;
+};
+
+}
+
+#endif
@@ -0,0 +1,321 @@
+/*
+MIT License
+
+Copyright (c) 2021 Brian T. Park
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ACE_ROUTINE_COROUTINE_NATIVE_H
+#define ACE_ROUTINE_COROUTINE_NATIVE_H
+
+/**
+ * @file CoroutineNative.h
+ *
+ * A backend of CoroutineTemplate built on the C++20 coroutines, for the
+ * compilers which support them (e.g. EpoxyDuino on Linux with
+ * `-std=gnu++20`). ACE_ROUTINE_NATIVE_COROUTINE is defined to 1 if it is
+ * available, 0 otherwise. On the usual Arduino toolchains (C++11), this file
+ * is empty.
+ */
+
+#if defined(__cplusplus) && __cplusplus >= 202002L && defined(__has_include)
+  #if __has_include(<coroutine>)
+    #define ACE_ROUTINE_NATIVE_COROUTINE 1
+  #endif
+#endif
+
+#if ! defined(ACE_ROUTINE_NATIVE_COROUTINE)
+  #define ACE_ROUTINE_NATIVE_COROUTINE 0
+#endif
+
+#if ACE_ROUTINE_NATIVE_COROUTINE
+
+#include <stddef.h> // size_t
+#include <stdint.h>
+#include <coroutine>
+#include <exception> // std::terminate()
+#include "Coroutine.h"
+#include "FrameArena.h"
+
+namespace ace_routine {
+
+/**
+ * The return type of NativeCoroutineTemplate::run(). It transfers the handle
+ * of the new frame to the NativeCoroutineTemplate, and is not meant to be
+ * used directly.
+ */
+class NativeTask {
+  public:
+    struct promise_type {
+      /**
+       * Allocate the frame from the FrameArena of the coroutine object, which
+       * is the implicit first argument of its run() method.
+       */
+      template <typename T>
+      static void* operator new(size_t size, T& self) noexcept {
+        return self.getFrameArena().allocateFrame(size);
+      }
+
+      static void operator delete(void* frame) noexcept {
+        FrameArena::deallocateFrame(frame);
+      }
+
+      static NativeTask get_return_object_on_allocation_failure() noexcept {
+        return NativeTask(nullptr);
+      }
+
+      NativeTask get_return_object() noexcept {
+        return NativeTask(
+            std::coroutine_handle<promise_type>::from_promise(*this));
+      }
+
+      /** Run the body until its first suspension when it is created. */
+      std::suspend_never initial_suspend() noexcept { return {}; }
+
+      /** Keep the frame, so that done() can be tested. */
+      std::suspend_always final_suspend() noexcept { return {}; }
+
+      void return_void() noexcept {}
+
+      void unhandled_exception() noexcept { std::terminate(); }
+    };
+
+    explicit NativeTask(std::coroutine_handle<> handle) : mHandle(handle) {}
+
+    /** Return the handle of the frame, nullptr if the allocation failed. */
+    std::coroutine_handle<> getHandle() const { return mHandle; }
+
+  private:
+    std::coroutine_handle<> mHandle;
+};
+
+/**
+ * A CoroutineTemplate whose body is a C++20 coroutine, instead of the
+ * runCoroutine() method written with the COROUTINE_*() macros. The local
+ * variables of the body are kept in its frame, which is allocated from a
+ * FrameArena when the coroutine starts, and released when it ends or is
+ * reset(). So the state of a coroutine does not need to be stored in static
+ * variables, and a class can have any number of instances.
+ *
+ * The body is the run() method, which suspends itself using co_await:
+ *
+ * @code
+ * class Blinker : public NativeCoroutine {
+ *   public:
+ *     Blinker(FrameArena& arena, int pin) :
+ *         NativeCoroutine(arena), mPin(pin) {}
+ *
+ *     NativeTask run() override {
+ *       while (true) {
+ *         digitalWrite(mPin, HIGH);
+ *         co_await coroutineDelay(100);
+ *         digitalWrite(mPin, LOW);
+ *         co_await coroutineDelay(500);
+ *       }
+ *     }
+ *
+ *   private:
+ *     int mPin;
+ * };
+ * @endcode
+ *
+ * The coroutine is in the same singly-linked list as the other coroutines of
+ * the same CoroutineTemplate<T_BASE>, and is run by the same
+ * CoroutineSchedulerTemplate. The delays are implemented by the delay policy
+ * of T_BASE. COROUTINE_AWAIT(), COROUTINE_DELAY_PERIODIC() and the events and
+ * channels are not available. If the frame cannot be allocated, the coroutine
+ * ends immediately.
+ *
+ * @tparam T_BASE the delay policy and its bases, as for CoroutineTemplate
+ */
+template <typename T_BASE>
+class NativeCoroutineTemplate : public CoroutineTemplate<T_BASE> {
+  public:
+    /** Create a coroutine whose frames are allocated from 'arena'. */
+    explicit NativeCoroutineTemplate(FrameArena& arena) : mArena(arena) {}
+
+    /** Release the frame, if any. */
+    ~NativeCoroutineTemplate() { destroyFrame(); }
+
+    /** The body of the coroutine. */
+    virtual NativeTask run() = 0;
+
+    /**
+     * Start the body on the first call, then resume it from its last
+     * co_await, unless its delay has not expired.
+     */
+    int runCoroutine() override {
+      if (this->isDone()) return 0;
+
+      if (! isStarted()) {
+        destroyFrame();
+        markStarted();
+        mWait = kWaitStart;
+        mHandle = run().getHandle();
+        if (! mHandle) {
+          this->setEnding();
+          return 0;
+        }
+      } else {
+        switch (mWait) {
+          case kWaitMillis:
+            if (! this->isDelayExpired()) return 0;
+            this->setRunning();
+            this->profileEnterMillis();
+            break;
+          case kWaitMicros:
+            if (! this->isDelayMicrosExpired()) return 0;
+            this->setRunning();
+            this->profileEnterMicros();
+            break;
+          case kWaitSeconds:
+            if (! this->isDelaySecondsExpired()) return 0;
+            this->setRunning();
+            this->profileEnterSeconds();
+            break;
+          default:
+            this->setRunning();
+            this->profileEnterZero();
+            break;
+        }
+        mHandle.resume();
+      }
+
+      if (mHandle.done()) {
+        destroyFrame();
+        this->setEnding();
+      }
+      return 0;
+    }
+
+    /**
+     * Reset the coroutine to its initial state, and release its frame. A
+     * coroutine reset through its CoroutineTemplate releases its frame on the
+     * next runCoroutine() instead.
+     */
+    void reset() {
+      destroyFrame();
+      CoroutineTemplate<T_BASE>::reset();
+    }
+
+    /** The arena of the frames of this coroutine. */
+    FrameArena& getFrameArena() const { return mArena; }
+
+  protected:
+    /** Yield to the other coroutines. Use as `co_await coroutineYield()`. */
+    std::suspend_always coroutineYield() {
+      this->profileExit();
+      this->setDelayZero();
+      this->setYielding();
+      mWait = kWaitZero;
+      return {};
+    }
+
+    /**
+     * Yield for delayMillis, with the same limits as COROUTINE_DELAY(). Use
+     * as `co_await coroutineDelay(delayMillis)`. A value larger than the
+     * delay policy accepts is clamped to its maximum, e.g. 32767 milliseconds
+     * with Coroutine_Delay_16bit_Impl, instead of being truncated.
+     */
+    std::suspend_always coroutineDelay(uint32_t delayMillis) {
+      this->profileExit();
+      this->setDelayMillis(clampDelay(&T_BASE::setDelayMillis, delayMillis));
+      this->setDelaying();
+      mWait = kWaitMillis;
+      return {};
+    }
+
+    /**
+     * Yield for delayMicros, same as COROUTINE_DELAY_MICROS(). Clamped as in
+     * coroutineDelay().
+     */
+    std::suspend_always coroutineDelayMicros(uint32_t delayMicros) {
+      this->profileExit();
+      this->setDelayMicros(clampDelay(&T_BASE::setDelayMicros, delayMicros));
+      this->setDelaying();
+      mWait = kWaitMicros;
+      return {};
+    }
+
+    /**
+     * Yield for delaySeconds, same as COROUTINE_DELAY_SECONDS(). Clamped as in
+     * coroutineDelay().
+     */
+    std::suspend_always coroutineDelaySeconds(uint32_t delaySeconds) {
+      this->profileExit();
+      this->setDelaySeconds(
+          clampDelay(&T_BASE::setDelaySeconds, delaySeconds));
+      this->setDelaying();
+      mWait = kWaitSeconds;
+      return {};
+    }
+
+  private:
+    /**
+     * Convert the delay to the parameter type of the setDelayXxx() method of
+     * the delay policy, saturating at its largest value. The policy then
+     * clamps it to its own maximum. Without this, a 16-bit parameter would
+     * keep only the low bits, e.g. 70000 would become 4464.
+     */
+    template <typename T_POLICY, typename T_DELAY>
+    static T_DELAY clampDelay(void (T_POLICY::*)(T_DELAY), uint32_t delay) {
+      const T_DELAY maxDelay = (T_DELAY) ~(T_DELAY) 0;
+      return (delay > maxDelay) ? maxDelay : (T_DELAY) delay;
+    }
+
+    /** Why the body was suspended, which decides how it is resumed. */
+    static const uint8_t kWaitStart = 0;
+    static const uint8_t kWaitZero = 1;
+    static const uint8_t kWaitMillis = 2;
+    static const uint8_t kWaitMicros = 3;
+    static const uint8_t kWaitSeconds = 4;
+
+    // The continuation point of the CoroutineTemplate is not used by the
+    // body, but marks whether it was started, so that a reset() through the
+    // CoroutineTemplate is noticed by runCoroutine().
+  #if ACE_ROUTINE_RESUME_INDEX
+    bool isStarted() const { return this->getResume() != 0; }
+    void markStarted() { this->setResume(1); }
+  #else
+    bool isStarted() const { return this->getJump() != nullptr; }
+    void markStarted() { this->setJump(this); }
+  #endif
+
+    void destroyFrame() {
+      if (mHandle) {
+        mHandle.destroy();
+        mHandle = nullptr;
+      }
+    }
+
+    FrameArena& mArena;
+    std::coroutine_handle<> mHandle;
+    uint8_t mWait = kWaitStart;
+};
+
+/** A NativeCoroutineTemplate with the same policies as Coroutine. */
+using NativeCoroutine = NativeCoroutineTemplate<
+    Coroutine_Delay_16bit_Impl<UnnamedCoroutine, ClockInterface>>;
+
+}
+
+#endif
+
+#endif
@@ -0,0 +1,205 @@
+/*
+MIT License
+
+Copyright (c) 2021 Brian T. Park
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ACE_ROUTINE_COROUTINE_POOL_H
+#define ACE_ROUTINE_COROUTINE_POOL_H
+
+
+#include <stdint.h>
+#include <new> // placement new
+#include "CoroutineQueue.h" // SchedulingMode
+
+namespace ace_routine {
+
+class CoroutinePoolNode;
+
+/**
+ * Tag type used to select at compile time whether the CoroutineScheduler
+ * returns the terminated coroutines to their CoroutinePool, using the
+ * `kHasPool` trait of the Coroutine type. See SchedulingMode.
+ */
+template <bool T_POOLED> struct PoolingMode {};
+
+/**
+ * The interface of a CoroutinePool seen by the CoroutineScheduler, which does
+ * not know the type of the coroutines in the pool.
+ */
+class CoroutinePoolBase {
+  public:
+    /** Destroy the terminated coroutine, and return its slot to the pool. */
+    virtual void reclaim(CoroutinePoolNode* node) = 0;
+
+  protected:
+    // Not deleted through this interface, so no virtual destructor.
+    ~CoroutinePoolBase() = default;
+};
+
+/**
+ * The link from a coroutine to the CoroutinePool which owns it, nullptr if the
+ * coroutine was not spawned from a pool.
+ */
+class CoroutinePoolNode {
+  template <typename T, uint16_t N> friend class CoroutinePool;
+
+  public:
+    /** Return the pool which owns this coroutine, or nullptr. */
+    CoroutinePoolBase* getPool() const { return mPool; }
+
+  private:
+    CoroutinePoolBase* mPool = nullptr;
+};
+
+/**
+ * This layer inherits from the Named/Unnamed classes (or from
+ * Coroutine_Queue_Impl) and allows the coroutines to be spawned from a
+ * CoroutinePool. The CoroutineScheduler of such a Coroutine type removes a
+ * pooled coroutine from its lists when it terminates, and returns it to its
+ * pool. For example:
+ *
+ * @code
+ * using JobCoroutine = CoroutineTemplate<Coroutine_Delay_16bit_Impl<
+ *     Coroutine_Pool_Impl<UnnamedCoroutine>, ClockInterface>>;
+ * using JobScheduler = CoroutineSchedulerTemplate<JobCoroutine>;
+ * @endcode
+ *
+ * It costs 1 pointer of RAM per coroutine.
+ *
+ * @tparam T_BASE the Named/Unnamed base class, or the Coroutine_Queue_Impl
+ */
+template <typename T_BASE>
+class Coroutine_Pool_Impl : public T_BASE, public CoroutinePoolNode {
+  public:
+    /** The CoroutineScheduler should reclaim the pooled coroutines. */
+    static const bool kHasPool = true;
+};
+
+/**
+ * A fixed set of N slots, each of which can hold a coroutine of class T,
+ * for short-lived coroutines (e.g. one per request) created at run time
+ * without the heap. The free slots are kept in a singly-linked free list,
+ * so spawn() and the reclaim by the scheduler are O(1).
+ *
+ * A spawned coroutine joins the CoroutineScheduler of its Coroutine type
+ * like the static ones, and runs from the next call to loop(). When it
+ * terminates, i.e. the CoroutineScheduler sees it Ending after
+ * COROUTINE_END(), the scheduler removes it from its lists, calls its
+ * destructor, and returns its slot to the pool. In the queued mode (see
+ * Coroutine_Queue_Impl), a pooled coroutine is kept only in the RunQueues,
+ * not in the singly-linked list of the coroutines, so it is not visited by
+ * CoroutineScheduler::setupCoroutines() and CoroutineScheduler::list().
+ *
+ * The coroutine must not be used after it has terminated, since its slot may
+ * already hold another coroutine.
+ *
+ * @tparam T the coroutine class, whose Coroutine type includes the
+ *    Coroutine_Pool_Impl layer
+ * @tparam N the number of slots, i.e. the maximum number of coroutines from
+ *    this pool alive at the same time
+ */
+template <typename T, uint16_t N>
+class CoroutinePool : public CoroutinePoolBase {
+  static_assert(T::kHasPool,
+      "The Coroutine type of T must include the Coroutine_Pool_Impl layer");
+
+  public:
+    /** Constructor. */
+    CoroutinePool() = default;
+
+    /**
+     * Create a coroutine in a free slot, passing 'args' to its constructor.
+     * Return nullptr if all slots are in use.
+     */
+    template <typename... Args>
+    T* spawn(Args&&... args) {
+      Slot* slot;
+      if (mFreeList != nullptr) {
+        slot = mFreeList;
+        mFreeList = slot->mNextFree;
+      } else if (mNumUnused > 0) {
+        slot = &mSlots[N - mNumUnused];
+        mNumUnused--;
+      } else {
+        return nullptr;
+      }
+      mNumFree--;
+
+      T* coroutine = new (slot->mData) T(static_cast<Args&&>(args)...);
+      coroutine->mPool = this;
+      enqueue(SchedulingMode<T::kHasQueue>(), coroutine);
+      return coroutine;
+    }
+
+    /** Destroy the terminated coroutine and free its slot. */
+    void reclaim(CoroutinePoolNode* node) override {
+      T* coroutine = static_cast<T*>(node);
+      coroutine->~T();
+      Slot* slot = reinterpret_cast<Slot*>(coroutine);
+      slot->mNextFree = mFreeList;
+      mFreeList = slot;
+      mNumFree++;
+    }
+
+    /** Number of free slots. */
+    uint16_t getNumFree() const { return mNumFree; }
+
+  private:
+    /** A slot holds either a coroutine, or the link to the next free slot. */
+    union Slot {
+      Slot* mNextFree;
+      alignas(T) uint8_t mData[sizeof(T)];
+    };
+
+    // Disable copy-constructor and assignment operator
+    CoroutinePool(const CoroutinePool&) = delete;
+    CoroutinePool& operator=(const CoroutinePool&) = delete;
+
+    /**
+     * The constructor of the coroutine inserted it at the root of the
+     * singly-linked list, which is where the polling scheduler looks for it.
+     */
+    static void enqueue(SchedulingMode<false>, T* /*coroutine*/) {}
+
+    /**
+     * Move the coroutine from the root of the singly-linked list into the
+     * ready list, so that the queued scheduler can reclaim it in O(1).
+     */
+    static void enqueue(SchedulingMode<true>, T* coroutine) {
+      *T::getRoot() = *coroutine->getNext();
+      coroutine->reset();
+    }
+
+    Slot mSlots[N];
+
+    /** Reclaimed slots. */
+    Slot* mFreeList = nullptr;
+
+    /** Slots at the end of mSlots which were never used. */
+    uint16_t mNumUnused = N;
+
+    uint16_t mNumFree = N;
+};
+
+}
+
+#endif
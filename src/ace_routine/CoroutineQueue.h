@@ -0,0 +1,635 @@
+/*
+MIT License
+
+Copyright (c) 2021 Brian T. Park
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ACE_ROUTINE_COROUTINE_QUEUE_H
+#define ACE_ROUTINE_COROUTINE_QUEUE_H
+
+#include <stdint.h>
+
+/**
+ * @file CoroutineQueue.h
+ *
+ * Intrusive data structures used by the CoroutineScheduler in its queued mode.
+ * They are only compiled into the program if the Coroutine type includes the
+ * Coroutine_Queue_Impl layer, so the default Coroutine does not pay for them.
+ */
+
+namespace ace_routine {
+
+class CoroutineList;
+template <typename T_COROUTINE> class SleepQueue;
+template <typename T_COROUTINE> class RunQueues;
+
+/**
+ * Tag type used to select the queued or the polling implementation of the
+ * CoroutineTemplate and CoroutineSchedulerTemplate at compile time, using the
+ * `kHasQueue` trait of the Coroutine type. Overloading on this tag (instead of
+ * an if-statement) makes sure that only the code for the selected mode is
+ * instantiated.
+ */
+template <bool T_QUEUED> struct SchedulingMode {};
+
+/**
+ * The intrusive links which allow a coroutine to be placed into one of the
+ * scheduler queues without allocating any memory. A coroutine is in at most
+ * one queue at a time, so the same links are shared by all of them. These are
+ * used only by the queue classes in this file.
+ */
+class CoroutineQueueNode {
+  friend class CoroutineList;
+  template <typename T_COROUTINE> friend class SleepQueue;
+  template <typename T_COROUTINE> friend class RunQueues;
+
+  public:
+    /** Not in any queue. */
+    static const uint8_t kQueueNone = 0;
+
+    /** In the list of runnable coroutines. */
+    static const uint8_t kQueueReady = 1;
+
+    /** In the SleepQueue, waiting for its wake time. */
+    static const uint8_t kQueueSleeping = 2;
+
+    /** In the list of suspended or terminated coroutines. */
+    static const uint8_t kQueueParked = 3;
+
+    /** In the list of waiters of an EventTemplate. */
+    static const uint8_t kQueueWaiting = 4;
+
+    /** Return the queue which contains this node. */
+    uint8_t getQueueId() const { return mQueueId; }
+
+    /**
+     * Return the priority level, from 0 (the default, lowest) to
+     * `kNumPriorities - 1` (highest).
+     */
+    uint8_t getPriority() const { return mPriority; }
+
+  protected:
+    /** Next node in a CoroutineList, or next sibling in the SleepQueue. */
+    CoroutineQueueNode* mQueueNext = nullptr;
+
+    /**
+     * Previous node in a CoroutineList. In the SleepQueue, the previous
+     * sibling, or the parent if this node is the left-most child.
+     */
+    CoroutineQueueNode* mQueuePrev = nullptr;
+
+    union {
+      /** Left-most child in the SleepQueue. */
+      CoroutineQueueNode* mQueueChild = nullptr;
+
+      /** The wait list which contains this node, if kQueueWaiting. */
+      CoroutineList* mQueueList;
+    };
+
+    /** The coroutine to wake up when this one ends, see COROUTINE_JOIN(). */
+    CoroutineQueueNode* mJoiner = nullptr;
+
+    /** The queue which contains this node, one of the kQueueXxx constants. */
+    uint8_t mQueueId = kQueueNone;
+
+    /** Priority level, which selects the ready list. */
+    uint8_t mPriority = 0;
+};
+
+/**
+ * This layer inherits from the Named/Unnamed classes and adds the
+ * intrusive queue links to the coroutine. A CoroutineScheduler whose Coroutine
+ * type contains this layer automatically switches to the queued scheduling
+ * mode. For example:
+ *
+ * @code
+ * using Coroutine = CoroutineTemplate<Coroutine_Delay_32bit_Impl<
+ *     Coroutine_Queue_Impl<UnnamedCoroutine>, ClockInterface>>;
+ * using CoroutineScheduler = CoroutineSchedulerTemplate<Coroutine>;
+ * @endcode
+ *
+ * It costs 4 pointers and 2 bytes of RAM per coroutine.
+ *
+ * The optional T_NUM_PRIORITIES parameter selects the number of priority
+ * levels. The scheduler keeps one ready list per level, and always runs the
+ * coroutines of the highest non-empty level first. The priority of a coroutine
+ * is set using CoroutineTemplate::setPriority().
+ *
+ * @tparam T_BASE the Named/Unnamed base class
+ * @tparam T_NUM_PRIORITIES number of priority levels (default 1)
+ */
+template <typename T_BASE, uint8_t T_NUM_PRIORITIES = 1>
+class Coroutine_Queue_Impl : public T_BASE, public CoroutineQueueNode {
+  public:
+    /** The CoroutineScheduler should use the queued scheduling mode. */
+    static const bool kHasQueue = true;
+
+    /** Number of priority levels. */
+    static const uint8_t kNumPriorities = T_NUM_PRIORITIES;
+};
+
+/**
+ * An intrusive doubly-linked FIFO list of coroutines, with O(1) insertion at
+ * the back or the front, and O(1) removal from the front or from anywhere in
+ * the list.
+ */
+class CoroutineList {
+  public:
+    /** Return true if the list is empty. */
+    bool isEmpty() const { return mHead == nullptr; }
+
+    /** Return the first node, or nullptr. */
+    CoroutineQueueNode* front() const { return mHead; }
+
+    /** Return the number of nodes in the list. */
+    uint16_t getSize() const { return mSize; }
+
+    /** Append the node, which must not be in any queue. */
+    void pushBack(CoroutineQueueNode* node, uint8_t queueId) {
+      node->mQueueId = queueId;
+      node->mQueueNext = nullptr;
+      node->mQueuePrev = mTail;
+      if (mTail == nullptr) {
+        mHead = node;
+      } else {
+        mTail->mQueueNext = node;
+      }
+      mTail = node;
+      mSize++;
+    }
+
+    /** Prepend the node, which must not be in any queue. */
+    void pushFront(CoroutineQueueNode* node, uint8_t queueId) {
+      node->mQueueId = queueId;
+      node->mQueuePrev = nullptr;
+      node->mQueueNext = mHead;
+      if (mHead == nullptr) {
+        mTail = node;
+      } else {
+        mHead->mQueuePrev = node;
+      }
+      mHead = node;
+      mSize++;
+    }
+
+    /** Remove and return the first node, or nullptr. */
+    CoroutineQueueNode* popFront() {
+      CoroutineQueueNode* node = mHead;
+      if (node != nullptr) remove(node);
+      return node;
+    }
+
+    /** Remove the node, which must be in this list. */
+    void remove(CoroutineQueueNode* node) {
+      if (node->mQueuePrev == nullptr) {
+        mHead = node->mQueueNext;
+      } else {
+        node->mQueuePrev->mQueueNext = node->mQueueNext;
+      }
+      if (node->mQueueNext == nullptr) {
+        mTail = node->mQueuePrev;
+      } else {
+        node->mQueueNext->mQueuePrev = node->mQueuePrev;
+      }
+      node->mQueueNext = nullptr;
+      node->mQueuePrev = nullptr;
+      node->mQueueId = CoroutineQueueNode::kQueueNone;
+      mSize--;
+    }
+
+  private:
+    CoroutineQueueNode* mHead = nullptr;
+    CoroutineQueueNode* mTail = nullptr;
+    uint16_t mSize = 0;
+};
+
+/**
+ * A min-heap of delaying coroutines, ordered by the wake time returned by
+ * `getDelayWakeMicros()` of their delay policy. It is implemented as an
+ * intrusive pairing heap, so push() is O(1), and pop() and remove() are
+ * O(log N) amortized, without any fixed capacity or heap allocation.
+ *
+ * Wake times are compared using the signed difference of the 32-bit micros,
+ * which is correct across the rollover of micros() as long as all pending
+ * wake times are within 2^31 micros of each other. The delay policies clamp
+ * their durations to UINT32_MAX / 2, which guarantees this.
+ *
+ * There is one instance per Coroutine type, owned by RunQueues.
+ */
+template <typename T_COROUTINE>
+class SleepQueue {
+  public:
+    /** Return true if there are no sleeping coroutines. */
+    bool isEmpty() const { return mRoot == nullptr; }
+
+    /** Return the coroutine with the earliest wake time, or nullptr. */
+    T_COROUTINE* top() const { return static_cast<T_COROUTINE*>(mRoot); }
+
+    /** Return true if the given coroutine is in this queue. */
+    bool contains(const T_COROUTINE* coroutine) const {
+      const CoroutineQueueNode* node = coroutine;
+      return node->mQueueId == CoroutineQueueNode::kQueueSleeping;
+    }
+
+    /** Insert the coroutine. It must not already be in the queue. */
+    void push(T_COROUTINE* coroutine) {
+      CoroutineQueueNode* node = coroutine;
+      node->mQueueNext = nullptr;
+      node->mQueuePrev = nullptr;
+      node->mQueueChild = nullptr;
+      node->mQueueId = CoroutineQueueNode::kQueueSleeping;
+      mRoot = (mRoot == nullptr) ? node : meld(mRoot, node);
+    }
+
+    /** Remove and return the coroutine with the earliest wake time. */
+    T_COROUTINE* pop() {
+      CoroutineQueueNode* root = mRoot;
+      if (root == nullptr) return nullptr;
+
+      mRoot = mergePairs(root->mQueueChild);
+      root->mQueueChild = nullptr;
+      root->mQueueId = CoroutineQueueNode::kQueueNone;
+      return static_cast<T_COROUTINE*>(root);
+    }
+
+    /** Remove the given coroutine, which must be in the queue. */
+    void remove(T_COROUTINE* coroutine) {
+      CoroutineQueueNode* node = coroutine;
+      if (node == mRoot) {
+        pop();
+        return;
+      }
+
+      // Cut the subtree rooted at node out of its sibling list.
+      CoroutineQueueNode* prev = node->mQueuePrev;
+      if (prev->mQueueChild == node) {
+        prev->mQueueChild = node->mQueueNext;
+      } else {
+        prev->mQueueNext = node->mQueueNext;
+      }
+      if (node->mQueueNext != nullptr) {
+        node->mQueueNext->mQueuePrev = prev;
+      }
+      node->mQueueNext = nullptr;
+      node->mQueuePrev = nullptr;
+      node->mQueueId = CoroutineQueueNode::kQueueNone;
+
+      // Merge its children back into the heap.
+      CoroutineQueueNode* children = mergePairs(node->mQueueChild);
+      node->mQueueChild = nullptr;
+      if (children != nullptr) {
+        mRoot = meld(mRoot, children);
+      }
+    }
+
+  private:
+    /** Return true if 'a' should wake up before 'b'. */
+    static bool isBefore(CoroutineQueueNode* a, CoroutineQueueNode* b) {
+      uint32_t wakeA = static_cast<T_COROUTINE*>(a)->getDelayWakeMicros();
+      uint32_t wakeB = static_cast<T_COROUTINE*>(b)->getDelayWakeMicros();
+      return (int32_t) (wakeA - wakeB) < 0;
+    }
+
+    /**
+     * Merge two heaps whose roots have no siblings, and return the new root.
+     * The root with the later wake time becomes the left-most child of the
+     * other.
+     */
+    static CoroutineQueueNode* meld(
+        CoroutineQueueNode* a, CoroutineQueueNode* b) {
+      if (isBefore(b, a)) {
+        CoroutineQueueNode* tmp = a;
+        a = b;
+        b = tmp;
+      }
+      b->mQueuePrev = a;
+      b->mQueueNext = a->mQueueChild;
+      if (a->mQueueChild != nullptr) {
+        a->mQueueChild->mQueuePrev = b;
+      }
+      a->mQueueChild = b;
+      return a;
+    }
+
+    /**
+     * Standard two-pass merge of a list of siblings into a single heap. The
+     * first pass melds the siblings in pairs from left to right, pushing each
+     * result onto a stack threaded through mQueueNext. The second pass melds
+     * the stack from right to left.
+     */
+    static CoroutineQueueNode* mergePairs(CoroutineQueueNode* first) {
+      if (first == nullptr) return nullptr;
+
+      CoroutineQueueNode* stack = nullptr;
+      while (first != nullptr) {
+        CoroutineQueueNode* a = first;
+        CoroutineQueueNode* b = a->mQueueNext;
+        first = (b != nullptr) ? b->mQueueNext : nullptr;
+
+        a->mQueueNext = nullptr;
+        a->mQueuePrev = nullptr;
+        if (b != nullptr) {
+          b->mQueueNext = nullptr;
+          b->mQueuePrev = nullptr;
+          a = meld(a, b);
+        }
+        a->mQueueNext = stack;
+        stack = a;
+      }
+
+      CoroutineQueueNode* result = stack;
+      stack = stack->mQueueNext;
+      result->mQueueNext = nullptr;
+      while (stack != nullptr) {
+        CoroutineQueueNode* next = stack->mQueueNext;
+        stack->mQueueNext = nullptr;
+        result = meld(result, stack);
+        stack = next;
+      }
+      return result;
+    }
+
+    /** Root of the pairing heap. */
+    CoroutineQueueNode* mRoot = nullptr;
+};
+
+/**
+ * The queues of the CoroutineScheduler in the queued mode. Every coroutine
+ * which has been placed by the scheduler is in exactly one of them:
+ *
+ *  * ready: Yielding coroutines, and Delaying coroutines of a delay policy
+ *    without `kHasWakeTime`, in round-robin order, one list per priority
+ *  * sleeping: Delaying coroutines, ordered by wake time
+ *  * parked: Suspended and Terminated coroutines, never visited by the
+ *    scheduler
+ *  * waiting: Waiting coroutines, in the wait list of the EventTemplate that
+ *    they are waiting for, until it is notified, or in the join list until
+ *    a child which they joined ends
+ *
+ * The CoroutineTemplate calls makeReady() and park() from resume(), reset()
+ * and suspend(), so that the cost of a scheduler pass depends only on the
+ * number of runnable coroutines.
+ *
+ * A lower priority level can be starved by a higher one which always has
+ * ready coroutines. If an aging limit is set, then after that many consecutive
+ * dispatches from a higher level while a lower level is waiting, the next
+ * dispatch is taken from the highest waiting lower level instead.
+ *
+ * There is one instance per Coroutine type, returned by getInstance().
+ */
+template <typename T_COROUTINE>
+class RunQueues {
+  public:
+    /**
+     * Return the RunQueues of the T_COROUTINE type. Implemented as a function
+     * static for the same reason as CoroutineTemplate::getRoot().
+     */
+    static RunQueues* getInstance() {
+      static RunQueues queues;
+      return &queues;
+    }
+
+    /** Number of priority levels, i.e. ready lists. */
+    static const uint8_t kNumPriorities = T_COROUTINE::kNumPriorities;
+
+    /** Move the coroutine to the back of the ready list of its priority. */
+    void makeReady(T_COROUTINE* coroutine) {
+      unlink(coroutine);
+      CoroutineQueueNode* node = coroutine;
+      mReady[node->mPriority].pushBack(node, CoroutineQueueNode::kQueueReady);
+    }
+
+    /**
+     * Move the coroutine to the front of the ready list of its priority, so
+     * that it runs next. Used for the coroutines posted to a WakeRing. A
+     * parked (i.e. Suspended or Terminated) coroutine is left alone.
+     */
+    void wakeUp(T_COROUTINE* coroutine) {
+      CoroutineQueueNode* node = coroutine;
+      if (node->mQueueId == CoroutineQueueNode::kQueueParked) return;
+      unlink(coroutine);
+      mReady[node->mPriority].pushFront(node, CoroutineQueueNode::kQueueReady);
+    }
+
+    /** Move the coroutine into the sleeping queue. */
+    void sleep(T_COROUTINE* coroutine) {
+      unlink(coroutine);
+      mSleeping.push(coroutine);
+    }
+
+    /** Move the coroutine to the parked list. */
+    void park(T_COROUTINE* coroutine) {
+      unlink(coroutine);
+      mParked.pushBack(coroutine, CoroutineQueueNode::kQueueParked);
+    }
+
+    /**
+     * Move the coroutine to the back of the wait list of an EventTemplate.
+     * It stays there, invisible to the scheduler, until wakeFront() or
+     * unlink() removes it.
+     */
+    void wait(T_COROUTINE* coroutine, CoroutineList* waiters) {
+      unlink(coroutine);
+      CoroutineQueueNode* node = coroutine;
+      waiters->pushBack(node, CoroutineQueueNode::kQueueWaiting);
+      node->mQueueList = waiters;
+    }
+
+    /**
+     * Move the first coroutine of the wait list into its ready list. Return
+     * false if the wait list was empty.
+     */
+    bool wakeFront(CoroutineList* waiters) {
+      CoroutineQueueNode* node = waiters->popFront();
+      if (node == nullptr) return false;
+      node->mQueueList = nullptr;
+      makeReady(static_cast<T_COROUTINE*>(node));
+      return true;
+    }
+
+    /**
+     * Make 'joiner' the coroutine woken up by notifyJoiner() when 'child'
+     * ends. A child has at most one joiner. Return false if another
+     * coroutine is already waiting in the join list for 'child', in which
+     * case it is kept. A previous joiner which no longer waits, e.g. because
+     * it was reset, is replaced. Used by COROUTINE_JOIN_ALL().
+     */
+    bool setJoiner(T_COROUTINE* child, T_COROUTINE* joiner) {
+      CoroutineQueueNode* node = child;
+      CoroutineQueueNode* previous = node->mJoiner;
+      if (previous != nullptr && previous != joiner
+          && previous->mQueueId == CoroutineQueueNode::kQueueWaiting
+          && previous->mQueueList == &mJoining) {
+        return false;
+      }
+      node->mJoiner = joiner;
+      return true;
+    }
+
+    /**
+     * Move the coroutine to the join list, where it waits for notifyJoiner().
+     * Used by COROUTINE_JOIN_ALL().
+     */
+    void waitJoin(T_COROUTINE* joiner) {
+      wait(joiner, &mJoining);
+    }
+
+    /**
+     * Called when 'child' ends. Move its joiner into its ready list if it is
+     * still in the join list, i.e. it was not suspended or reset meanwhile.
+     */
+    void notifyJoiner(T_COROUTINE* child) {
+      CoroutineQueueNode* node = child;
+      CoroutineQueueNode* joiner = node->mJoiner;
+      if (joiner == nullptr) return;
+      node->mJoiner = nullptr;
+      if (joiner->mQueueId == CoroutineQueueNode::kQueueWaiting
+          && joiner->mQueueList == &mJoining) {
+        makeReady(static_cast<T_COROUTINE*>(joiner));
+      }
+    }
+
+    /** Return the number of coroutines waiting in COROUTINE_JOIN_ALL(). */
+    uint16_t getJoiningSize() const { return mJoining.getSize(); }
+
+    /** Remove the coroutine from whichever queue contains it. */
+    void unlink(T_COROUTINE* coroutine) {
+      CoroutineQueueNode* node = coroutine;
+      switch (node->mQueueId) {
+        case CoroutineQueueNode::kQueueReady:
+          mReady[node->mPriority].remove(node);
+          break;
+        case CoroutineQueueNode::kQueueSleeping:
+          mSleeping.remove(coroutine);
+          break;
+        case CoroutineQueueNode::kQueueParked:
+          mParked.remove(node);
+          break;
+        case CoroutineQueueNode::kQueueWaiting:
+          node->mQueueList->remove(node);
+          node->mQueueList = nullptr;
+          break;
+        default:
+          break;
+      }
+    }
+
+    /**
+     * Set the priority of the coroutine, clamped to `kNumPriorities - 1`. If
+     * the coroutine is ready, it moves to the back of its new ready list.
+     */
+    void setPriority(T_COROUTINE* coroutine, uint8_t priority) {
+      if (priority >= kNumPriorities) priority = kNumPriorities - 1;
+      CoroutineQueueNode* node = coroutine;
+      if (node->mQueueId == CoroutineQueueNode::kQueueReady) {
+        mReady[node->mPriority].remove(node);
+        node->mPriority = priority;
+        mReady[priority].pushBack(node, CoroutineQueueNode::kQueueReady);
+      } else {
+        node->mPriority = priority;
+      }
+    }
+
+    /**
+     * Set the number of consecutive dispatches from a higher priority level
+     * after which a waiting lower level gets one dispatch. 0 (the default)
+     * disables aging.
+     */
+    void setAgingLimit(uint8_t agingLimit) {
+      mAgingLimit = agingLimit;
+      mAgingCount = 0;
+    }
+
+    /**
+     * Remove and return the next runnable coroutine, or nullptr. This is the
+     * front of the highest non-empty ready list, subject to aging.
+     */
+    T_COROUTINE* popReady() {
+      uint8_t level;
+      if (! findReadyLevel(kNumPriorities, level)) return nullptr;
+
+      if (mAgingLimit != 0) {
+        uint8_t lower;
+        if (findReadyLevel(level, lower)) {
+          if (++mAgingCount > mAgingLimit) {
+            mAgingCount = 0;
+            level = lower;
+          }
+        } else {
+          mAgingCount = 0;
+        }
+      }
+
+      return popReady(level);
+    }
+
+    /** Remove and return the front of the given ready list, or nullptr. */
+    T_COROUTINE* popReady(uint8_t level) {
+      return static_cast<T_COROUTINE*>(mReady[level].popFront());
+    }
+
+    /** Return true if a coroutine above the given priority is ready. */
+    bool isReadyAbove(uint8_t priority) const {
+      uint8_t level;
+      return findReadyLevel(kNumPriorities, level) && level > priority;
+    }
+
+    /** Return true if there are no runnable coroutines. */
+    bool isReadyEmpty() const {
+      uint8_t level;
+      return ! findReadyLevel(kNumPriorities, level);
+    }
+
+    /** Return the number of coroutines in the ready list of the level. */
+    uint16_t getReadySize(uint8_t level) const {
+      return mReady[level].getSize();
+    }
+
+    /** Return the sleeping queue. */
+    SleepQueue<T_COROUTINE>* getSleeping() { return &mSleeping; }
+
+  private:
+    /**
+     * Find the highest non-empty ready list below the level 'below'. Return
+     * false if there is none.
+     */
+    bool findReadyLevel(uint8_t below, uint8_t& level) const {
+      while (below > 0) {
+        below--;
+        if (! mReady[below].isEmpty()) {
+          level = below;
+          return true;
+        }
+      }
+      return false;
+    }
+
+    CoroutineList mReady[kNumPriorities];
+    SleepQueue<T_COROUTINE> mSleeping;
+    CoroutineList mParked;
+    CoroutineList mJoining;
+    uint8_t mAgingLimit = 0;
+    uint8_t mAgingCount = 0;
+};
+
+}
+
+#endif
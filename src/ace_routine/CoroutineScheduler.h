@@ -29,6 +29,11 @@ SOFTWARE.
   #include <Arduino.h> // Serial, Print
 #endif
 #include "Coroutine.h"
+#include "CoroutineQueue.h"
+#include "WakeRing.h"
+#include "CoroutineSetup.h"
+#include "CoroutineTrace.h"
+#include "CoroutineUsage.h"
 
 class Print;
 
@@ -76,10 +81,40 @@ namespace ace_routine {
  * remove this extra layer of indirection. Fortunately, the none of these
  * methods are virtual, so the extra level of indirection consumes very little
  * overhead, even on 8-bit AVR processors.
+ *
+ * Queued Mode:
+ *
+ * The round-robin algorithm calls `runCoroutine()` on every coroutine, even
+ * those in a `COROUTINE_DELAY()` which only discover that they have nothing to
+ * do after a virtual dispatch and a call to `micros()`. With hundreds of
+ * mostly-sleeping coroutines, those calls dominate the loop. If the Coroutine
+ * type includes the `Coroutine_Queue_Impl` layer, and its delay policy knows
+ * the absolute wake time (`kHasWakeTime`, e.g. `Coroutine_Delay_32bit_Impl`),
+ * then the scheduler keeps the delaying coroutines in a `SleepQueue` ordered
+ * by wake time, and dispatches them only when the earliest deadline has
+ * passed. The Yielding coroutines are kept in a ready list, and the Suspended
+ * and Terminated coroutines in a parked list (see RunQueues), so the cost of
+ * each loop() does not depend on the number of coroutines which are not
+ * runnable. Coroutines in a `COROUTINE_AWAIT_EVENT()` are kept in the wait
+ * list of their EventTemplate until it is notified.
+ *
+ * If the clock of the Coroutine type is a SnapshotClockInterface, the
+ * scheduler refreshes it once per pass (each wrap-around of the round-robin in
+ * the polling mode, each loop() in the queued mode, and each runAll()), so that
+ * the coroutines of a pass share a single reading of the clock.
  */
 template <typename T_COROUTINE>
 class CoroutineSchedulerTemplate {
   public:
+    /**
+     * Function called by the scheduler when no coroutine is runnable until
+     * `wakeMicros`, the earliest wake time of the delaying coroutines (in the
+     * clock of `T_COROUTINE::coroutineMicros()`). The hook may sleep, e.g.
+     * using `nanosleep()` on Linux or a sleep mode on a microcontroller, but
+     * should return no later than `wakeMicros`.
+     */
+    typedef void (*IdleHook)(uint32_t wakeMicros);
+
     /** Set up the scheduler. Should be called from the global setup(). */
     static void setup() { getScheduler()->setupScheduler(); }
 
@@ -94,7 +129,152 @@ class CoroutineSchedulerTemplate {
      * the system loop() to return to do systems processing, such as WiFi.
      * Everyone must cooperate to make the whole thing work.
      */
-    static void loop() { getScheduler()->runCoroutine(); }
+    static void loop() {
+      unsigned long startCycles =
+          beginLoop(UsageMode<T_COROUTINE::kHasUsage>());
+      getScheduler()->runCoroutine();
+      endLoop(UsageMode<T_COROUTINE::kHasUsage>(), startCycles);
+    }
+
+    /**
+     * Run every runnable coroutine once, then return. In the polling mode,
+     * this is one pass over all coroutines. In the queued mode, this runs the
+     * coroutines in the ready list, including the sleepers whose wake time has
+     * passed, but not the coroutines which become ready during the pass. This
+     * amortizes the overhead of the global loop() over many coroutines.
+     */
+    static void runAll() {
+      unsigned long startCycles =
+          beginLoop(UsageMode<T_COROUTINE::kHasUsage>());
+      getScheduler()->runAllInternal();
+      endLoop(UsageMode<T_COROUTINE::kHasUsage>(), startCycles);
+    }
+
+    /**
+     * Keep running coroutines until at least `budgetMicros` have elapsed, and
+     * return the unused part of the budget. In the queued mode, this returns
+     * early when no coroutine is runnable, so the caller can use the remaining
+     * time for other work. The last coroutine may overrun the budget, in which
+     * case 0 is returned. The wake time passed to the IdleHook is clamped to
+     * the end of the budget, so the hook does not sleep past it.
+     */
+    static uint32_t runFor(uint32_t budgetMicros) {
+      unsigned long startCycles =
+          beginLoop(UsageMode<T_COROUTINE::kHasUsage>());
+      uint32_t unusedMicros = getScheduler()->runForInternal(budgetMicros);
+      endLoop(UsageMode<T_COROUTINE::kHasUsage>(), startCycles);
+      return unusedMicros;
+    }
+
+    /**
+     * Return the earliest time at which a coroutine needs to run, in
+     * `wakeMicros`. If a coroutine is runnable now, or is delaying with a
+     * policy which does not know its wake time (`kHasWakeTime` is false),
+     * this is the current time. Return false if no coroutine is runnable or
+     * delaying, i.e. all coroutines are suspended or terminated.
+     */
+    static bool getNextWakeMicros(uint32_t& wakeMicros) {
+      return getScheduler()->nextWakeMicros(
+          SchedulingMode<T_COROUTINE::kHasQueue>(), wakeMicros);
+    }
+
+    /**
+     * Set the function which is called when there is nothing to run until
+     * the next wake time. In the queued mode, it is called by loop() and
+     * runFor() when the ready list is empty. In the polling mode, it is called
+     * at the end of each pass over the coroutines if all of them are delaying,
+     * which requires a delay policy with `kHasWakeTime`. Set to nullptr (the
+     * default) to disable.
+     */
+    static void setIdleHook(IdleHook idleHook) {
+      getScheduler()->mIdleHook = idleHook;
+    }
+
+    /**
+     * Add a WakeRing which is drained at the start of each loop() and
+     * runAll(). In the queued mode, the posted coroutines are moved to the
+     * front of their ready list, including from the SleepQueue or the wait
+     * list of an event, so they run next. In the polling mode, they are run
+     * immediately. Suspended and Terminated coroutines are not woken up.
+     *
+     * Several rings, e.g. one per interrupt source, can be added. They are
+     * drained in the order in which they were added. Adding a ring twice has
+     * no effect. A ring cannot be removed.
+     */
+    static void addWakeRing(WakeRingBase<T_COROUTINE>* wakeRing) {
+      WakeRingBase<T_COROUTINE>** link = &getScheduler()->mWakeRings;
+      while (*link != nullptr) {
+        if (*link == wakeRing) return;
+        link = &(*link)->mNextRing;
+      }
+      wakeRing->mNextRing = nullptr;
+      *link = wakeRing;
+    }
+
+    /**
+     * Set the aging limit of the priority levels in the queued mode. After
+     * `agingLimit` consecutive dispatches from a higher priority level while a
+     * lower level has ready coroutines, the lower level gets one dispatch. Set
+     * to 0 (the default) for strict priorities. Available only if the
+     * Coroutine type includes the Coroutine_Queue_Impl layer.
+     */
+    static void setAgingLimit(uint8_t agingLimit) {
+      RunQueues<T_COROUTINE>::getInstance()->setAgingLimit(agingLimit);
+    }
+
+    /**
+     * Set the maximum number of coroutines which are set up per pass, for a
+     * Coroutine type with the Coroutine_LazySetup_Impl layer. The coroutines
+     * are then set up in decreasing order of their setup priority, and a
+     * coroutine does not run until it has been set up. Set to 0 (the default)
+     * to set up each coroutine just before its first dispatch. In the queued
+     * mode, a pass of loop() or runFor() lasts as many dispatches as there are
+     * coroutines, and a pass of runAll() is one call.
+     */
+    static void setSetupBudget(uint8_t budget) {
+      LazySetup<T_COROUTINE>::getInstance()->setBudget(budget);
+    }
+
+    /**
+     * Set the TraceRing into which the coroutines record their status
+     * transitions, and the scheduler its dispatches, for a Coroutine type
+     * with the Coroutine_Trace_Impl layer. Set to nullptr (the default) to
+     * stop recording.
+     */
+    static void setTraceRing(TraceRingBase* traceRing) {
+      CoroutineTrace<T_COROUTINE>::getInstance()->setRing(traceRing);
+    }
+
+    /**
+     * Print the TraceRing to the printer (usually Serial): a "TRACE" line
+     * with the cycles per second of the clock and the number of lost events,
+     * a "NAME" line with the trace id and the name of each named coroutine,
+     * the events (see TraceRingBase::printEventsTo()), then an "END" line.
+     * This is the input of examples/Tracing/trace_to_chrome.py.
+     */
+    static void printTraceTo(Print& printer) {
+      getScheduler()->printTrace(printer);
+    }
+
+    /**
+     * Copy the usage counters of the scheduler into 'usage', for a Coroutine
+     * type with the Coroutine_Usage_Impl layer. The counters of each
+     * coroutine are returned by its getUsage(). The CPU share of a coroutine
+     * is its busyCycles over the loopCycles of the scheduler, between 2
+     * snapshots.
+     */
+    static void getUsage(SchedulerUsage& usage) {
+      usage = CoroutineUsageCounter<T_COROUTINE>::getInstance()->getUsage();
+    }
+
+    /** Reset the usage counters of the scheduler and of its coroutines. */
+    static void clearUsage() {
+      CoroutineUsageCounter<T_COROUTINE>::getInstance()->clear();
+      for (T_COROUTINE** p = T_COROUTINE::getRoot(); (*p) != nullptr;
+          p = (*p)->getNext()) {
+        (*p)->clearUsage();
+      }
+    }
 
     /**
      * Print out the known coroutines to the printer (usually Serial). Note that
@@ -129,10 +309,26 @@ class CoroutineSchedulerTemplate {
      * list if resume() was called immediately after the suspend(). For v1.2 and
      * onwards, we keep all coroutines in the linked list no matter the state,
      * which makes the state management and linked-list management a lot
-     * simpler.
+     * simpler. In the queued mode, each coroutine is also placed into one of
+     * the RunQueues, which use separate links.
      */
     void setupScheduler() {
       mCurrent = T_COROUTINE::getRoot();
+      setupQueues(SchedulingMode<T_COROUTINE::kHasQueue>());
+      resetSetup(SetupMode<T_COROUTINE::kHasLazySetup>());
+      numberTraceIds(TraceMode<T_COROUTINE::kHasTrace>());
+    }
+
+    /** Nothing to do in polling mode. */
+    void setupQueues(SchedulingMode<false>) {}
+
+    /** Place each coroutine into the RunQueues according to its status. */
+    void setupQueues(SchedulingMode<true>) {
+      for (T_COROUTINE** p = T_COROUTINE::getRoot();
+          (*p) != nullptr;
+          p = (*p)->getNext()) {
+        requeue(*p);
+      }
     }
 
     /** Setup each coroutine by calling its setupCoroutine() function. */
@@ -142,11 +338,169 @@ class CoroutineSchedulerTemplate {
           p = (*p)->getNext()) {
 
         (*p)->setupCoroutine();
+        markSetUp(SetupMode<T_COROUTINE::kHasLazySetup>(), *p);
       }
     }
 
+    /** Nothing to do without the Coroutine_LazySetup_Impl layer. */
+    static void resetSetup(SetupMode<false>) {}
+
+    /** Look for the coroutines waiting for their setup. */
+    static void resetSetup(SetupMode<true>) {
+      LazySetup<T_COROUTINE>::getInstance()->reset();
+    }
+
+    /** Nothing to number without the Coroutine_Trace_Impl layer. */
+    static void numberTraceIds(TraceMode<false>) {}
+
+    /** Give the next trace ids to the coroutines which have none. */
+    static void numberTraceIds(TraceMode<true>) {
+      uint8_t id = 0;
+      for (T_COROUTINE** p = T_COROUTINE::getRoot(); (*p) != nullptr;
+          p = (*p)->getNext()) {
+        if ((*p)->getTraceId() > id) id = (*p)->getTraceId();
+      }
+      for (T_COROUTINE** p = T_COROUTINE::getRoot(); (*p) != nullptr;
+          p = (*p)->getNext()) {
+        if ((*p)->getTraceId() == 0 && id < UINT8_MAX) (*p)->setTraceId(++id);
+      }
+    }
+
+    /** Nothing to record without the Coroutine_Trace_Impl layer. */
+    static void beginTraceDispatch(TraceMode<false>,
+        T_COROUTINE* /*coroutine*/) {}
+
+    /** Record the dispatch, if the coroutine changes its status. */
+    static void beginTraceDispatch(TraceMode<true>, T_COROUTINE* coroutine) {
+      CoroutineTrace<T_COROUTINE>::getInstance()->beginDispatch(coroutine);
+    }
+
+    /** Nothing to record without the Coroutine_Trace_Impl layer. */
+    static void endTraceDispatch(TraceMode<false>) {}
+
+    /** Forget the dispatch, if the coroutine did not change its status. */
+    static void endTraceDispatch(TraceMode<true>) {
+      CoroutineTrace<T_COROUTINE>::getInstance()->endDispatch();
+    }
+
+    /** Nothing to count without the Coroutine_Usage_Impl layer. */
+    static unsigned long beginLoop(UsageMode<false>) { return 0; }
+
+    /** Return the start time of the loop. */
+    static unsigned long beginLoop(UsageMode<true>) {
+      return CoroutineUsageCounter<T_COROUTINE>::getInstance()->beginLoop();
+    }
+
+    /** Nothing to count without the Coroutine_Usage_Impl layer. */
+    static void endLoop(UsageMode<false>, unsigned long /*startCycles*/) {}
+
+    /** Count the loop which started at 'startCycles'. */
+    static void endLoop(UsageMode<true>, unsigned long startCycles) {
+      CoroutineUsageCounter<T_COROUTINE>::getInstance()->endLoop(startCycles);
+    }
+
+    /** Nothing to count without the Coroutine_Usage_Impl layer. */
+    static void beginUsageDispatch(UsageMode<false>) {}
+
+    /** Start watching the status transitions of the dispatch. */
+    static void beginUsageDispatch(UsageMode<true>) {
+      CoroutineUsageCounter<T_COROUTINE>::getInstance()->beginDispatch();
+    }
+
+    /** Nothing to count without the Coroutine_Usage_Impl layer. */
+    static void endUsageDispatch(UsageMode<false>,
+        T_COROUTINE* /*coroutine*/) {}
+
+    /** Count the dispatch, as busy or as an idle pass. */
+    static void endUsageDispatch(UsageMode<true>, T_COROUTINE* coroutine) {
+      CoroutineUsageCounter<T_COROUTINE>::getInstance()->endDispatch(
+          coroutine);
+    }
+
+    /** Nothing to count without the Coroutine_Usage_Impl layer. */
+    static unsigned long beginSleep(UsageMode<false>) { return 0; }
+
+    /** Return the start time of the IdleHook. */
+    static unsigned long beginSleep(UsageMode<true>) {
+      return T_COROUTINE::coroutineCycles();
+    }
+
+    /** Nothing to count without the Coroutine_Usage_Impl layer. */
+    static void endSleep(UsageMode<false>, unsigned long /*startCycles*/) {}
+
+    /** Count the time spent in the IdleHook. */
+    static void endSleep(UsageMode<true>, unsigned long startCycles) {
+      CoroutineUsageCounter<T_COROUTINE>::getInstance()->endSleep(startCycles);
+    }
+
+    /** Print the header, the names and the events of the TraceRing. */
+    void printTrace(Print& printer) {
+      TraceRingBase* ring = CoroutineTrace<T_COROUTINE>::getInstance()
+          ->getRing();
+      printer.print(F("TRACE "));
+      printer.print(T_COROUTINE::coroutineCyclesPerSecond());
+      printer.print(' ');
+      printer.print(ring ? ring->getLost() : 0);
+      printer.println();
+      for (T_COROUTINE** p = T_COROUTINE::getRoot(); (*p) != nullptr;
+          p = (*p)->getNext()) {
+        if ((*p)->getName() == nullptr) continue;
+        printer.print(F("NAME "));
+        printer.print((*p)->getTraceId());
+        printer.print(' ');
+        printer.print((*p)->getName());
+        printer.println();
+      }
+      if (ring) ring->printEventsTo(printer);
+      printer.println(F("END"));
+    }
+
+    /** Nothing to do without the Coroutine_LazySetup_Impl layer. */
+    static void markSetUp(SetupMode<false>, T_COROUTINE* /*coroutine*/) {}
+
+    /** Do not set up the coroutine again on its first dispatch. */
+    static void markSetUp(SetupMode<true>, T_COROUTINE* coroutine) {
+      coroutine->markSetUp();
+    }
+
+    /** Nothing to do without the Coroutine_LazySetup_Impl layer. */
+    static void beginSetupPass(SetupMode<false>) {}
+
+    /** Reset the setup budget of the pass. */
+    static void beginSetupPass(SetupMode<true>) {
+      LazySetup<T_COROUTINE>::getInstance()->beginPass();
+    }
+
+    /** Nothing to do without the Coroutine_LazySetup_Impl layer. */
+    static void beginSetupDispatch(SetupMode<false>) {}
+
+    /** Start a new setup pass after a round of the queued dispatches. */
+    static void beginSetupDispatch(SetupMode<true>) {
+      LazySetup<T_COROUTINE>::getInstance()->beginDispatch();
+    }
+
+    /** Every coroutine can run without the Coroutine_LazySetup_Impl layer. */
+    static bool prepareSetup(SetupMode<false>, T_COROUTINE* /*coroutine*/) {
+      return true;
+    }
+
+    /** Set up the coroutine before its first run, if allowed. */
+    static bool prepareSetup(SetupMode<true>, T_COROUTINE* coroutine) {
+      return LazySetup<T_COROUTINE>::getInstance()->prepare(coroutine);
+    }
+
     /** Run the current coroutine. */
     void runCoroutine() {
+      runCoroutine(SchedulingMode<T_COROUTINE::kHasQueue>());
+    }
+
+    /**
+     * Run the next coroutine in the round-robin. Return false if there are no
+     * coroutines.
+     */
+    bool runCoroutine(SchedulingMode<false>) {
+      drainWakeRings();
+
       // If reached the end, start from the beginning again.
       if (*mCurrent == nullptr) {
         mCurrent = T_COROUTINE::getRoot();
@@ -154,41 +508,375 @@ class CoroutineSchedulerTemplate {
         // if-statement is deliberate, since it optimizes the common case where
         // the linked list is not empty.
         if (*mCurrent == nullptr) {
-          return;
+          return false;
+        }
+      }
+
+      // Once per pass, refresh the clock, and sleep if every coroutine is
+      // waiting.
+      if (mCurrent == T_COROUTINE::getRoot()) {
+        T_COROUTINE::coroutineSnapshotPass();
+        beginSetupPass(SetupMode<T_COROUTINE::kHasLazySetup>());
+        if (T_COROUTINE::kHasWakeTime && mIdleHook != nullptr) {
+          callIdleHook(SchedulingMode<false>());
+        }
+      }
+
+      dispatchPolled(*mCurrent);
+
+      // Go to the next coroutine, unless the current one was returned to its
+      // pool, in which case the next one has taken its place.
+      if (! reclaim(PoolingMode<T_COROUTINE::kHasPool>(), mCurrent)) {
+        mCurrent = (*mCurrent)->getNext();
+      }
+      return true;
+    }
+
+    /**
+     * Run the earliest sleeper if its wake time has passed. Otherwise, run the
+     * coroutine at the front of the ready list. Return false if no coroutine
+     * was runnable.
+     */
+    bool runCoroutine(SchedulingMode<true>) {
+      T_COROUTINE::coroutineSnapshotPass();
+      drainWakeRings();
+
+      RunQueues<T_COROUTINE>* queues = RunQueues<T_COROUTINE>::getInstance();
+      SleepQueue<T_COROUTINE>* sleeping = queues->getSleeping();
+
+      T_COROUTINE* coroutine = sleeping->top();
+      if (coroutine != nullptr && (int32_t) (T_COROUTINE::coroutineMicros()
+          - coroutine->getDelayWakeMicros()) >= 0) {
+        sleeping->pop();
+
+        // Run it now, unless a coroutine of a higher priority is ready.
+        if (T_COROUTINE::kNumPriorities > 1
+            && queues->isReadyAbove(coroutine->getPriority())) {
+          queues->makeReady(coroutine);
+          coroutine = queues->popReady();
+        }
+      } else {
+        coroutine = queues->popReady();
+        if (coroutine == nullptr) {
+          if (mIdleHook != nullptr) {
+            callIdleHook(SchedulingMode<true>());
+          }
+          return false;
+        }
+      }
+
+      beginSetupDispatch(SetupMode<T_COROUTINE::kHasLazySetup>());
+      dispatchQueued(coroutine);
+      return true;
+    }
+
+    /** Find the next wake time by walking the linked list. */
+    bool nextWakeMicros(SchedulingMode<false>, uint32_t& wakeMicros) {
+      uint32_t nowMicros = T_COROUTINE::coroutineMicros();
+      bool found = false;
+      for (T_COROUTINE** p = T_COROUTINE::getRoot();
+          (*p) != nullptr;
+          p = (*p)->getNext()) {
+        switch ((*p)->getStatus()) {
+          case T_COROUTINE::kStatusSuspended:
+          case T_COROUTINE::kStatusTerminated:
+            break;
+
+          case T_COROUTINE::kStatusDelaying:
+            if (T_COROUTINE::kHasWakeTime) {
+              uint32_t wake = (*p)->getDelayWakeMicros();
+              if (! found || (int32_t) (wake - wakeMicros) < 0) {
+                wakeMicros = wake;
+                found = true;
+              }
+              break;
+            }
+            // fall through
+
+          default:
+            wakeMicros = nowMicros;
+            return true;
+        }
+      }
+      return found;
+    }
+
+    /** The next wake time is now, or the top of the SleepQueue. */
+    bool nextWakeMicros(SchedulingMode<true>, uint32_t& wakeMicros) {
+      RunQueues<T_COROUTINE>* queues = RunQueues<T_COROUTINE>::getInstance();
+      if (! queues->isReadyEmpty()) {
+        wakeMicros = T_COROUTINE::coroutineMicros();
+        return true;
+      }
+
+      T_COROUTINE* sleeper = queues->getSleeping()->top();
+      if (sleeper == nullptr) return false;
+      wakeMicros = sleeper->getDelayWakeMicros();
+      return true;
+    }
+
+    /** Call the idle hook if the next wake time is in the future. */
+    template <bool T_QUEUED>
+    void callIdleHook(SchedulingMode<T_QUEUED> mode) {
+      uint32_t wakeMicros = 0;
+      if (! nextWakeMicros(mode, wakeMicros)) return;
+      if (mHasDeadline && (int32_t) (mDeadlineMicros - wakeMicros) < 0) {
+        wakeMicros = mDeadlineMicros;
+      }
+      if ((int32_t) (wakeMicros - T_COROUTINE::coroutineMicros()) > 0) {
+        unsigned long startCycles = beginSleep(
+            UsageMode<T_COROUTINE::kHasUsage>());
+        mIdleHook(wakeMicros);
+        endSleep(UsageMode<T_COROUTINE::kHasUsage>(), startCycles);
+        T_COROUTINE::coroutineSnapshotPass();
+      }
+    }
+
+    /** Run all coroutines once. */
+    void runAllInternal() {
+      T_COROUTINE::coroutineSnapshotPass();
+      beginSetupPass(SetupMode<T_COROUTINE::kHasLazySetup>());
+      drainWakeRings();
+      runAllInternal(SchedulingMode<T_COROUTINE::kHasQueue>());
+    }
+
+    /** Run each coroutine in the linked list once. */
+    void runAllInternal(SchedulingMode<false>) {
+      for (T_COROUTINE** p = T_COROUTINE::getRoot(); (*p) != nullptr; ) {
+        dispatchPolled(*p);
+        if (! reclaim(PoolingMode<T_COROUTINE::kHasPool>(), p)) {
+          p = (*p)->getNext();
+        }
+      }
+    }
+
+    /**
+     * Move the expired sleepers into the ready lists, then run each coroutine
+     * which is in a ready list at the start of the pass once, from the highest
+     * priority to the lowest.
+     */
+    void runAllInternal(SchedulingMode<true>) {
+      RunQueues<T_COROUTINE>* queues = RunQueues<T_COROUTINE>::getInstance();
+      SleepQueue<T_COROUTINE>* sleeping = queues->getSleeping();
+
+      uint32_t nowMicros = T_COROUTINE::coroutineMicros();
+      T_COROUTINE* sleeper;
+      while ((sleeper = sleeping->top()) != nullptr
+          && (int32_t) (nowMicros - sleeper->getDelayWakeMicros()) >= 0) {
+        queues->makeReady(sleeper);
+      }
+
+      // Coroutines which are requeued during this pass go to the back of the
+      // ready list, so counting them limits the pass to the current set.
+      for (uint8_t level = T_COROUTINE::kNumPriorities; level > 0; ) {
+        level--;
+        for (uint16_t count = queues->getReadySize(level); count > 0; count--) {
+          T_COROUTINE* coroutine = queues->popReady(level);
+          if (coroutine == nullptr) break;
+          dispatchQueued(coroutine);
         }
       }
+    }
+
+    /** Run coroutines until the budget is used up. */
+    uint32_t runForInternal(uint32_t budgetMicros) {
+      uint32_t startMicros = T_COROUTINE::coroutineMicros();
+      mDeadlineMicros = startMicros + budgetMicros;
+      mHasDeadline = true;
+      uint32_t unusedMicros;
+      while (true) {
+        bool dispatched = runCoroutine(
+            SchedulingMode<T_COROUTINE::kHasQueue>());
+        T_COROUTINE::coroutineSnapshotPass();
+        uint32_t elapsedMicros = T_COROUTINE::coroutineMicros() - startMicros;
+        if (elapsedMicros >= budgetMicros) {
+          unusedMicros = 0;
+          break;
+        }
+        if (! dispatched) {
+          unusedMicros = budgetMicros - elapsedMicros;
+          break;
+        }
+      }
+      mHasDeadline = false;
+      return unusedMicros;
+    }
 
+    /** Wake up the coroutines posted to each WakeRing. */
+    void drainWakeRings() {
+      for (WakeRingBase<T_COROUTINE>* ring = mWakeRings; ring != nullptr;
+          ring = ring->mNextRing) {
+        T_COROUTINE* coroutine;
+        while ((coroutine = ring->pop()) != nullptr) {
+          wakeUp(SchedulingMode<T_COROUTINE::kHasQueue>(), coroutine);
+        }
+      }
+    }
+
+    /** Run the posted coroutine now. */
+    static void wakeUp(SchedulingMode<false>, T_COROUTINE* coroutine) {
+      dispatchPolled(coroutine);
+    }
+
+    /** Move the posted coroutine to the front of its ready list. */
+    static void wakeUp(SchedulingMode<true>, T_COROUTINE* coroutine) {
+      RunQueues<T_COROUTINE>::getInstance()->wakeUp(coroutine);
+    }
+
+    /** Call runCoroutine(), with the optional trace and usage hooks. */
+    static void runDispatched(T_COROUTINE* coroutine) {
+      beginTraceDispatch(TraceMode<T_COROUTINE::kHasTrace>(), coroutine);
+      beginUsageDispatch(UsageMode<T_COROUTINE::kHasUsage>());
+      coroutine->runCoroutine();
+      endUsageDispatch(UsageMode<T_COROUTINE::kHasUsage>(), coroutine);
+      endTraceDispatch(TraceMode<T_COROUTINE::kHasTrace>());
+    }
+
+    /** Run the coroutine according to its status. */
+    static void dispatchPolled(T_COROUTINE* coroutine) {
     #if ACE_ROUTINE_DEBUG == 1
       Serial.print(F("Processing "));
-      Serial.print((uintptr_t) (*mCurrent));
+      Serial.print((uintptr_t) coroutine);
       Serial.println();
     #endif
 
       // Handle the coroutine's dispatch back to the last known internal status.
-      switch ((*mCurrent)->getStatus()) {
+      switch (coroutine->getStatus()) {
         case T_COROUTINE::kStatusYielding:
         case T_COROUTINE::kStatusDelaying:
+        case T_COROUTINE::kStatusWaiting:
+          if (! prepareSetup(SetupMode<T_COROUTINE::kHasLazySetup>(),
+              coroutine)) {
+            break;
+          }
+          T_COROUTINE::coroutineSnapshotDispatch();
+
           // The coroutine itself knows whether it is yielding or delaying, and
           // its continuation context determines whether to call
           // Coroutine::isDelayExpired(), Coroutine::isDelayMicrosExpired(), or
           // Coroutine::isDelaySecondsExpired().
-          (*mCurrent)->runCoroutine();
+          runDispatched(coroutine);
           break;
 
         case T_COROUTINE::kStatusEnding:
           // mark it terminated
-          (*mCurrent)->setTerminated();
+          coroutine->setTerminated();
           break;
 
         default:
           // For all other cases, just skip to the next coroutine.
           break;
       }
+    }
+
+    /**
+     * Run the coroutine, which has been removed from the RunQueues, then put
+     * it back into the queue which matches its new status.
+     */
+    static void dispatchQueued(T_COROUTINE* coroutine) {
+    #if ACE_ROUTINE_DEBUG == 1
+      Serial.print(F("Processing "));
+      Serial.print((uintptr_t) coroutine);
+      Serial.println();
+    #endif
+
+      switch (coroutine->getStatus()) {
+        case T_COROUTINE::kStatusYielding:
+        case T_COROUTINE::kStatusDelaying:
+        case T_COROUTINE::kStatusWaiting:
+          if (! prepareSetup(SetupMode<T_COROUTINE::kHasLazySetup>(),
+              coroutine)) {
+            break;
+          }
+          T_COROUTINE::coroutineSnapshotDispatch();
+          runDispatched(coroutine);
+          break;
+
+        case T_COROUTINE::kStatusEnding:
+          // setTerminated() moves it to the parked list.
+          coroutine->setTerminated();
+          release(PoolingMode<T_COROUTINE::kHasPool>(), coroutine);
+          return;
+
+        default:
+          break;
+      }
 
-      // Go to the next coroutine
-      mCurrent = (*mCurrent)->getNext();
+      // The coroutine may have moved itself into a queue using reset(), or
+      // into the wait list of an event using COROUTINE_AWAIT_EVENT().
+      if (coroutine->getQueueId() == CoroutineQueueNode::kQueueNone) {
+        requeue(coroutine);
+      }
+    }
+
+    /** Nothing to reclaim without the Coroutine_Pool_Impl layer. */
+    static bool reclaim(PoolingMode<false>, T_COROUTINE** /*p*/) {
+      return false;
+    }
+
+    /**
+     * If the coroutine at 'p' in the singly-linked list is terminated and
+     * belongs to a CoroutinePool, unlink it and return it to its pool. Return
+     * true if it was reclaimed.
+     */
+    bool reclaim(PoolingMode<true>, T_COROUTINE** p) {
+      T_COROUTINE* coroutine = *p;
+      if (! coroutine->isTerminated()) return false;
+      CoroutinePoolBase* pool = coroutine->getPool();
+      if (pool == nullptr) return false;
+
+      *p = *coroutine->getNext();
+      if (mCurrent == coroutine->getNext()) mCurrent = p;
+      pool->reclaim(coroutine);
+      return true;
     }
 
+    /** Nothing to release without the Coroutine_Pool_Impl layer. */
+    static void release(PoolingMode<false>, T_COROUTINE* /*coroutine*/) {}
+
+    /**
+     * Remove the terminated coroutine from the parked list and return it to
+     * its CoroutinePool, if it belongs to one. In the queued mode, a pooled
+     * coroutine is not in the singly-linked list.
+     */
+    static void release(PoolingMode<true>, T_COROUTINE* coroutine) {
+      CoroutinePoolBase* pool = coroutine->getPool();
+      if (pool == nullptr) return;
+
+      RunQueues<T_COROUTINE>::getInstance()->unlink(coroutine);
+      pool->reclaim(coroutine);
+    }
+
+    /** Move the coroutine into the queue which matches its status. */
+    static void requeue(T_COROUTINE* coroutine) {
+      RunQueues<T_COROUTINE>* queues = RunQueues<T_COROUTINE>::getInstance();
+      switch (coroutine->getStatus()) {
+        case T_COROUTINE::kStatusSuspended:
+        case T_COROUTINE::kStatusTerminated:
+          queues->park(coroutine);
+          break;
+
+        case T_COROUTINE::kStatusDelaying:
+          if (T_COROUTINE::kHasWakeTime) {
+            queues->sleep(coroutine);
+          } else {
+            queues->makeReady(coroutine);
+          }
+          break;
+
+        case T_COROUTINE::kStatusWaiting:
+          // Leave it in the wait list of its event.
+          if (coroutine->getQueueId() == CoroutineQueueNode::kQueueWaiting) {
+            break;
+          }
+          queues->makeReady(coroutine);
+          break;
+
+        default:
+          queues->makeReady(coroutine);
+          break;
+      }
+    }
 
     /** List all the routines in the linked list to the printer. */
     void listCoroutines(Print& printer) {
@@ -206,6 +894,18 @@ class CoroutineSchedulerTemplate {
     // allows the root node to be treated the same as all the other nodes, and
     // simplifies the code that traverses the singly-linked list.
     T_COROUTINE** mCurrent = nullptr;
+
+    /** Called when no coroutine is runnable. Optional. */
+    IdleHook mIdleHook = nullptr;
+
+    /** End of the budget of runFor(), the latest wake time of the IdleHook. */
+    uint32_t mDeadlineMicros = 0;
+
+    /** True while runFor() is running. */
+    bool mHasDeadline = false;
+
+    /** List of rings of coroutines posted by interrupts. Optional. */
+    WakeRingBase<T_COROUTINE>* mWakeRings = nullptr;
 };
 
 using CoroutineScheduler = CoroutineSchedulerTemplate<Coroutine>;
@@ -0,0 +1,185 @@
+/*
+MIT License
+
+Copyright (c) 2021 Brian T. Park
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ACE_ROUTINE_COROUTINE_SETUP_H
+#define ACE_ROUTINE_COROUTINE_SETUP_H
+
+#include <stdint.h>
+
+namespace ace_routine {
+
+/**
+ * Tag type used to select at compile time whether the CoroutineScheduler sets
+ * up the coroutines lazily, using the `kHasLazySetup` trait of the Coroutine
+ * type. See SchedulingMode.
+ */
+template <bool T_LAZY> struct SetupMode {};
+
+/**
+ * This layer inherits from the Named/Unnamed classes (or from the other
+ * layers below the delay policy) and lets the CoroutineScheduler call the
+ * setupCoroutine() of each coroutine lazily, just before its first dispatch,
+ * instead of all of them in CoroutineScheduler::setupCoroutines() before the
+ * first pass. For example:
+ *
+ * @code
+ * using LazyCoroutine = CoroutineTemplate<Coroutine_Delay_16bit_Impl<
+ *     Coroutine_LazySetup_Impl<UnnamedCoroutine>, ClockInterface>>;
+ * using LazyScheduler = CoroutineSchedulerTemplate<LazyCoroutine>;
+ * @endcode
+ *
+ * If the scheduler has a setup budget (see
+ * CoroutineSchedulerTemplate::setSetupBudget()), the setups are spread over
+ * the passes of the scheduler, in decreasing order of setup priority, and a
+ * coroutine is not run until it has been set up.
+ *
+ * It costs 2 bytes of RAM per coroutine.
+ *
+ * @tparam T_BASE the Named/Unnamed base class, or another layer
+ */
+template <typename T_BASE>
+class Coroutine_LazySetup_Impl : public T_BASE {
+  public:
+    /** The CoroutineScheduler should call setupCoroutine() lazily. */
+    static const bool kHasLazySetup = true;
+
+    /**
+     * Set the setup priority, from 0 (the default, set up last) to 255 (set
+     * up first). Used only with a setup budget.
+     */
+    void setSetupPriority(uint8_t priority) { mSetupPriority = priority; }
+
+    /** Return the setup priority. */
+    uint8_t getSetupPriority() const { return mSetupPriority; }
+
+    /** Return true if setupCoroutine() has been called. */
+    bool isSetUp() const { return mIsSetUp; }
+
+    /** Used by the CoroutineScheduler after calling setupCoroutine(). */
+    void markSetUp() { mIsSetUp = true; }
+
+  private:
+    uint8_t mSetupPriority = 0;
+    bool mIsSetUp = false;
+};
+
+/**
+ * The state of the lazy setup of the CoroutineScheduler, for the Coroutine
+ * types with the Coroutine_LazySetup_Impl layer. There is one instance per
+ * Coroutine type, returned by getInstance(), so that the CoroutineScheduler
+ * of the other types does not carry it.
+ */
+template <typename T_COROUTINE>
+class LazySetup {
+  public:
+    /** Return the LazySetup of the T_COROUTINE type. */
+    static LazySetup* getInstance() {
+      static LazySetup setup;
+      return &setup;
+    }
+
+    /**
+     * Set the maximum number of setups per pass. 0 (the default) means no
+     * limit, i.e. each coroutine is set up just before its first dispatch.
+     * See beginDispatch() for the passes of the queued CoroutineScheduler.
+     */
+    void setBudget(uint8_t budget) { mBudget = budget; }
+
+    /** Look for pending setups again, e.g. after new coroutines were added. */
+    void reset() { mHasPending = true; }
+
+    /**
+     * Start a pass of the scheduler. With a budget, find the highest setup
+     * priority of the coroutines of the singly-linked list which are waiting
+     * for their setup, and are not suspended. Only those can be set up in this
+     * pass. Once there are none, the list is no longer scanned.
+     */
+    void beginPass() {
+      mCount = 0;
+      mPassLeft = 0;
+      if (mBudget == 0 || ! mHasPending) return;
+
+      bool found = false;
+      uint8_t highest = 0;
+      uint16_t size = 0;
+      for (T_COROUTINE** p = T_COROUTINE::getRoot(); (*p) != nullptr;
+          p = (*p)->getNext()) {
+        T_COROUTINE* coroutine = *p;
+        size++;
+        if (coroutine->isSetUp() || coroutine->isSuspended()) continue;
+        if (! found || coroutine->getSetupPriority() > highest) {
+          highest = coroutine->getSetupPriority();
+          found = true;
+        }
+      }
+      mHasPending = found;
+      mPriority = highest;
+      mPassLeft = size;
+    }
+
+    /**
+     * Called before each dispatch of the queued CoroutineScheduler, which has
+     * no natural end of pass. A pass lasts as many dispatches as there are
+     * coroutines in the singly-linked list, i.e. about one round of the ready
+     * lists, so that the list is scanned at most once per round, and the
+     * budget applies to each round.
+     */
+    void beginDispatch() {
+      if (mPassLeft > 1) {
+        mPassLeft--;
+      } else {
+        beginPass();
+      }
+    }
+
+    /**
+     * Called before running the coroutine. Call its setupCoroutine() if it
+     * has not been set up, and the budget and the priority of this pass
+     * allow it. Return true if the coroutine can run.
+     */
+    bool prepare(T_COROUTINE* coroutine) {
+      if (coroutine->isSetUp()) return true;
+      if (mBudget != 0) {
+        if (mCount >= mBudget) return false;
+        if (coroutine->getSetupPriority() < mPriority) return false;
+        mCount++;
+      }
+      coroutine->setupCoroutine();
+      coroutine->markSetUp();
+      return true;
+    }
+
+  private:
+    uint8_t mBudget = 0;
+    uint8_t mCount = 0;
+    uint8_t mPriority = 0;
+    bool mHasPending = true;
+
+    /** Number of dispatches left in the pass of the queued scheduler. */
+    uint16_t mPassLeft = 0;
+};
+
+}
+
+#endif
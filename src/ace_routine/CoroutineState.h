@@ -0,0 +1,141 @@
+/*
+MIT License
+
+Copyright (c) 2021 Brian T. Park
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#ifndef ACE_ROUTINE_COROUTINE_STATE_H
+#define ACE_ROUTINE_COROUTINE_STATE_H
+
+#include <stddef.h> // size_t, max_align_t
+#include <stdint.h>
+#include "FrameArena.h"
+
+namespace ace_routine {
+
+/**
+ * This layer inherits from the Named/Unnamed classes (or from another layer
+ * such as Coroutine_Queue_Impl) and reserves T_SIZE bytes in each coroutine
+ * for the state declared with COROUTINE_STATE(). For example:
+ *
+ * @code
+ * using StateCoroutine = CoroutineTemplate<Coroutine_Delay_16bit_Impl<
+ *     Coroutine_State_Impl<UnnamedCoroutine, 8>, ClockInterface>>;
+ * @endcode
+ *
+ * The state is kept for the whole life of the coroutine. A state larger
+ * than T_SIZE is a compile-time error. See Coroutine_StateArena_Impl for a
+ * layer which holds the state only while the coroutine is running.
+ *
+ * @tparam T_BASE the Named/Unnamed base class
+ * @tparam T_SIZE the largest state, in bytes
+ */
+template <typename T_BASE, size_t T_SIZE>
+class Coroutine_State_Impl : public T_BASE {
+  public:
+    /** Return the memory of the state. */
+    void* getStateBlock() { return mState; }
+
+    /** Return the memory of a new state of T_STATE_SIZE bytes. */
+    template <size_t T_STATE_SIZE>
+    void* allocateStateBlock() {
+      static_assert(T_STATE_SIZE <= T_SIZE,
+          "COROUTINE_STATE() is larger than the size of Coroutine_State_Impl");
+      return mState;
+    }
+
+    /** Nothing to release, the memory belongs to the coroutine. */
+    void releaseState() {}
+
+  private:
+    alignas(max_align_t) uint8_t mState[T_SIZE];
+};
+
+/**
+ * This layer inherits from the Named/Unnamed classes (or from another layer)
+ * and allocates the state declared with COROUTINE_STATE() from a FrameArena
+ * shared by all coroutines of the same Coroutine type, which must be set with
+ * setStateArena() before the coroutines run. For example:
+ *
+ * @code
+ * using JobCoroutine = CoroutineTemplate<Coroutine_Delay_16bit_Impl<
+ *     Coroutine_StateArena_Impl<UnnamedCoroutine>, ClockInterface>>;
+ *
+ * FrameArenaTemplate<16, 4> stateArena; // 4 states of up to 16 bytes
+ *
+ * void setup() {
+ *   JobCoroutine::setStateArena(&stateArena);
+ *   ...
+ * }
+ * @endcode
+ *
+ * The state is allocated when the coroutine starts, and is returned to the
+ * arena when it ends, or when it is reset(). So the RAM is used only by the
+ * coroutines which are active, at the cost of 1 pointer per coroutine. If the
+ * arena is full, the coroutine does not start, and tries again on the next
+ * call to runCoroutine().
+ *
+ * @tparam T_BASE the Named/Unnamed base class
+ */
+template <typename T_BASE>
+class Coroutine_StateArena_Impl : public T_BASE {
+  public:
+    /** Set the arena of the states of all coroutines of this type. */
+    static void setStateArena(FrameArena* arena) { *getStateArena() = arena; }
+
+    /** Return the memory of the state, nullptr if not allocated. */
+    void* getStateBlock() { return mState; }
+
+    /**
+     * Allocate the memory of a new state of T_STATE_SIZE bytes, or reuse the
+     * current one. Return nullptr if the arena is full.
+     */
+    template <size_t T_STATE_SIZE>
+    void* allocateStateBlock() {
+      if (mState == nullptr) {
+        mState = (*getStateArena())->allocateFrame(T_STATE_SIZE);
+      }
+      return mState;
+    }
+
+    /** Return the state to the arena. */
+    void releaseState() {
+      if (mState != nullptr) {
+        FrameArena::deallocateFrame(mState);
+        mState = nullptr;
+      }
+    }
+
+  private:
+    /**
+     * Pointer to the arena. Implemented as a function static for the same
+     * reason as CoroutineTemplate::getRoot().
+     */
+    static FrameArena** getStateArena() {
+      static FrameArena* arena;
+      return &arena;
+    }
+
+    void* mState = nullptr;
+};
+
+}
+
+#endif
@@ -0,0 +1,270 @@
+/*
+MIT License
+
+Copyright (c) 2021 Brian T. Park
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#ifndef ACE_ROUTINE_COROUTINE_TRACE_H
+#define ACE_ROUTINE_COROUTINE_TRACE_H
+
+#include <stdint.h>
+#include <Print.h> // Print
+
+namespace ace_routine {
+
+/**
+ * Tag type used to select at compile time whether the coroutines and the
+ * CoroutineScheduler record trace events, using the `kHasTrace` trait of the
+ * Coroutine type. See SchedulingMode.
+ */
+template <bool T_TRACED> struct TraceMode {};
+
+/**
+ * One event of a TraceRing: the coroutine `id` (see
+ * Coroutine_Trace_Impl::getTraceId()) moved to the status `event` (one of the
+ * kStatusXxx constants of the Coroutine) at the time `cycles` (the
+ * T_CLOCK::cycles() of the Coroutine), or was dispatched by the scheduler
+ * (kEventDispatch).
+ */
+struct TraceEvent {
+  /**
+   * The CoroutineScheduler called runCoroutine(), and the coroutine changed
+   * its status. See CoroutineTrace.
+   */
+  static const uint8_t kEventDispatch = 16;
+
+  uint32_t cycles;
+  uint8_t id;
+  uint8_t event;
+};
+
+/**
+ * A ring of TraceEvents, which keeps the most recent ones. The coroutines and
+ * the CoroutineScheduler of a Coroutine type with the Coroutine_Trace_Impl
+ * layer record into it once it is attached with
+ * CoroutineSchedulerTemplate::setTraceRing().
+ *
+ * The events are written by a single producer, the thread of the scheduler,
+ * without locks. The count is free-running, and published with a release
+ * store after the event is written, so the events can be read from the same
+ * thread, or from another thread on Linux. A reader in another thread may see
+ * the oldest events overwritten while it reads, unless the ring is detached
+ * first.
+ *
+ * This class holds the logic without the storage, so that the scheduler does
+ * not depend on the size of the ring. Create a TraceRing instead.
+ */
+class TraceRingBase {
+  public:
+    /** Record an event, overwriting the oldest one if the ring is full. */
+    void record(uint8_t id, uint8_t event, uint32_t cycles) {
+      uint32_t count = mCount;
+      TraceEvent& slot = mEvents[count & mMask];
+      slot.cycles = cycles;
+      slot.id = id;
+      slot.event = event;
+      __atomic_store_n(&mCount, count + 1, __ATOMIC_RELEASE);
+    }
+
+    /** Return the number of events in the ring, at most its size. */
+    uint16_t getNumEvents() const {
+      uint32_t count = __atomic_load_n(&mCount, __ATOMIC_ACQUIRE);
+      return (count > mMask) ? (uint16_t) (mMask + 1) : (uint16_t) count;
+    }
+
+    /** Return the number of events which were overwritten. */
+    uint32_t getLost() const {
+      uint32_t count = __atomic_load_n(&mCount, __ATOMIC_ACQUIRE);
+      return (count > mMask) ? count - mMask - 1 : 0;
+    }
+
+    /** Return the i-th event in the ring, 0 being the oldest. */
+    const TraceEvent& getEvent(uint16_t i) const {
+      uint32_t count = __atomic_load_n(&mCount, __ATOMIC_ACQUIRE);
+      uint32_t first = (count > mMask) ? count - mMask - 1 : 0;
+      return mEvents[(first + i) & mMask];
+    }
+
+    /** Remove all the events. */
+    void clear() { __atomic_store_n(&mCount, 0, __ATOMIC_RELEASE); }
+
+    /**
+     * Print the events from the oldest to the newest, one per line, as
+     * "cycles id event" in decimal. This is the format read by
+     * examples/Tracing/trace_to_chrome.py.
+     */
+    void printEventsTo(Print& printer) const {
+      uint16_t numEvents = getNumEvents();
+      for (uint16_t i = 0; i < numEvents; i++) {
+        const TraceEvent& event = getEvent(i);
+        printer.print(event.cycles);
+        printer.print(' ');
+        printer.print(event.id);
+        printer.print(' ');
+        printer.print(event.event);
+        printer.println();
+      }
+    }
+
+  protected:
+    /** Constructor, with the storage of size (mask + 1) of the subclass. */
+    TraceRingBase(TraceEvent* events, uint16_t mask) :
+        mEvents(events),
+        mMask(mask)
+    {}
+
+  private:
+    // Disable copy-constructor and assignment operator
+    TraceRingBase(const TraceRingBase&) = delete;
+    TraceRingBase& operator=(const TraceRingBase&) = delete;
+
+    TraceEvent* const mEvents;
+    const uint16_t mMask;
+
+    /** Number of events recorded since the last clear(). */
+    uint32_t mCount = 0;
+};
+
+/**
+ * A TraceRingBase with storage for T_SIZE events, of 6 bytes on 8-bit
+ * processors and 8 bytes on 32-bit processors. For example:
+ *
+ * @code
+ * using TracedCoroutine = CoroutineTemplate<Coroutine_Delay_16bit_Impl<
+ *     Coroutine_Trace_Impl<UnnamedCoroutine>, ClockInterface>>;
+ * using TracedScheduler = CoroutineSchedulerTemplate<TracedCoroutine>;
+ *
+ * TraceRing<256> traceRing;
+ *
+ * void setup() {
+ *   TracedScheduler::setTraceRing(&traceRing);
+ *   TracedScheduler::setup();
+ * }
+ * @endcode
+ *
+ * @tparam T_SIZE number of events, a power of 2 between 1 and 32768
+ */
+template <uint16_t T_SIZE>
+class TraceRing : public TraceRingBase {
+  static_assert(T_SIZE > 0 && T_SIZE <= 32768 && (T_SIZE & (T_SIZE - 1)) == 0,
+      "T_SIZE must be a power of 2 between 1 and 32768");
+
+  public:
+    /** Constructor. */
+    TraceRing() : TraceRingBase(mStorage, T_SIZE - 1) {}
+
+  private:
+    TraceEvent mStorage[T_SIZE];
+};
+
+/**
+ * This layer inherits from the Named/Unnamed classes (or from the other
+ * layers below the delay policy) and makes the coroutines record their status
+ * transitions, and the CoroutineScheduler record its dispatches, into the
+ * TraceRing given to CoroutineSchedulerTemplate::setTraceRing(). For example:
+ *
+ * @code
+ * using TracedCoroutine = CoroutineTemplate<Coroutine_Delay_16bit_Impl<
+ *     Coroutine_Trace_Impl<NamedCoroutine>, ClockInterface>>;
+ * @endcode
+ *
+ * Each coroutine is identified in the events by its trace id. The
+ * CoroutineScheduler::setup() numbers the coroutines whose id is still 0 from
+ * 1, in the order of the singly-linked list.
+ *
+ * It costs 1 byte of RAM per coroutine.
+ *
+ * @tparam T_BASE the Named/Unnamed base class, or another layer
+ */
+template <typename T_BASE>
+class Coroutine_Trace_Impl : public T_BASE {
+  public:
+    /** The coroutines and the CoroutineScheduler record trace events. */
+    static const bool kHasTrace = true;
+
+    /** Set the id of the coroutine in the trace events, 1 to 255. */
+    void setTraceId(uint8_t id) { mTraceId = id; }
+
+    /** Return the id of the coroutine in the trace events. */
+    uint8_t getTraceId() const { return mTraceId; }
+
+  private:
+    uint8_t mTraceId = 0;
+};
+
+/**
+ * The TraceRing of a Coroutine type with the Coroutine_Trace_Impl layer.
+ * There is one instance per Coroutine type, returned by getInstance(), which
+ * is shared by its coroutines and its CoroutineScheduler.
+ *
+ * The dispatch of a coroutine is recorded only if the coroutine changes its
+ * status during the dispatch, just before its first transition, with the time
+ * of the dispatch. So the polls of a delaying coroutine whose delay has not
+ * expired, by the polling scheduler, do not fill up the ring.
+ */
+template <typename T_COROUTINE>
+class CoroutineTrace {
+  public:
+    /** Return the CoroutineTrace of the T_COROUTINE type. */
+    static CoroutineTrace* getInstance() {
+      static CoroutineTrace trace;
+      return &trace;
+    }
+
+    /** Set the ring of the events, or nullptr to stop recording. */
+    void setRing(TraceRingBase* ring) { mRing = ring; }
+
+    /** Return the ring of the events, or nullptr. */
+    TraceRingBase* getRing() const { return mRing; }
+
+    /** Record an event of the coroutine, at the current T_CLOCK::cycles(). */
+    void record(const T_COROUTINE* coroutine, uint8_t event) {
+      if (mRing == nullptr) return;
+      if (mDispatching) {
+        mDispatching = false;
+        mRing->record(mDispatchId, TraceEvent::kEventDispatch, mDispatchCycles);
+      }
+      mRing->record(coroutine->getTraceId(), event,
+          T_COROUTINE::coroutineCycles());
+    }
+
+    /** The scheduler is about to call runCoroutine() of a coroutine. */
+    void beginDispatch(const T_COROUTINE* coroutine) {
+      if (mRing == nullptr) return;
+      mDispatching = true;
+      mDispatchId = coroutine->getTraceId();
+      mDispatchCycles = T_COROUTINE::coroutineCycles();
+    }
+
+    /** The runCoroutine() of the dispatched coroutine has returned. */
+    void endDispatch() { mDispatching = false; }
+
+  private:
+    TraceRingBase* mRing = nullptr;
+    uint32_t mDispatchCycles = 0;
+    uint8_t mDispatchId = 0;
+    bool mDispatching = false;
+};
+
+}
+
+#endif
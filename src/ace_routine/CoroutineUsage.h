@@ -0,0 +1,237 @@
+/*
+MIT License
+
+Copyright (c) 2021 Brian T. Park
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ACE_ROUTINE_COROUTINE_USAGE_H
+#define ACE_ROUTINE_COROUTINE_USAGE_H
+
+#include <stdint.h>
+
+namespace ace_routine {
+
+/**
+ * Tag type used to select at compile time whether the CoroutineScheduler
+ * accounts for the CPU usage of the coroutines, using the `kHasUsage` trait of
+ * the Coroutine type. See SchedulingMode.
+ */
+template <bool T_COUNTED> struct UsageMode {};
+
+/**
+ * The usage counters of one coroutine, returned by
+ * Coroutine_Usage_Impl::getUsage(). The cycles are those of the clock of the
+ * delay policy (T_CLOCK::cycles()), and `unsigned long` like it, so they
+ * wrap around like the clock. The difference between 2 snapshots is correct
+ * as long as they are taken more often than the wrap-around period.
+ */
+struct CoroutineUsage {
+  /** Number of calls to runCoroutine() by the CoroutineScheduler. */
+  uint32_t dispatches;
+
+  /**
+   * Number of dispatches which did not change the status of the coroutine,
+   * e.g. a delay which had not expired, or a COROUTINE_AWAIT() whose
+   * condition was false. Their cycles are counted as scheduler overhead.
+   */
+  uint32_t idlePasses;
+
+  /**
+   * Cycles spent in the other dispatches, including the lazy
+   * setupCoroutine() of the coroutine. See CoroutineUsageCounter.
+   */
+  unsigned long busyCycles;
+};
+
+/**
+ * The usage counters of a CoroutineScheduler, returned by
+ * CoroutineSchedulerTemplate::getUsage(). The dispatches, idle passes and
+ * busy cycles are the sums over the coroutines. The loop cycles are measured
+ * around each call to loop(), runAll() and runFor(), and include the sleep
+ * cycles spent in the IdleHook.
+ */
+struct SchedulerUsage {
+  /** Number of calls to loop(), runAll() and runFor(). */
+  uint32_t loops;
+
+  /** Total number of dispatches. */
+  uint32_t dispatches;
+
+  /** Total number of idle passes. */
+  uint32_t idlePasses;
+
+  /** Cycles spent in loop(), runAll() and runFor(). */
+  unsigned long loopCycles;
+
+  /** Cycles spent in the dispatches which were not idle passes. */
+  unsigned long busyCycles;
+
+  /** Cycles spent in the IdleHook. */
+  unsigned long sleepCycles;
+
+  /**
+   * Return the cycles spent by the scheduler itself, including the idle
+   * passes, i.e. the loop cycles which were neither busy nor asleep.
+   */
+  unsigned long getOverheadCycles() const {
+    return loopCycles - busyCycles - sleepCycles;
+  }
+};
+
+/**
+ * This layer inherits from the Named/Unnamed classes (or from the other
+ * layers below the delay policy) and makes the CoroutineScheduler count the
+ * dispatches, the idle passes and the busy cycles of each coroutine, and the
+ * time spent in its own loop(). For example:
+ *
+ * @code
+ * using CountedCoroutine = CoroutineTemplate<Coroutine_Delay_16bit_Impl<
+ *     Coroutine_Usage_Impl<UnnamedCoroutine>, ClockInterface>>;
+ * using CountedScheduler = CoroutineSchedulerTemplate<CountedCoroutine>;
+ * @endcode
+ *
+ * Unlike the Profiler, it does not need an object per coroutine, nor the
+ * Coroutine_Delay_32bit_Profiler_Impl delay policy. Each dispatch costs 2
+ * reads of T_CLOCK::cycles() and a few additions, and each call to loop(),
+ * runAll() or runFor() 1 more read.
+ *
+ * It costs 12 bytes of RAM per coroutine on 8-bit and most 32-bit processors,
+ * 16 bytes where `unsigned long` is 64 bits.
+ *
+ * @tparam T_BASE the Named/Unnamed base class, or another layer
+ */
+template <typename T_BASE>
+class Coroutine_Usage_Impl : public T_BASE {
+  public:
+    /** The CoroutineScheduler counts the usage of the coroutines. */
+    static const bool kHasUsage = true;
+
+    /** Return the usage counters of the coroutine. */
+    const CoroutineUsage& getUsage() const { return mUsage; }
+
+    /** Reset the usage counters of the coroutine to 0. */
+    void clearUsage() { mUsage = CoroutineUsage(); }
+
+    /** Used by the CoroutineScheduler after each dispatch. */
+    void addDispatch(bool idle, unsigned long cycles) {
+      mUsage.dispatches++;
+      if (idle) {
+        mUsage.idlePasses++;
+      } else {
+        mUsage.busyCycles += cycles;
+      }
+    }
+
+  private:
+    CoroutineUsage mUsage = CoroutineUsage();
+};
+
+/**
+ * The usage counters of the CoroutineScheduler of a Coroutine type with the
+ * Coroutine_Usage_Impl layer. There is one instance per Coroutine type,
+ * returned by getInstance(), so that the CoroutineScheduler of the other types
+ * does not carry it.
+ */
+template <typename T_COROUTINE>
+class CoroutineUsageCounter {
+  public:
+    /** Return the CoroutineUsageCounter of the T_COROUTINE type. */
+    static CoroutineUsageCounter* getInstance() {
+      static CoroutineUsageCounter counter;
+      return &counter;
+    }
+
+    /** Return the counters of the scheduler. */
+    const SchedulerUsage& getUsage() const { return mUsage; }
+
+    /** Reset the counters of the scheduler to 0. */
+    void clear() { mUsage = SchedulerUsage(); }
+
+    /** Called by the coroutines when their status changes. */
+    void noteTransition() { mTransition = true; }
+
+    /** Start a loop, and return its start time. */
+    unsigned long beginLoop() {
+      mMark = T_COROUTINE::coroutineCycles();
+      return mMark;
+    }
+
+    /**
+     * Count the loop which started at 'startCycles'. It ends at the last
+     * mark, to save a read of the clock, unless nothing was dispatched. The
+     * few instructions of the scheduler after the last dispatch are not
+     * counted.
+     */
+    void endLoop(unsigned long startCycles) {
+      unsigned long end = (mMark != startCycles)
+          ? mMark : T_COROUTINE::coroutineCycles();
+      mUsage.loops++;
+      mUsage.loopCycles += end - startCycles;
+    }
+
+    /**
+     * Start a dispatch. The clock is read again here, instead of reusing the
+     * end of the previous dispatch, so that the work of the scheduler between
+     * 2 dispatches (walking the list, the queues, the WakeRing, the lazy
+     * setupCoroutine()) is counted as overhead, not as busy cycles.
+     */
+    void beginDispatch() {
+      mTransition = false;
+      mMark = T_COROUTINE::coroutineCycles();
+    }
+
+    /** Count the dispatch of the coroutine which started at the mark. */
+    void endDispatch(T_COROUTINE* coroutine) {
+      unsigned long now = T_COROUTINE::coroutineCycles();
+      unsigned long cycles = now - mMark;
+      mMark = now;
+      bool idle = ! mTransition;
+      coroutine->addDispatch(idle, cycles);
+      mUsage.dispatches++;
+      if (idle) {
+        mUsage.idlePasses++;
+      } else {
+        mUsage.busyCycles += cycles;
+      }
+    }
+
+    /** Count the IdleHook which started at 'startCycles'. */
+    void endSleep(unsigned long startCycles) {
+      mMark = T_COROUTINE::coroutineCycles();
+      mUsage.sleepCycles += mMark - startCycles;
+    }
+
+  private:
+    SchedulerUsage mUsage = SchedulerUsage();
+
+    /**
+     * The start or the end of the last dispatch, the end of the last sleep, or
+     * the start of the loop.
+     */
+    unsigned long mMark = 0;
+
+    /** Set when a coroutine changes its status during the dispatch. */
+    bool mTransition = false;
+};
+
+}
+
+#endif
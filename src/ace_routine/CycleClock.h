@@ -0,0 +1,204 @@
+/*
+MIT License
+
+Copyright (c) 2021 Brian T. Park
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ACE_ROUTINE_CYCLE_CLOCK_H
+#define ACE_ROUTINE_CYCLE_CLOCK_H
+
+/**
+ * @file CycleClock.h
+ *
+ * Variants of ClockInterface whose cycles() reads a high resolution counter,
+ * for the run time profilers of Coroutine_Delay_32bit_Profiler_Impl, instead
+ * of the micros() of ClockInterface. Their millis(), micros() and seconds()
+ * are those of ClockInterface, so the delays are not affected.
+ *
+ * * MonotonicRawClockInterface: the nanoseconds of
+ *   `clock_gettime(CLOCK_MONOTONIC_RAW)`, on Linux.
+ *   ACE_ROUTINE_MONOTONIC_RAW_CLOCK is defined to 1 if it is available.
+ * * TscClockInterface: the time stamp counter of the x86 processors, read by
+ *   `rdtsc`, on Linux. ACE_ROUTINE_TSC_CLOCK is defined to 1 if it is
+ *   available.
+ * * EspCycleClockInterface: the cycle counter of the ESP8266 and ESP32.
+ *   ACE_ROUTINE_ESP_CYCLE_CLOCK is defined to 1 if it is available.
+ * * CycleClockInterface: the first available of TscClockInterface,
+ *   MonotonicRawClockInterface and EspCycleClockInterface, or ClockInterface
+ *   as the portable fallback.
+ *
+ * The cycles() are truncated to `unsigned long`, so they wrap around after a
+ * few seconds with a 32-bit `unsigned long`, which is enough for the run time
+ * of a coroutine.
+ */
+
+#include "ClockInterface.h"
+
+#if defined(__linux__) && ! defined(ARDUINO_ARCH_AVR)
+  #include <time.h> // clock_gettime(), nanosleep()
+  #if defined(CLOCK_MONOTONIC_RAW)
+    #define ACE_ROUTINE_MONOTONIC_RAW_CLOCK 1
+    #if defined(__x86_64__) || defined(__i386__)
+      #define ACE_ROUTINE_TSC_CLOCK 1
+    #endif
+  #endif
+#endif
+
+#if defined(ESP8266) || defined(ESP32)
+  #define ACE_ROUTINE_ESP_CYCLE_CLOCK 1
+#endif
+
+#if ! defined(ACE_ROUTINE_MONOTONIC_RAW_CLOCK)
+  #define ACE_ROUTINE_MONOTONIC_RAW_CLOCK 0
+#endif
+
+#if ! defined(ACE_ROUTINE_TSC_CLOCK)
+  #define ACE_ROUTINE_TSC_CLOCK 0
+#endif
+
+#if ! defined(ACE_ROUTINE_ESP_CYCLE_CLOCK)
+  #define ACE_ROUTINE_ESP_CYCLE_CLOCK 0
+#endif
+
+namespace ace_routine {
+
+#if ACE_ROUTINE_MONOTONIC_RAW_CLOCK
+
+/**
+ * A ClockInterface whose cycles() are the nanoseconds of
+ * `clock_gettime(CLOCK_MONOTONIC_RAW)`, which is not slewed by NTP. It is
+ * read through the vDSO, without a system call, on most Linux systems. No
+ * calibration is needed.
+ */
+class MonotonicRawClockInterface : public ClockInterface {
+  public:
+    /** Get the nanoseconds of CLOCK_MONOTONIC_RAW. */
+    static unsigned long cycles() {
+      struct timespec ts;
+      clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+      return (unsigned long) ts.tv_sec * 1000000000UL
+          + (unsigned long) ts.tv_nsec;
+    }
+
+    /** One cycle per nanosecond. */
+    static unsigned long cycles_per_second() { return 1000000000UL; }
+};
+
+#endif
+
+#if ACE_ROUTINE_TSC_CLOCK
+
+/**
+ * A ClockInterface whose cycles() are the time stamp counter of the x86
+ * processor, read by `rdtsc`. This is the cheapest clock on Linux, but it
+ * counts at a constant rate only on the processors with an invariant TSC
+ * (`constant_tsc` and `nonstop_tsc` in /proc/cpuinfo), which includes most
+ * processors since 2008. The rdtsc instruction does not wait for the previous
+ * instructions to complete, which is negligible at the scale of a coroutine.
+ *
+ * The rate of the counter is measured against CLOCK_MONOTONIC_RAW over 10
+ * milliseconds, on the first call to cycles_per_second(), e.g. when the
+ * profiler is given to Coroutine_Delay_32bit_Profiler_Impl::setRunProfiler().
+ * Call calibrate() in setup() to measure it earlier.
+ */
+class TscClockInterface : public ClockInterface {
+  public:
+    /** Get the time stamp counter. */
+    static unsigned long cycles() {
+      return (unsigned long) __builtin_ia32_rdtsc();
+    }
+
+    /**
+     * Return the measured rate of the time stamp counter. It is a uint64_t
+     * because it can exceed 2^32 Hz, the limit of a 32-bit `unsigned long`.
+     */
+    static uint64_t cycles_per_second() {
+      static uint64_t cyclesPerSecond = calibrate();
+      return cyclesPerSecond;
+    }
+
+    /**
+     * Measure the rate of the time stamp counter, which takes 10
+     * milliseconds. The result is saved by the first call to
+     * cycles_per_second().
+     */
+    static uint64_t calibrate() {
+      struct timespec start;
+      struct timespec end;
+      struct timespec pause = {0, 10000000};
+
+      clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+      uint64_t startCycles = __builtin_ia32_rdtsc();
+      nanosleep(&pause, nullptr);
+      clock_gettime(CLOCK_MONOTONIC_RAW, &end);
+      uint64_t endCycles = __builtin_ia32_rdtsc();
+
+      uint64_t nanos = (uint64_t) (end.tv_sec - start.tv_sec) * 1000000000
+          + end.tv_nsec - start.tv_nsec;
+      return (endCycles - startCycles) * 1000000000 / nanos;
+    }
+};
+
+#endif
+
+#if ACE_ROUTINE_ESP_CYCLE_CLOCK
+
+/**
+ * A ClockInterface whose cycles() are the CPU cycle counter of the ESP8266 or
+ * ESP32, counted at the CPU frequency, which is read at run time since it can
+ * be changed by the program. The counter wraps around after 16 to 53
+ * seconds, depending on the frequency.
+ */
+class EspCycleClockInterface : public ClockInterface {
+  public:
+    /** Get the CPU cycle counter. */
+    static unsigned long cycles() { return ESP.getCycleCount(); }
+
+    /** Return the current CPU frequency. */
+    static unsigned long cycles_per_second() {
+      return (unsigned long) ESP.getCpuFreqMHz() * 1000000UL;
+    }
+};
+
+#endif
+
+/**
+ * The ClockInterface with the best cycles() on this platform, for the T_CLOCK
+ * parameter of Coroutine_Delay_32bit_Profiler_Impl. For example:
+ *
+ * @code
+ * using ProfiledCoroutine = CoroutineTemplate<
+ *     Coroutine_Delay_32bit_Profiler_Impl<NamedCoroutine, CycleClockInterface>>;
+ * @endcode
+ */
+#if ACE_ROUTINE_TSC_CLOCK
+using CycleClockInterface = TscClockInterface;
+#elif ACE_ROUTINE_MONOTONIC_RAW_CLOCK
+using CycleClockInterface = MonotonicRawClockInterface;
+#elif ACE_ROUTINE_ESP_CYCLE_CLOCK
+using CycleClockInterface = EspCycleClockInterface;
+#else
+using CycleClockInterface = ClockInterface;
+#endif
+
+}
+
+#endif
@@ -0,0 +1,162 @@
+/*
+MIT License
+
+Copyright (c) 2021 Brian T. Park
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ACE_ROUTINE_EVENT_H
+#define ACE_ROUTINE_EVENT_H
+
+#include <stdint.h>
+#include "Coroutine.h"
+#include "CoroutineQueue.h"
+
+/**
+ * Yield until the event is notified using notify() or notifyAll(), then
+ * execution continues. With the queued CoroutineScheduler, the coroutine is
+ * removed from the ready list while it waits, so it costs nothing per
+ * scheduler pass. With the polling CoroutineScheduler, it is equivalent to
+ * COROUTINE_YIELD().
+ *
+ * A notification is not remembered if nobody is waiting. The coroutine may
+ * also wake up without a notification (always in the polling mode, or after
+ * suspend() and resume()), so it should check its condition again in a loop:
+ *
+ * @code
+ *    while (!condition) COROUTINE_AWAIT_EVENT(event);
+ * @endcode
+ */
+#define COROUTINE_AWAIT_EVENT(event) \
+    do { \
+      this->profileExit(); \
+      this->setDelayZero(); \
+      this->setWaiting(); \
+      (event).wait(this); \
+      do { \
+        COROUTINE_YIELD_INTERNAL(); \
+      } while (!(event).isNotified(this)); \
+      this->setRunning(); \
+      this->profileEnterZero(); \
+    } while (false)
+
+namespace ace_routine {
+
+/**
+ * An event which coroutines can wait for using COROUTINE_AWAIT_EVENT(), and
+ * which is signaled by notify() or notifyAll(). It is the equivalent of a
+ * condition variable for coroutines.
+ *
+ * If the T_COROUTINE type includes the Coroutine_Queue_Impl layer, then the
+ * waiting coroutines are moved out of the ready list of the CoroutineScheduler
+ * into a wait list owned by the event, and notify() moves them back.
+ * Otherwise, the waiting coroutines are still polled on every pass, and the
+ * event is an empty object.
+ *
+ * @tparam T_COROUTINE the Coroutine type of the waiting coroutines
+ * @tparam T_QUEUED selects the implementation, do not set it explicitly
+ */
+template <typename T_COROUTINE, bool T_QUEUED = T_COROUTINE::kHasQueue>
+class EventTemplate;
+
+/**
+ * The polling implementation of EventTemplate. The polling CoroutineScheduler
+ * runs every coroutine on every pass anyway, so the event keeps no state:
+ * COROUTINE_AWAIT_EVENT() yields once, and the caller re-checks its condition.
+ * This also makes it work with any Coroutine type.
+ */
+template <typename T_COROUTINE>
+class EventTemplate<T_COROUTINE, false> {
+  public:
+    /** Constructor. */
+    EventTemplate() {}
+
+    /** Nothing to do, the waiters are polled. */
+    void notify() {}
+
+    /** Nothing to do, the waiters are polled. */
+    void notifyAll() {}
+
+    /** Used by COROUTINE_AWAIT_EVENT(). Not for direct use. */
+    template <typename T>
+    void wait(T* /*coroutine*/) {}
+
+    /** Used by COROUTINE_AWAIT_EVENT(). Not for direct use. */
+    template <typename T>
+    bool isNotified(T* /*coroutine*/) { return true; }
+
+  private:
+    // Disable copy-constructor and assignment operator
+    EventTemplate(const EventTemplate&) = delete;
+    EventTemplate& operator=(const EventTemplate&) = delete;
+};
+
+/**
+ * The queued implementation of EventTemplate. The waiting coroutines are kept
+ * in a FIFO wait list, using the same intrusive links as the RunQueues, so
+ * notify() is O(1) and the waiters are never visited by the scheduler.
+ */
+template <typename T_COROUTINE>
+class EventTemplate<T_COROUTINE, true> {
+  public:
+    /** Constructor. */
+    EventTemplate() {}
+
+    /** Move the oldest waiting coroutine, if any, into its ready list. */
+    void notify() {
+      RunQueues<T_COROUTINE>::getInstance()->wakeFront(&mWaiters);
+    }
+
+    /** Move all the waiting coroutines into their ready lists. */
+    void notifyAll() {
+      RunQueues<T_COROUTINE>* queues = RunQueues<T_COROUTINE>::getInstance();
+      while (queues->wakeFront(&mWaiters)) {}
+    }
+
+    /** Return the number of coroutines waiting for a notification. */
+    uint16_t getNumWaiters() const { return mWaiters.getSize(); }
+
+    /** Used by COROUTINE_AWAIT_EVENT(). Not for direct use. */
+    void wait(T_COROUTINE* coroutine) {
+      RunQueues<T_COROUTINE>::getInstance()->wait(coroutine, &mWaiters);
+    }
+
+    /**
+     * Used by COROUTINE_AWAIT_EVENT(). Return true if the coroutine has been
+     * removed from the wait list. Not for direct use.
+     */
+    bool isNotified(T_COROUTINE* coroutine) {
+      return coroutine->getQueueId() != CoroutineQueueNode::kQueueWaiting;
+    }
+
+  private:
+    // Disable copy-constructor and assignment operator
+    EventTemplate(const EventTemplate&) = delete;
+    EventTemplate& operator=(const EventTemplate&) = delete;
+
+    CoroutineList mWaiters;
+};
+
+/** An EventTemplate for the default Coroutine type. */
+using Event = EventTemplate<Coroutine>;
+
+}
+
+#endif
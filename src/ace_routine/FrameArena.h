@@ -0,0 +1,156 @@
+/*
+MIT License
+
+Copyright (c) 2021 Brian T. Park
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ACE_ROUTINE_FRAME_ARENA_H
+#define ACE_ROUTINE_FRAME_ARENA_H
+
+#include <stddef.h> // size_t, max_align_t
+#include <stdint.h>
+
+namespace ace_routine {
+
+/**
+ * A fixed-capacity allocator of the memory blocks which hold the frames of the
+ * NativeCoroutineTemplate, or the states declared by COROUTINE_STATE() with
+ * the Coroutine_StateArena_Impl layer. The memory is divided into blocks of
+ * the same size, which are handed out from a free list, so allocation and
+ * deallocation are O(1) and never touch the global heap. A frame larger than
+ * a block, or a request when all blocks are in use, fails and is counted by
+ * getNumFailures().
+ *
+ * This class holds the bookkeeping, and the FrameArenaTemplate provides the
+ * storage.
+ */
+class FrameArena {
+  public:
+    /**
+     * Bytes reserved in front of each frame to remember its arena, so that
+     * the frame can be released without knowing where it came from.
+     */
+    static const size_t kHeaderSize = alignof(max_align_t);
+
+    /**
+     * Allocate a frame of 'size' bytes. Return nullptr if the frame does not
+     * fit into a block, or if all blocks are in use.
+     */
+    void* allocateFrame(size_t size) {
+      if (size > mMaxFrameSize) mMaxFrameSize = size;
+      if (size + kHeaderSize > mBlockSize) {
+        mNumFailures++;
+        return nullptr;
+      }
+
+      uint8_t* block;
+      if (mFreeList != nullptr) {
+        block = mFreeList;
+        mFreeList = *reinterpret_cast<uint8_t**>(block);
+      } else if (mNumUnused > 0) {
+        block = mBuffer + (size_t) (mNumBlocks - mNumUnused) * mBlockSize;
+        mNumUnused--;
+      } else {
+        mNumFailures++;
+        return nullptr;
+      }
+
+      mNumFree--;
+      *reinterpret_cast<FrameArena**>(block) = this;
+      return block + kHeaderSize;
+    }
+
+    /** Return a frame allocated by allocateFrame() to its arena. */
+    static void deallocateFrame(void* frame) {
+      uint8_t* block = static_cast<uint8_t*>(frame) - kHeaderSize;
+      FrameArena* arena = *reinterpret_cast<FrameArena**>(block);
+      *reinterpret_cast<uint8_t**>(block) = arena->mFreeList;
+      arena->mFreeList = block;
+      arena->mNumFree++;
+    }
+
+    /** Size of a block, including the header. */
+    size_t getBlockSize() const { return mBlockSize; }
+
+    /** Number of blocks which are not in use. */
+    uint16_t getNumFree() const { return mNumFree; }
+
+    /** Number of failed allocations since the start. */
+    uint16_t getNumFailures() const { return mNumFailures; }
+
+    /** Largest frame requested since the start, excluding the header. */
+    size_t getMaxFrameSize() const { return mMaxFrameSize; }
+
+  protected:
+    FrameArena(uint8_t* buffer, size_t blockSize, uint16_t numBlocks) :
+        mBuffer(buffer),
+        mBlockSize(blockSize),
+        mNumBlocks(numBlocks),
+        mNumUnused(numBlocks),
+        mNumFree(numBlocks) {}
+
+  private:
+    // Disable copy-constructor and assignment operator
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    /** The storage, provided by the subclass. */
+    uint8_t* const mBuffer;
+
+    /** Released blocks, linked through their first word. */
+    uint8_t* mFreeList = nullptr;
+
+    const size_t mBlockSize;
+    const uint16_t mNumBlocks;
+
+    /** Blocks at the end of the buffer which were never handed out. */
+    uint16_t mNumUnused;
+
+    uint16_t mNumFree;
+    uint16_t mNumFailures = 0;
+    size_t mMaxFrameSize = 0;
+};
+
+/**
+ * A FrameArena with the storage for T_NUM_BLOCKS frames of up to
+ * T_FRAME_SIZE bytes each. The frame size of a native coroutine depends on
+ * the compiler and on its local variables, so it is best found by trial, using
+ * getMaxFrameSize() and getNumFailures().
+ *
+ * @tparam T_FRAME_SIZE the largest frame, excluding the header
+ * @tparam T_NUM_BLOCKS the maximum number of frames alive at the same time
+ */
+template <size_t T_FRAME_SIZE, uint16_t T_NUM_BLOCKS>
+class FrameArenaTemplate : public FrameArena {
+  public:
+    static const size_t kBlockSize =
+        (T_FRAME_SIZE + kHeaderSize + alignof(max_align_t) - 1)
+        / alignof(max_align_t) * alignof(max_align_t);
+
+    FrameArenaTemplate() : FrameArena(mStorage, kBlockSize, T_NUM_BLOCKS) {}
+
+  private:
+    alignas(max_align_t) uint8_t mStorage[kBlockSize * T_NUM_BLOCKS];
+};
+
+}
+
+#endif
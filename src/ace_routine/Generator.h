@@ -0,0 +1,157 @@
+/*
+MIT License
+
+Copyright (c) 2021 Brian T. Park
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ACE_ROUTINE_GENERATOR_H
+#define ACE_ROUTINE_GENERATOR_H
+
+#include <stdint.h>
+#include "Coroutine.h"
+
+/**
+ * Hand 'value' to the caller of Generator::next(), and suspend the generator
+ * until the next call. Can be used only in the runCoroutine() of a Generator.
+ */
+#define COROUTINE_YIELD_VALUE(value) \
+    do { \
+      *this->mOut = (value); \
+      COROUTINE_YIELD_INTERNAL(); \
+    } while (false)
+
+namespace ace_routine {
+
+/**
+ * A coroutine which produces a sequence of values on demand. Its body is the
+ * runCoroutine() method, written with COROUTINE_BEGIN() or COROUTINE_LOOP(),
+ * which returns each value using COROUTINE_YIELD_VALUE(), and may end with
+ * COROUTINE_END():
+ *
+ * @code
+ * class Counter : public Generator<uint32_t> {
+ *   public:
+ *     int runCoroutine() override {
+ *       COROUTINE_BEGIN();
+ *       for (mI = 0; mI < 10; mI++) {
+ *         COROUTINE_YIELD_VALUE(mI);
+ *       }
+ *       COROUTINE_END();
+ *     }
+ *
+ *   private:
+ *     uint32_t mI;
+ * };
+ * @endcode
+ *
+ * The consumer pulls the values using next(), which resumes the body directly
+ * until its next COROUTINE_YIELD_VALUE(). Unlike a Channel, there is no
+ * handshake, and the generator is not in the list of the CoroutineScheduler,
+ * so the value is produced and consumed within the same call:
+ *
+ * @code
+ * uint32_t value;
+ * while (counter.next(value)) {
+ *   ...
+ * }
+ * @endcode
+ *
+ * The body cannot use the other COROUTINE_*() macros which yield, since the
+ * generator is not scheduled. A generator can pull the values of another
+ * generator, to build a lazy pipeline.
+ *
+ * @tparam T_VALUE type of the values
+ */
+template <typename T_VALUE>
+class Generator {
+  public:
+    /** The body of the generator, see above. */
+    virtual int runCoroutine() = 0;
+
+    /**
+     * Resume the generator until its next value, which is written into
+     * 'value'. Return false, leaving 'value' unchanged, if the generator has
+     * ended.
+     */
+    bool next(T_VALUE& value) {
+      if (mDone) return false;
+      mOut = &value;
+      runCoroutine();
+      return ! mDone;
+    }
+
+    /** The generator has reached COROUTINE_END(). */
+    bool isDone() const { return mDone; }
+
+    /** Restart the generator from the beginning of its body. */
+    void reset() {
+      mDone = false;
+    #if ACE_ROUTINE_RESUME_INDEX
+      mResume = 0;
+    #else
+      mJumpPoint = nullptr;
+    #endif
+    }
+
+  protected:
+    /** Constructor. */
+    Generator() {}
+
+    /** Destructor. Non-virtual, see CoroutineTemplate. */
+    ~Generator() = default;
+
+  #if ACE_ROUTINE_RESUME_INDEX
+    /** Used by the COROUTINE_*() macros. */
+    void setResume(uint8_t index) { mResume = index; }
+
+    /** Used by the COROUTINE_*() macros. */
+    uint8_t getResume() const { return mResume; }
+  #else
+    /** Used by the COROUTINE_*() macros. */
+    void setJump(void* jumpPoint) { mJumpPoint = jumpPoint; }
+
+    /** Used by the COROUTINE_*() macros. */
+    void* getJump() const { return mJumpPoint; }
+  #endif
+
+    /** Used by COROUTINE_END(). */
+    void setEnding() { mDone = true; }
+
+    /** Where COROUTINE_YIELD_VALUE() writes, set by next(). */
+    T_VALUE* mOut = nullptr;
+
+  private:
+    // Disable copy-constructor and assignment operator
+    Generator(const Generator&) = delete;
+    Generator& operator=(const Generator&) = delete;
+
+  #if ACE_ROUTINE_RESUME_INDEX
+    uint8_t mResume = 0;
+  #else
+    void* mJumpPoint = nullptr;
+  #endif
+
+    bool mDone = false;
+};
+
+}
+
+#endif
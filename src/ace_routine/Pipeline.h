@@ -0,0 +1,428 @@
+/*
+MIT License
+
+Copyright (c) 2021 Brian T. Park
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ACE_ROUTINE_PIPELINE_H
+#define ACE_ROUTINE_PIPELINE_H
+
+#include <stdint.h>
+#include "Coroutine.h"
+#include "Channel.h"
+#include "Generator.h"
+
+/**
+ * Create a PipelineTemplate named 'name' of the default Coroutine type, which
+ * runs the pipe given by the remaining arguments. For example:
+ *
+ * @code
+ * PIPELINE(doubler,
+ *     pipe::from(source)
+ *     | pipe::map([](int x) { return 2 * x; })
+ *     | pipe::sink([](int x) { SERIAL_PORT_MONITOR.println(x); }));
+ * @endcode
+ *
+ * The pipe is stored in a variable named `name_pipe`, and the coroutine keeps
+ * a reference to it. Both are defined at the point of use, usually at file
+ * scope.
+ */
+#define PIPELINE(name, ...) \
+    auto name##_pipe = __VA_ARGS__; \
+    ace_routine::PipelineTemplate<ace_routine::Coroutine, \
+        decltype(name##_pipe)> name(name##_pipe)
+
+namespace ace_routine {
+
+/**
+ * The stages of a PipelineTemplate. A pipe is a chain of stages, built from
+ * left to right with `operator|`:
+ *
+ * @code
+ * pipe::from(generator) | pipe::map(f) | pipe::filter(p) | pipe::batch<4>()
+ *     | pipe::sink(g)
+ * @endcode
+ *
+ * Each stage contains the stage on its left by value, and has the same
+ * interface:
+ *
+ *  * `value_type`, the type of its values,
+ *  * `bool next(value_type& value)`, which pulls the next value through the
+ *    stages on its left, and returns false if there is none at this time,
+ *  * `bool isDone() const`, which is true if there will never be one,
+ *  * `getEvent()`, which returns the event notified when next() may succeed
+ *    after it has failed. Only a ChannelSource has a real one, so that a
+ *    PipelineTemplate blocked on a Channel waits for it instead of polling.
+ *    The stages forward the event of their source, and the other sources
+ *    have none, so the pipeline polls them (see channelEvent()).
+ *
+ * None of these is virtual, so the synchronous stages between a source and a
+ * sink are fused by the compiler into the runCoroutine() of one coroutine,
+ * with no copy of the values into a Channel in between. The functions are
+ * stored by value. A lambda is inlined more reliably than a function pointer.
+ *
+ * A stage which must yield or delay is written as a normal Coroutine instead,
+ * connected to the pipes on either side by a Channel, using pipe::from() and
+ * pipe::to().
+ */
+namespace pipe {
+
+/** Used to name the type of an expression, never defined. */
+template <typename T> T&& declareValue();
+
+/** A source which pulls the values of a Generator. */
+template <typename T>
+class GeneratorSource {
+  public:
+    typedef T value_type;
+
+    explicit GeneratorSource(Generator<T>& generator) :
+        mGenerator(generator) {}
+
+    bool next(T& value) { return mGenerator.next(value); }
+
+    bool isDone() const { return mGenerator.isDone(); }
+
+  private:
+    Generator<T>& mGenerator;
+};
+
+/**
+ * A source which reads the values of a Channel, written by another coroutine
+ * using COROUTINE_CHANNEL_WRITE(). It never ends.
+ */
+template <typename T, typename T_COROUTINE>
+class ChannelSource {
+  public:
+    typedef T value_type;
+
+    explicit ChannelSource(Channel<T, T_COROUTINE>& channel) :
+        mChannel(channel) {}
+
+    bool next(T& value) { return mChannel.read(value); }
+
+    bool isDone() const { return false; }
+
+    EventTemplate<T_COROUTINE>& getEvent() { return mChannel.getEvent(); }
+
+  private:
+    Channel<T, T_COROUTINE>& mChannel;
+};
+
+/** Applies a function to each value. */
+template <typename T_SOURCE, typename T_FUNCTION>
+class MapStage {
+  public:
+    typedef decltype(declareValue<T_FUNCTION&>()(
+        declareValue<typename T_SOURCE::value_type&>())) value_type;
+
+    MapStage(const T_SOURCE& source, const T_FUNCTION& function) :
+        mSource(source), mFunction(function) {}
+
+    bool next(value_type& value) {
+      typename T_SOURCE::value_type input;
+      if (! mSource.next(input)) return false;
+      value = mFunction(input);
+      return true;
+    }
+
+    bool isDone() const { return mSource.isDone(); }
+
+    auto getEvent() -> decltype(channelEvent(declareValue<T_SOURCE&>(), 0)) {
+      return channelEvent(mSource, 0);
+    }
+
+  private:
+    T_SOURCE mSource;
+    T_FUNCTION mFunction;
+};
+
+/**
+ * Passes the values for which a predicate is true. It pulls as many values as
+ * needed from its source within a single next().
+ */
+template <typename T_SOURCE, typename T_PREDICATE>
+class FilterStage {
+  public:
+    typedef typename T_SOURCE::value_type value_type;
+
+    FilterStage(const T_SOURCE& source, const T_PREDICATE& predicate) :
+        mSource(source), mPredicate(predicate) {}
+
+    bool next(value_type& value) {
+      while (mSource.next(value)) {
+        if (mPredicate(value)) return true;
+      }
+      return false;
+    }
+
+    bool isDone() const { return mSource.isDone(); }
+
+    auto getEvent() -> decltype(channelEvent(declareValue<T_SOURCE&>(), 0)) {
+      return channelEvent(mSource, 0);
+    }
+
+  private:
+    T_SOURCE mSource;
+    T_PREDICATE mPredicate;
+};
+
+/** The value of a BatchStage: up to N values of type T. */
+template <typename T, uint8_t N>
+struct Batch {
+  T items[N];
+  uint8_t size;
+};
+
+/**
+ * Groups the values by N. The values are collected across calls to next(),
+ * so a source which has no value at this time does not lose them. When the
+ * source ends, the last batch may have fewer than N values.
+ */
+template <typename T_SOURCE, uint8_t N>
+class BatchStage {
+  public:
+    typedef Batch<typename T_SOURCE::value_type, N> value_type;
+
+    explicit BatchStage(const T_SOURCE& source) : mSource(source) {
+      mBatch.size = 0;
+    }
+
+    bool next(value_type& value) {
+      while (mBatch.size < N) {
+        if (! mSource.next(mBatch.items[mBatch.size])) {
+          if (mBatch.size == 0 || ! mSource.isDone()) return false;
+          break;
+        }
+        mBatch.size++;
+      }
+      value = mBatch;
+      mBatch.size = 0;
+      return true;
+    }
+
+    bool isDone() const { return mBatch.size == 0 && mSource.isDone(); }
+
+    auto getEvent() -> decltype(channelEvent(declareValue<T_SOURCE&>(), 0)) {
+      return channelEvent(mSource, 0);
+    }
+
+  private:
+    T_SOURCE mSource;
+    value_type mBatch;
+};
+
+/** A sink which calls a function with each value. */
+template <typename T_FUNCTION>
+class FunctionSink {
+  public:
+    explicit FunctionSink(const T_FUNCTION& function) : mFunction(function) {}
+
+    template <typename T>
+    bool put(const T& value) {
+      mFunction(value);
+      return true;
+    }
+
+  private:
+    T_FUNCTION mFunction;
+};
+
+/**
+ * A sink which writes each value to a Channel, read by another coroutine
+ * using COROUTINE_CHANNEL_READ(). put() returns false until the reader has
+ * taken the value.
+ */
+template <typename T, typename T_COROUTINE>
+class ChannelSink {
+  public:
+    explicit ChannelSink(Channel<T, T_COROUTINE>& channel) :
+        mChannel(channel) {}
+
+    bool put(const T& value) { return mChannel.write(value); }
+
+    /** Return the event notified when put() may succeed after it failed. */
+    EventTemplate<T_COROUTINE>& getEvent() { return mChannel.getEvent(); }
+
+  private:
+    Channel<T, T_COROUTINE>& mChannel;
+};
+
+/** A complete pipe: the chain of stages, and its sink. */
+template <typename T_CHAIN, typename T_SINK>
+class Pipe {
+  public:
+    typedef typename T_CHAIN::value_type value_type;
+
+    Pipe(const T_CHAIN& chain, const T_SINK& sink) :
+        mChain(chain), mSink(sink) {}
+
+    bool next(value_type& value) { return mChain.next(value); }
+
+    bool isDone() const { return mChain.isDone(); }
+
+    bool put(const value_type& value) { return mSink.put(value); }
+
+    auto getEvent() -> decltype(channelEvent(declareValue<T_CHAIN&>(), 0)) {
+      return channelEvent(mChain, 0);
+    }
+
+    /** Return the event notified when put() may succeed after it failed. */
+    auto getSinkEvent()
+        -> decltype(channelEvent(declareValue<T_SINK&>(), 0)) {
+      return channelEvent(mSink, 0);
+    }
+
+  private:
+    T_CHAIN mChain;
+    T_SINK mSink;
+};
+
+/** The right operand of `operator|` which creates a MapStage. */
+template <typename T_FUNCTION>
+struct MapOp { T_FUNCTION function; };
+
+/** The right operand of `operator|` which creates a FilterStage. */
+template <typename T_PREDICATE>
+struct FilterOp { T_PREDICATE predicate; };
+
+/** The right operand of `operator|` which creates a BatchStage. */
+template <uint8_t N>
+struct BatchOp {};
+
+/** Start a pipe with the values of a Generator. */
+template <typename T>
+GeneratorSource<T> from(Generator<T>& generator) {
+  return GeneratorSource<T>(generator);
+}
+
+/** Start a pipe with the values read from a Channel. */
+template <typename T, typename T_COROUTINE>
+ChannelSource<T, T_COROUTINE> from(Channel<T, T_COROUTINE>& channel) {
+  return ChannelSource<T, T_COROUTINE>(channel);
+}
+
+/** Apply 'function' to each value. */
+template <typename T_FUNCTION>
+MapOp<T_FUNCTION> map(T_FUNCTION function) {
+  return MapOp<T_FUNCTION>{function};
+}
+
+/** Keep the values for which 'predicate' returns true. */
+template <typename T_PREDICATE>
+FilterOp<T_PREDICATE> filter(T_PREDICATE predicate) {
+  return FilterOp<T_PREDICATE>{predicate};
+}
+
+/** Group the values by N, into a Batch. */
+template <uint8_t N>
+BatchOp<N> batch() {
+  return BatchOp<N>();
+}
+
+/** End a pipe by calling 'function' with each value. */
+template <typename T_FUNCTION>
+FunctionSink<T_FUNCTION> sink(T_FUNCTION function) {
+  return FunctionSink<T_FUNCTION>(function);
+}
+
+/** End a pipe by writing each value to a Channel. */
+template <typename T, typename T_COROUTINE>
+ChannelSink<T, T_COROUTINE> to(Channel<T, T_COROUTINE>& channel) {
+  return ChannelSink<T, T_COROUTINE>(channel);
+}
+
+template <typename T_SOURCE, typename T_FUNCTION>
+MapStage<T_SOURCE, T_FUNCTION> operator|(
+    const T_SOURCE& source, const MapOp<T_FUNCTION>& op) {
+  return MapStage<T_SOURCE, T_FUNCTION>(source, op.function);
+}
+
+template <typename T_SOURCE, typename T_PREDICATE>
+FilterStage<T_SOURCE, T_PREDICATE> operator|(
+    const T_SOURCE& source, const FilterOp<T_PREDICATE>& op) {
+  return FilterStage<T_SOURCE, T_PREDICATE>(source, op.predicate);
+}
+
+template <typename T_SOURCE, uint8_t N>
+BatchStage<T_SOURCE, N> operator|(
+    const T_SOURCE& source, const BatchOp<N>& /*op*/) {
+  return BatchStage<T_SOURCE, N>(source);
+}
+
+template <typename T_CHAIN, typename T_FUNCTION>
+Pipe<T_CHAIN, FunctionSink<T_FUNCTION>> operator|(
+    const T_CHAIN& chain, const FunctionSink<T_FUNCTION>& sink) {
+  return Pipe<T_CHAIN, FunctionSink<T_FUNCTION>>(chain, sink);
+}
+
+template <typename T_CHAIN, typename T, typename T_COROUTINE>
+Pipe<T_CHAIN, ChannelSink<T, T_COROUTINE>> operator|(
+    const T_CHAIN& chain, const ChannelSink<T, T_COROUTINE>& sink) {
+  return Pipe<T_CHAIN, ChannelSink<T, T_COROUTINE>>(chain, sink);
+}
+
+}
+
+/**
+ * A coroutine which runs a pipe::Pipe. On each run, it pulls one value
+ * through the fused stages of the pipe and hands it to the sink, then yields.
+ * If the source has no value at this time, it waits on the event of the
+ * source without calling the sink. If the sink cannot take the value yet
+ * (i.e. the reader of its Channel is not ready), it keeps the value and waits
+ * on the event of the sink until the sink takes it. A Channel at either end
+ * notifies its event, so if T_COROUTINE includes the Coroutine_Queue_Impl
+ * layer, a blocked pipeline is not run until the other side acts. Otherwise
+ * the wait is a single yield, and the pipeline polls. It ends when the source
+ * ends.
+ *
+ * @tparam T_COROUTINE the Coroutine type
+ * @tparam T_PIPE the type of the pipe, usually deduced by PIPELINE()
+ */
+template <typename T_COROUTINE, typename T_PIPE>
+class PipelineTemplate : public T_COROUTINE {
+  public:
+    /** Constructor. The pipe must outlive the coroutine. */
+    explicit PipelineTemplate(T_PIPE& pipe) : mPipe(pipe) {}
+
+    int runCoroutine() override {
+      COROUTINE_BEGIN();
+      while (! mPipe.isDone()) {
+        if (mPipe.next(mValue)) {
+          while (! mPipe.put(mValue)) {
+            COROUTINE_AWAIT_EVENT(mPipe.getSinkEvent());
+          }
+          COROUTINE_YIELD();
+        } else if (! mPipe.isDone()) {
+          COROUTINE_AWAIT_EVENT(mPipe.getEvent());
+        }
+      }
+      COROUTINE_END();
+    }
+
+  private:
+    T_PIPE& mPipe;
+    typename T_PIPE::value_type mValue;
+};
+
+}
+
+#endif
@@ -14,7 +14,7 @@ class Profiler {
     static Profiler *root;
     const char *name = nullptr;	// name of coroutine, if associated with one
     const char *type = nullptr;	// "run" or "wait"
-    unsigned cycles_per_second = 1000000;
+    uint64_t cycles_per_second = 1000000; // above 2^32 with TscClockInterface
 
   public:
     Profiler() {
@@ -27,7 +27,9 @@ class Profiler {
 
     const char *getName() const { return name; }
     const char *getType() const { return type; }
-    void begin( const char *_name, const char *_type, unsigned _cycles_per_second ) { 
+    uint64_t getCyclesPerSecond() const { return cycles_per_second; }
+    void begin( const char *_name, const char *_type,
+        uint64_t _cycles_per_second ) {
     	name = _name; 
     	type = _type; 
     	cycles_per_second = _cycles_per_second;
@@ -82,7 +84,8 @@ class Profiler {
   	}        
 
     /**
-     * Prints  for this profiler.
+     * Prints the name, type and statistics of this profiler, as a JSON
+     * object. Always returns true.
      */
     bool printProfilingStats( Print& printer, bool reset ) { 
   		if( name )
@@ -97,6 +100,7 @@ class Profiler {
   			clear();
 
   		printer.print( "}");
+  		return true;
   	}
 };
 
@@ -104,27 +108,60 @@ class Profiler {
  * 	This Profiler class makes a histogram of measured intervals.
  * 
  * 	It is a virtual base class that will be derived into Log and Linear histograms.
- * 
+ * 	The bins are not allocated on the heap: each derived class holds them in
+ * 	a member array, whose size is a template parameter, so that a profiled
+ * 	build does not need malloc() and free().
+ *
+ * @tparam T_COUNT the unsigned type of the counter of each bin. A uint16_t
+ * 	or uint8_t halves or quarters the RAM of the bins, for short measurements.
+ * 	A full bin stays at its maximum instead of wrapping around to 0.
  */
+template <typename T_COUNT>
 class HistogramCoroutineProfiler : public ace_routine::Profiler {
+  public:
+  	/** Largest count of a bin. */
+  	static const T_COUNT kMaxCount = (T_COUNT) ~(T_COUNT) 0;
+
+  	/** Number of bins. */
+  	unsigned getNumBins() const { return nbins; }
+
+  	/** Number of values counted in bin i. */
+  	T_COUNT getBinCount( unsigned i ) const { return histo[i]; }
+
+  	/**
+  	 * Reset histogram.
+  	 */
+  	void clear( ) {
+  		for( unsigned i=0; i<nbins; i++ )
+  			histo[i] = 0;
+  		clear_time = millis();
+  	}
+
   protected:
   	unsigned nbins;		// number of bins in histogram
-  	uint32_t *histo;	// number of times an interval was measured in bin histo[n]
+  	T_COUNT *histo;		// number of times an interval was measured in bin histo[n]
   	uint32_t clear_time;
 
+  	/**
+  	 * Uses the nbins counters at histo, which are owned by the derived
+  	 * class.
+  	 */
+  	HistogramCoroutineProfiler( T_COUNT *_histo, unsigned _nbins ) {
+  		nbins = _nbins;
+  		histo = _histo;
+  		clear();
+  	}
+
   	/**
   	 * Add one interval of length t.
   	 * This class doesn't know anything about the units of this number.
   	 */
   	virtual void add( uint32_t t ) =0;
 
-  	/**
-  	 * Reset histogram.
-  	 */
-  	void clear( ) {
-  		for( unsigned i=0; i<nbins; i++ )
-  			histo[i] = 0;
-  		clear_time = millis();
+  	/** Increment bin i, unless it is full. */
+  	void increment( unsigned i ) {
+  		if( histo[i] < kMaxCount )
+  			histo[i]++;
   	}
 
   	/**
@@ -134,25 +171,12 @@ class HistogramCoroutineProfiler : public ace_routine::Profiler {
   		printer.print( "[");
   		for( unsigned i=0; i<nbins; i++ ) {
   			if( i ) printer.print( ", ");
-  			printer.print( histo[i] );
+  			printer.print( (unsigned long) histo[i] );
   		}
   		printer.print( "]");
   	}
 
   public:
-  	/**
-  	 * Allocates memory for nbins.
-  	 */
-  	HistogramCoroutineProfiler( unsigned _nbins ) {
-  		nbins = _nbins;
-  		histo = new uint32_t[nbins];
-  		clear();
-  	}
-
-  	~HistogramCoroutineProfiler() { 
-  		delete[] histo;
-  	}
-
   	/**
   	 * Called by the coroutine itself after it has finished waiting, to report:
   	 * 	wait_micros: how long it waited
@@ -184,31 +208,33 @@ class HistogramCoroutineProfiler : public ace_routine::Profiler {
  * setDivider sets the bin size, so for example if it is 1000, then the first
  * bin in histo[0] covers all time intervals between 0µs and 999 µs included, 
  * then... etc.
+ *
+ * @tparam N_BINS number of bins, the last one counts all the longer intervals
+ * @tparam T_COUNT type of the counter of each bin
  */
-class LinearHistogramCoroutineProfiler : public HistogramCoroutineProfiler {
+template <unsigned N_BINS, typename T_COUNT = uint32_t>
+class LinearHistogramCoroutineProfiler : public HistogramCoroutineProfiler<T_COUNT> {
 public:
 	// sets bin size
 	void setDivider( unsigned div ) { 
 		divider = div;
-		clear(); 
+		this->clear(); 
 	}
 
-	LinearHistogramCoroutineProfiler( unsigned _nbins, unsigned _divider=1 ) 
-		: HistogramCoroutineProfiler( _nbins ) {
+	LinearHistogramCoroutineProfiler( unsigned _divider=1 ) 
+		: HistogramCoroutineProfiler<T_COUNT>( bins, N_BINS ) {
 			setDivider( _divider );
 	}
 
 protected:
 
 	unsigned divider = 1;
+	T_COUNT bins[N_BINS];
 
 	// increment a bin
 	virtual void add( uint32_t t ) {
 		t = t / divider;
-		if( t < nbins )
-			histo[t] ++;
-		else
-			histo[nbins-1] ++;
+		this->increment( t < N_BINS ? t : N_BINS-1 );
 	}
 
 	/**
@@ -229,8 +255,8 @@ protected:
 	 *  etc
 	 */
 	virtual void print( Print& printer ) {
-		printer.printf("\"hist\":\"lin\", \"div\":%d, \"hz\": %d, \"runtime_ms\": %d, \"data\":", divider, cycles_per_second, millis()-clear_time );
-		print_hist( printer );
+		printer.printf("\"hist\":\"lin\", \"div\":%d, \"hz\": %llu, \"runtime_ms\": %d, \"data\":", divider, (unsigned long long) this->cycles_per_second, millis()-this->clear_time );
+		this->print_hist( printer );
 	}
 };
 
@@ -238,23 +264,27 @@ protected:
  * This is a log2 histogram.
  * Each bin represents twice the number of microseconds as the previous one.
  * This allows a wide dynamic range without using too many bins.
+ *
+ * @tparam N_BINS number of bins, the last one counts all the longer intervals
+ * @tparam T_COUNT type of the counter of each bin
  */
-class Log2HistogramCoroutineProfiler : public HistogramCoroutineProfiler {
+template <unsigned N_BINS, typename T_COUNT = uint32_t>
+class Log2HistogramCoroutineProfiler : public HistogramCoroutineProfiler<T_COUNT> {
 public:
-	Log2HistogramCoroutineProfiler( unsigned _nbins ) : HistogramCoroutineProfiler( _nbins ) {}
+	Log2HistogramCoroutineProfiler() : HistogramCoroutineProfiler<T_COUNT>( bins, N_BINS ) {}
 protected:
+	T_COUNT bins[N_BINS];
 
 	// increment bin
 	virtual void add( uint32_t t ) {
-		for( unsigned i=0; i<nbins; i++ ) {		// compute log2
+		for( unsigned i=0; i<N_BINS; i++ ) {		// compute log2
 			t >>= 1;
 			if( !t ) {
-				if( histo[i] < UINT32_MAX ) 
-					histo[i]++;
+				this->increment( i );
 				return;
 			} 
 		}
-		histo[nbins-1]++;
+		this->increment( N_BINS-1 );
 	}
 
 	/**
@@ -275,30 +305,33 @@ protected:
 	 * 	histo[3] = 8-16 cycles
 	 */
 	virtual void print( Print& printer ) {
-		printer.printf("\"hist\":\"log\", \"exp\":2, \"hz\": %d, \"runtime_ms\": %d, \"data\":", cycles_per_second, millis()-clear_time );
-		print_hist( printer );
+		printer.printf("\"hist\":\"log\", \"exp\":2, \"hz\": %llu, \"runtime_ms\": %d, \"data\":", (unsigned long long) this->cycles_per_second, millis()-this->clear_time );
+		this->print_hist( printer );
 	}
 };
 
 
 #include <cmath>
 /**
- * This is a log2 histogram.
- * Each bin represents twice the number of microseconds as the previous one.
+ * This is a log histogram of any base.
+ * Each bin represents `exponent` times the number of microseconds as the previous one.
  * This allows a wide dynamic range without using too many bins.
+ *
+ * @tparam N_BINS number of bins, the last one counts all the longer intervals
+ * @tparam T_COUNT type of the counter of each bin
  */
-class LogHistogramCoroutineProfiler : public HistogramCoroutineProfiler {
+template <unsigned N_BINS, typename T_COUNT = uint32_t>
+class LogHistogramCoroutineProfiler : public HistogramCoroutineProfiler<T_COUNT> {
 public:
-  LogHistogramCoroutineProfiler( unsigned _nbins, float _exponent ) : HistogramCoroutineProfiler( _nbins ) { logexponent = 1.0/log( _exponent ); }
+  LogHistogramCoroutineProfiler( float _exponent ) : HistogramCoroutineProfiler<T_COUNT>( bins, N_BINS ) { logexponent = 1.0/log( _exponent ); }
 protected:
   float logexponent;
+  T_COUNT bins[N_BINS];
+
   // increment bin
   virtual void add( uint32_t t ) {
-    int index = logexponent * log( 1+t );
-    if( index < nbins )
-      histo[index]++;
-    else
-      histo[nbins-1]++;
+    unsigned index = logexponent * log( 1+t );
+    this->increment( index < N_BINS ? index : N_BINS-1 );
   }
 
   /**
@@ -319,10 +352,150 @@ protected:
    *  histo[3] = 8-16 cycles
    */
   virtual void print( Print& printer ) {
-    printer.printf("\"hist\":\"log\", \"exp\":%f, \"hz\": %d, \"runtime_ms\": %d, \"data\":", exp(1.0/logexponent), cycles_per_second, millis()-clear_time );
-    print_hist( printer );
+    printer.printf("\"hist\":\"log\", \"exp\":%f, \"hz\": %llu, \"runtime_ms\": %d, \"data\":", exp(1.0/logexponent), (unsigned long long) this->cycles_per_second, millis()-this->clear_time );
+    this->print_hist( printer );
   }
 };
 
+/**
+ * This is an HDR (high dynamic range) histogram, like the Log2 histogram, but
+ * each power of 2 is split into 2^SUB_BITS linear sub-buckets, so that the
+ * relative error of a bin is at most 1/2^SUB_BITS over the whole range of
+ * uint32_t. Values below 2^SUB_BITS get one bin each.
+ *
+ * The bin is computed in constant time from the count of leading zeros, with
+ * no loop and no floating point, so add() is cheap enough for the hot path
+ * of profileRun() and profileWait(), even on 8-bit processors. The total
+ * count and the exact maximum are also recorded, so that the percentiles can
+ * be queried on the device with getPercentile().
+ *
+ * Covering the whole range takes (33 - SUB_BITS) * 2^SUB_BITS bins (240 for
+ * SUB_BITS=3), which is the default N_BINS. With a smaller N_BINS, larger
+ * values are counted in the last bin.
+ *
+ * @tparam SUB_BITS log2 of the number of sub-buckets per power of 2
+ * @tparam N_BINS number of bins
+ * @tparam T_COUNT type of the counter of each bin
+ */
+template <uint8_t SUB_BITS = 3,
+    unsigned N_BINS = ((33 - SUB_BITS) << SUB_BITS),
+    typename T_COUNT = uint32_t>
+class HdrHistogramCoroutineProfiler : public HistogramCoroutineProfiler<T_COUNT> {
+public:
+	/** Number of sub-buckets per power of 2. */
+	static const uint32_t kSubBuckets = (uint32_t) 1 << SUB_BITS;
+
+	/** Number of bins which cover all values of uint32_t. */
+	static const unsigned kMaxBins = (33 - SUB_BITS) << SUB_BITS;
+
+	static_assert(N_BINS <= kMaxBins, "N_BINS larger than the range of uint32_t");
+
+	HdrHistogramCoroutineProfiler()
+		: HistogramCoroutineProfiler<T_COUNT>( bins, N_BINS ) {}
+
+	/**
+	 * Return the index of the bin of value t, ignoring N_BINS. With
+	 * shift = max(log2(t), SUB_BITS) - SUB_BITS, the upper SUB_BITS+1 bits of
+	 * t are (t >> shift), and the bin is (shift * 2^SUB_BITS) + (t >> shift).
+	 */
+	static unsigned getBinIndex( uint32_t t ) {
+		uint8_t shift = log2Floor( t | kSubBuckets ) - SUB_BITS;
+		return ((unsigned) shift << SUB_BITS) + (unsigned) (t >> shift);
+	}
+
+	/** Return the lowest value counted in bin i. */
+	static uint32_t getBinLowest( unsigned i ) {
+		unsigned bucket = i >> SUB_BITS;
+		if( bucket == 0 )
+			return i;
+		return (uint32_t) (i - ((bucket - 1) << SUB_BITS)) << (bucket - 1);
+	}
+
+	/** Number of values added since the last clear(). */
+	uint32_t getCount() const { return count; }
+
+	/** Largest value added since the last clear(). */
+	uint32_t getMax() const { return maximum; }
+
+	/**
+	 * Return the value below which `percent` percent of the values fall,
+	 * rounded up to the highest value of its bin, but never more than
+	 * getMax(). Returns 0 if the histogram is empty. The rank is taken from
+	 * the sum of the bins rather than getCount(), so that it is still reached
+	 * once a narrow T_COUNT bin saturates; the result is then approximate.
+	 */
+	uint32_t getPercentile( uint8_t percent ) const {
+		uint32_t total = 0;
+		for( unsigned i=0; i<N_BINS; i++ )
+			total += bins[i];
+		if( total == 0 )
+			return 0;
+		uint32_t rank = (uint32_t) (((uint64_t) total * percent + 99) / 100);
+		if( rank == 0 )
+			rank = 1;
+		uint32_t sum = 0;
+		for( unsigned i=0; i<N_BINS-1; i++ ) {
+			sum += bins[i];
+			if( sum >= rank ) {
+				uint32_t highest = getBinLowest( i+1 ) - 1;
+				return highest < maximum ? highest : maximum;
+			}
+		}
+		return maximum;
+	}
+
+	void clear( ) {
+		HistogramCoroutineProfiler<T_COUNT>::clear();
+		count = 0;
+		maximum = 0;
+	}
+
+protected:
+	uint32_t count = 0;
+	uint32_t maximum = 0;
+	T_COUNT bins[N_BINS];
+
+	/** Position of the highest bit set in t, which must not be 0. */
+	static uint8_t log2Floor( uint32_t t ) {
+		return (sizeof(unsigned long) * 8 - 1) - __builtin_clzl( t );
+	}
+
+	// increment bin
+	virtual void add( uint32_t t ) {
+		unsigned i = getBinIndex( t );
+		this->increment( i < N_BINS ? i : N_BINS-1 );
+		count++;
+		if( t > maximum )
+			maximum = t;
+	}
+
+	/**
+	 * Output JSON
+	 * {
+	 * 	type: 	"hdr",	for HDR histogram
+	 * 	sub_bits:	int,	log2 of the number of sub-buckets per power of 2
+	 * 	hz:		int,
+	 * 	runtime_ms:		long since it was last cleared
+	 * 	count, max, p50, p90, p99:	int, in cycles
+	 * 	data: [...]		array of ints for histogram bins.
+	 *
+	 * 	Bin edges are, for sub_bits=2:
+	 * 	histo[0..3] = 0, 1, 2, 3 cycles
+	 * 	histo[4..7] = 4, 5, 6, 7 cycles
+	 * 	histo[8..11] = 8-9, 10-11, 12-13, 14-15 cycles
+	 * 	histo[12..15] = 16-19, 20-23, 24-27, 28-31 cycles
+	 */
+	virtual void print( Print& printer ) {
+		printer.printf("\"hist\":\"hdr\", \"sub_bits\":%d, \"hz\": %llu, \"runtime_ms\": %lu, "
+			"\"count\": %lu, \"max\": %lu, \"p50\": %lu, \"p90\": %lu, \"p99\": %lu, \"data\":",
+			SUB_BITS, (unsigned long long) this->cycles_per_second,
+			(unsigned long) (millis()-this->clear_time),
+			(unsigned long) count, (unsigned long) maximum,
+			(unsigned long) getPercentile( 50 ), (unsigned long) getPercentile( 90 ),
+			(unsigned long) getPercentile( 99 ) );
+		this->print_hist( printer );
+	}
+};
+
 
 }
\ No newline at end of file
@@ -0,0 +1,202 @@
+/*
+MIT License
+
+Copyright (c) 2021 Brian T. Park
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ACE_ROUTINE_STATIC_SCHEDULER_H
+#define ACE_ROUTINE_STATIC_SCHEDULER_H
+
+#include <stdint.h>
+#include "Coroutine.h"
+
+namespace ace_routine {
+
+template <uint8_t I, typename T_SCHEDULER> struct StaticSchedulerElement;
+
+/**
+ * A scheduler over a set of coroutines which is fixed at compile time. The
+ * scheduler owns one instance of each coroutine class in T_COROUTINES, stored
+ * as a compile-time tuple, and its loop() runs each of them once, in order.
+ *
+ * The CoroutineScheduler follows the `mNext` pointer from one coroutine to the
+ * next, and calls runCoroutine() through the vtable. Here, the pass is
+ * unrolled by the compiler into a sequence of direct, inlinable calls to
+ * `T::runCoroutine()` on objects at fixed addresses, so there is neither a
+ * linked list traversal nor a virtual dispatch. The coroutines follow the same
+ * state machine as with the polling CoroutineScheduler, so suspend(), resume()
+ * and reset() work as usual.
+ *
+ * For example:
+ *
+ * @code
+ * class Blink : public Coroutine { ... };
+ * class Monitor : public Coroutine { ... };
+ *
+ * StaticScheduler<Blink, Monitor> scheduler;
+ *
+ * void loop() {
+ *   scheduler.loop();
+ * }
+ * @endcode
+ *
+ * The coroutines are also inserted into the linked list of their Coroutine
+ * type by their constructor, like all coroutines, so they must not be run by
+ * the CoroutineScheduler at the same time.
+ *
+ * @tparam T_COROUTINES the classes of the coroutines, each one a subclass of a
+ *    CoroutineTemplate, and default constructible
+ */
+template <typename... T_COROUTINES>
+class StaticScheduler;
+
+/** The empty StaticScheduler, which terminates the recursion. */
+template <>
+class StaticScheduler<> {
+  public:
+    /** Number of coroutines. */
+    static const uint8_t kNumCoroutines = 0;
+
+    /** Nothing to run. */
+    void loop() {}
+
+    /** Nothing to set up. */
+    void setupCoroutines() {}
+
+  private:
+    template <typename... T> friend class StaticScheduler;
+
+    void refreshClocks() {}
+    void runEach() {}
+};
+
+/**
+ * A StaticScheduler with at least one coroutine. The first coroutine is held
+ * directly, the others by the StaticScheduler of the remaining types.
+ */
+template <typename T_FIRST, typename... T_REST>
+class StaticScheduler<T_FIRST, T_REST...> {
+  template <uint8_t I, typename T_SCHEDULER>
+  friend struct StaticSchedulerElement;
+  template <typename... T> friend class StaticScheduler;
+
+  public:
+    /** Number of coroutines. */
+    static const uint8_t kNumCoroutines = 1 + sizeof...(T_REST);
+
+    /** Constructor. */
+    StaticScheduler() = default;
+
+    /**
+     * Run each coroutine once, in the order of T_COROUTINES. A
+     * SnapshotClockInterface is refreshed once at the start of the pass.
+     */
+    void loop() {
+      refreshClocks();
+      runEach();
+    }
+
+    /** Call setupCoroutine() on each coroutine. */
+    void setupCoroutines() {
+      mFirst.T_FIRST::setupCoroutine();
+      mRest.setupCoroutines();
+    }
+
+    /**
+     * Return the coroutine at index I, whose type is the I-th type of
+     * T_COROUTINES.
+     */
+    template <uint8_t I>
+    typename StaticSchedulerElement<I, StaticScheduler>::Type& get() {
+      return StaticSchedulerElement<I, StaticScheduler>::get(*this);
+    }
+
+  private:
+    // Disable copy-constructor and assignment operator
+    StaticScheduler(const StaticScheduler&) = delete;
+    StaticScheduler& operator=(const StaticScheduler&) = delete;
+
+    /** Refresh the clock of each Coroutine type. */
+    void refreshClocks() {
+      T_FIRST::coroutineSnapshotPass();
+      mRest.refreshClocks();
+    }
+
+    /** Run each coroutine once. */
+    void runEach() {
+      dispatch(mFirst);
+      mRest.runEach();
+    }
+
+    /**
+     * Run the coroutine according to its status, like
+     * CoroutineSchedulerTemplate::dispatchPolled(), but using a qualified
+     * call to bypass the vtable.
+     */
+    template <typename T>
+    static void dispatch(T& coroutine) {
+      switch (coroutine.getStatus()) {
+        case T::kStatusYielding:
+        case T::kStatusDelaying:
+        case T::kStatusWaiting:
+          T::coroutineSnapshotDispatch();
+          coroutine.T::runCoroutine();
+          break;
+
+        case T::kStatusEnding:
+          coroutine.setTerminated();
+          break;
+
+        default:
+          break;
+      }
+    }
+
+    T_FIRST mFirst;
+    StaticScheduler<T_REST...> mRest;
+};
+
+/**
+ * Type and accessor of the coroutine at index I of a StaticScheduler. Used by
+ * StaticScheduler::get().
+ */
+template <typename T_FIRST, typename... T_REST>
+struct StaticSchedulerElement<0, StaticScheduler<T_FIRST, T_REST...>> {
+  typedef T_FIRST Type;
+
+  static Type& get(StaticScheduler<T_FIRST, T_REST...>& scheduler) {
+    return scheduler.mFirst;
+  }
+};
+
+template <uint8_t I, typename T_FIRST, typename... T_REST>
+struct StaticSchedulerElement<I, StaticScheduler<T_FIRST, T_REST...>> {
+  typedef StaticSchedulerElement<I - 1, StaticScheduler<T_REST...>> Next;
+  typedef typename Next::Type Type;
+
+  static Type& get(StaticScheduler<T_FIRST, T_REST...>& scheduler) {
+    return Next::get(scheduler.mRest);
+  }
+};
+
+}
+
+#endif
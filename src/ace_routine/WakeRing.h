@@ -0,0 +1,166 @@
+/*
+MIT License
+
+Copyright (c) 2021 Brian T. Park
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef ACE_ROUTINE_WAKE_RING_H
+#define ACE_ROUTINE_WAKE_RING_H
+
+#include <stdint.h>
+
+namespace ace_routine {
+
+template <typename T_COROUTINE> class CoroutineSchedulerTemplate;
+
+/**
+ * A lock-free single-producer, single-consumer ring of coroutines to wake up,
+ * which can be written from an interrupt service routine (or, on Linux, from a
+ * signal handler or another thread). The producer calls post(), and the
+ * CoroutineScheduler, which is the consumer, drains the ring at the start of
+ * each loop() and runAll(), and moves the posted coroutines to the front of
+ * their ready list (see CoroutineSchedulerTemplate::addWakeRing()).
+ *
+ * The indexes are free-running 8-bit counters, accessed with the GCC
+ * `__atomic` builtins. A single byte is read and written atomically by all
+ * the supported processors, so no interrupts are disabled on either side.
+ * Only one producer may post into a given ring. Use one ring per interrupt
+ * source if there are several, and add each of them to the scheduler.
+ *
+ * This class holds the logic without the storage, so that the scheduler does
+ * not depend on the size of the ring. Create a WakeRing instead.
+ */
+template <typename T_COROUTINE>
+class WakeRingBase {
+  public:
+    /**
+     * Post the coroutine to be woken up. Safe to call from an ISR. Return
+     * false, and count an overflow, if the ring is full.
+     */
+    bool post(T_COROUTINE* coroutine) {
+      uint8_t tail = __atomic_load_n(&mTail, __ATOMIC_RELAXED);
+      uint8_t head = __atomic_load_n(&mHead, __ATOMIC_ACQUIRE);
+      if ((uint8_t) (tail - head) > mMask) {
+        uint8_t overflows = __atomic_load_n(&mOverflows, __ATOMIC_RELAXED);
+        if (overflows < UINT8_MAX) {
+          __atomic_store_n(&mOverflows, overflows + 1, __ATOMIC_RELAXED);
+        }
+        return false;
+      }
+      mSlots[tail & mMask] = coroutine;
+      __atomic_store_n(&mTail, (uint8_t) (tail + 1), __ATOMIC_RELEASE);
+      return true;
+    }
+
+    /** Remove and return the oldest posted coroutine, or nullptr. */
+    T_COROUTINE* pop() {
+      uint8_t head = __atomic_load_n(&mHead, __ATOMIC_RELAXED);
+      uint8_t tail = __atomic_load_n(&mTail, __ATOMIC_ACQUIRE);
+      if (head == tail) return nullptr;
+      T_COROUTINE* coroutine = mSlots[head & mMask];
+      __atomic_store_n(&mHead, (uint8_t) (head + 1), __ATOMIC_RELEASE);
+      return coroutine;
+    }
+
+    /** Return true if nothing has been posted since the last pop(). */
+    bool isEmpty() const {
+      return __atomic_load_n(&mHead, __ATOMIC_RELAXED)
+          == __atomic_load_n(&mTail, __ATOMIC_ACQUIRE);
+    }
+
+    /** Return the number of failed post() calls, saturated at 255. */
+    uint8_t getOverflows() const {
+      return __atomic_load_n(&mOverflows, __ATOMIC_RELAXED);
+    }
+
+    /**
+     * Clear the overflow count. Must not race with post(), e.g. call it with
+     * the interrupt disabled.
+     */
+    void clearOverflows() {
+      __atomic_store_n(&mOverflows, 0, __ATOMIC_RELAXED);
+    }
+
+  protected:
+    /** Constructor, with the storage of size (mask + 1) of the subclass. */
+    WakeRingBase(T_COROUTINE** slots, uint8_t mask) :
+        mSlots(slots),
+        mMask(mask)
+    {}
+
+  private:
+    friend class CoroutineSchedulerTemplate<T_COROUTINE>;
+
+    // Disable copy-constructor and assignment operator
+    WakeRingBase(const WakeRingBase&) = delete;
+    WakeRingBase& operator=(const WakeRingBase&) = delete;
+
+    T_COROUTINE** const mSlots;
+    const uint8_t mMask;
+
+    /** Next ring drained by the scheduler, written only by the consumer. */
+    WakeRingBase* mNextRing = nullptr;
+
+    /** Index of the next slot to pop, written only by the consumer. */
+    uint8_t mHead = 0;
+
+    /** Index of the next slot to post, written only by the producer. */
+    uint8_t mTail = 0;
+
+    /** Number of failed post() calls, written only by the producer. */
+    uint8_t mOverflows = 0;
+};
+
+/**
+ * A WakeRingBase with storage for T_SIZE coroutines. For example:
+ *
+ * @code
+ * WakeRing<Coroutine, 8> wakeRing;
+ *
+ * ISR(INT0_vect) {
+ *   wakeRing.post(&buttonHandler);
+ * }
+ *
+ * void setup() {
+ *   CoroutineScheduler::addWakeRing(&wakeRing);
+ *   CoroutineScheduler::setup();
+ * }
+ * @endcode
+ *
+ * @tparam T_COROUTINE the Coroutine type of the scheduler
+ * @tparam T_SIZE number of slots, a power of 2 between 1 and 128
+ */
+template <typename T_COROUTINE, uint8_t T_SIZE>
+class WakeRing : public WakeRingBase<T_COROUTINE> {
+  static_assert(T_SIZE > 0 && T_SIZE <= 128 && (T_SIZE & (T_SIZE - 1)) == 0,
+      "T_SIZE must be a power of 2 between 1 and 128");
+
+  public:
+    /** Constructor. */
+    WakeRing() : WakeRingBase<T_COROUTINE>(mStorage, T_SIZE - 1) {}
+
+  private:
+    T_COROUTINE* mStorage[T_SIZE];
+};
+
+}
+
+#endif
@@ -33,6 +33,8 @@ class TestableClockInterface {
     static unsigned long millis() { return sMillis; }
     static unsigned long micros() { return sMicros; }
     static unsigned long seconds() { return sSeconds; }
+    static unsigned long cycles() { return sMicros; }
+    static unsigned long cycles_per_second() { return 1000000; }
 
     static void setMillis(unsigned long millis) { sMillis = millis; }
     static void setMicros(unsigned long micros) { sMicros = micros; }
@@ -35,7 +35,8 @@ namespace testing {
  * A version of Coroutine that uses the TestableClockInterface to provide the
  * clock can for unit testing purposes.
  */
-using TestableCoroutine = CoroutineTemplate<TestableClockInterface>;
+using TestableCoroutine = CoroutineTemplate<
+    Coroutine_Delay_16bit_Impl<UnnamedCoroutine, TestableClockInterface>>;
 
 }
 }
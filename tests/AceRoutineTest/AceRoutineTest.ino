@@ -18,6 +18,7 @@ test(AceRoutineTest, statusStrings) {
   assertEqual(sStatusStrings[Coroutine::kStatusRunning], "Running");
   assertEqual(sStatusStrings[Coroutine::kStatusEnding], "Ending");
   assertEqual(sStatusStrings[Coroutine::kStatusTerminated], "Terminated");
+  assertEqual(sStatusStrings[Coroutine::kStatusWaiting], "Waiting");
 }
 
 // ---------------------------------------------------------------------------
@@ -41,6 +41,59 @@ test(ChannelTest, channelWriteMacro) {
   assertEqual(readValue, writeValue);
 }
 
+// A channel of size 1 without an event, which the macros poll.
+class PolledChannel {
+  public:
+    void setValue(int value) { mValueToWrite = value; }
+
+    bool write() {
+      if (mFull) return false;
+      mValue = mValueToWrite;
+      mFull = true;
+      return true;
+    }
+
+    bool read(int& value) {
+      if (! mFull) return false;
+      value = mValue;
+      mFull = false;
+      return true;
+    }
+
+  private:
+    int mValue = 0;
+    int mValueToWrite = 0;
+    bool mFull = false;
+};
+
+PolledChannel polledChannel;
+
+COROUTINE(polledWriter) {
+  COROUTINE_BEGIN();
+  COROUTINE_CHANNEL_WRITE(polledChannel, 1);
+  COROUTINE_CHANNEL_WRITE(polledChannel, 2);
+  COROUTINE_END();
+}
+
+int polledSum = 0;
+
+COROUTINE(polledReader) {
+  static int value;
+  COROUTINE_LOOP() {
+    COROUTINE_CHANNEL_READ(polledChannel, value);
+    polledSum += value;
+  }
+}
+
+test(ChannelTest, channelWithoutEvent) {
+  for (int i = 0; i < 5; i++) {
+    polledReader.runCoroutine();
+    polledWriter.runCoroutine();
+  }
+  assertTrue(polledWriter.isDone());
+  assertEqual(3, polledSum);
+}
+
 // ---------------------------------------------------------------------------
 
 void setup() {
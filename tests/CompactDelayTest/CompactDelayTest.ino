@@ -0,0 +1,137 @@
+#line 2 "CompactDelayTest.ino"
+
+#include <AceRoutine.h>
+#include <AUnitVerbose.h>
+#include "ace_routine/testing/TestableClockInterface.h"
+
+using namespace aunit;
+using namespace ace_routine;
+using ace_routine::testing::TestableClockInterface;
+
+template <typename T_WORD>
+using CompactCoroutine = CoroutineTemplate<Coroutine_Delay_Compact_Impl<
+    UnnamedCoroutine, TestableClockInterface, T_WORD>>;
+
+// Delays for 10 millis, 20 micros, then 2 seconds, forever.
+template <typename T_WORD>
+class Delayer : public CompactCoroutine<T_WORD> {
+  public:
+    int runCoroutine() override {
+      COROUTINE_LOOP() {
+        COROUTINE_DELAY(10);
+        COROUTINE_DELAY_MICROS(20);
+        COROUTINE_DELAY_SECONDS(2);
+      }
+    }
+};
+
+Delayer<uint32_t> delayer;
+Delayer<uint16_t> delayer16;
+
+test(CompactDelayTest, size) {
+  // The delay state is a single word, so never larger than the 16-bit and
+  // 32-bit delay policies (the difference may be hidden by the padding).
+  assertLessOrEqual(sizeof(CompactCoroutine<uint16_t>),
+      sizeof(CompactCoroutine<uint32_t>));
+  assertLessOrEqual(sizeof(CompactCoroutine<uint32_t>),
+      sizeof(CoroutineTemplate<Coroutine_Delay_16bit_Impl<
+          UnnamedCoroutine, TestableClockInterface>>));
+  assertLessOrEqual(sizeof(CompactCoroutine<uint32_t>),
+      sizeof(CoroutineTemplate<Coroutine_Delay_32bit_Impl<
+          UnnamedCoroutine, TestableClockInterface>>));
+  assertEqual((uint32_t) 536870911,
+      (uint32_t) CompactCoroutine<uint32_t>::kMaxDelay);
+  assertEqual(8191, (int) CompactCoroutine<uint16_t>::kMaxDelay);
+}
+
+test(CompactDelayTest, millisWrapAround) {
+  // The wake time 4 is past the rollover of the 32-bit millis().
+  TestableClockInterface::setMillis(0xFFFFFFFA);
+  delayer.setDelayMillis(10);
+  assertEqual(CompactCoroutine<uint32_t>::kUnitMillis, delayer.getDelayUnit());
+  assertFalse(delayer.isDelayExpired());
+
+  TestableClockInterface::setMillis(0xFFFFFFFF);
+  assertFalse(delayer.isDelayExpired());
+  TestableClockInterface::setMillis(3);
+  assertFalse(delayer.isDelayExpired());
+  TestableClockInterface::setMillis(4);
+  assertTrue(delayer.isDelayExpired());
+  TestableClockInterface::setMillis(1000);
+  assertTrue(delayer.isDelayExpired());
+}
+
+test(CompactDelayTest, microsWrapAround) {
+  // Same, across the rollover of the 30-bit time field of the wake time.
+  TestableClockInterface::setMicros(0x3FFFFFFE);
+  delayer.setDelayMicros(5);
+  assertEqual(CompactCoroutine<uint32_t>::kUnitMicros, delayer.getDelayUnit());
+  assertFalse(delayer.isDelayExpired());
+  assertFalse(delayer.isDelayMicrosExpired());
+
+  TestableClockInterface::setMicros(0x40000002);
+  assertFalse(delayer.isDelayMicrosExpired());
+  TestableClockInterface::setMicros(0x40000003);
+  assertTrue(delayer.isDelayMicrosExpired());
+}
+
+test(CompactDelayTest, wordWrapAround) {
+  // The 16-bit word keeps a 14-bit time field.
+  TestableClockInterface::setSeconds(0x3FFE);
+  delayer16.setDelaySeconds(3);
+  assertFalse(delayer16.isDelaySecondsExpired());
+  TestableClockInterface::setSeconds(0x4000);
+  assertFalse(delayer16.isDelaySecondsExpired());
+  TestableClockInterface::setSeconds(0x4001);
+  assertTrue(delayer16.isDelaySecondsExpired());
+
+  // Longer delays are clamped to kMaxDelay.
+  TestableClockInterface::setMillis(0xFFFF0000);
+  delayer16.setDelayMillis(60000);
+  TestableClockInterface::setMillis(0xFFFF0000 + 8190);
+  assertFalse(delayer16.isDelayExpired());
+  TestableClockInterface::setMillis(0xFFFF0000 + 8191);
+  assertTrue(delayer16.isDelayExpired());
+}
+
+test(CompactDelayTest, macros) {
+  TestableClockInterface::setMillis(0xFFFFFFFC);
+  TestableClockInterface::setMicros(0);
+  TestableClockInterface::setSeconds(0);
+  delayer.reset();
+
+  delayer.runCoroutine();
+  assertTrue(delayer.isDelaying());
+  TestableClockInterface::setMillis(5);
+  delayer.runCoroutine();
+  assertTrue(delayer.isDelaying());
+  TestableClockInterface::setMillis(6);
+  delayer.runCoroutine();
+  assertEqual(CompactCoroutine<uint32_t>::kUnitMicros, delayer.getDelayUnit());
+
+  TestableClockInterface::setMicros(20);
+  delayer.runCoroutine();
+  assertEqual(CompactCoroutine<uint32_t>::kUnitSeconds, delayer.getDelayUnit());
+
+  TestableClockInterface::setSeconds(1);
+  delayer.runCoroutine();
+  assertEqual(CompactCoroutine<uint32_t>::kUnitSeconds, delayer.getDelayUnit());
+  TestableClockInterface::setSeconds(2);
+  delayer.runCoroutine();
+  assertEqual(CompactCoroutine<uint32_t>::kUnitMillis, delayer.getDelayUnit());
+}
+
+// ---------------------------------------------------------------------------
+
+void setup() {
+#if defined(ARDUINO)
+  delay(1000); // some boards reboot twice
+#endif
+
+  Serial.begin(115200);
+  while (!Serial); // Leonardo/Micro
+}
+
+void loop() {
+  TestRunner::run();
+}
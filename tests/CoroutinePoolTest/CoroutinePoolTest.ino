@@ -0,0 +1,164 @@
+#line 2 "CoroutinePoolTest.ino"
+
+#include <AceRoutine.h>
+#include <AUnitVerbose.h>
+#include "ace_routine/testing/TestableClockInterface.h"
+
+using namespace aunit;
+using namespace ace_routine;
+using ace_routine::testing::TestableClockInterface;
+
+// Polling mode.
+using PolledCoroutine = CoroutineTemplate<Coroutine_Delay_16bit_Impl<
+    Coroutine_Pool_Impl<UnnamedCoroutine>, TestableClockInterface>>;
+using PolledScheduler = CoroutineSchedulerTemplate<PolledCoroutine>;
+
+// Queued mode.
+using QueuedCoroutine = CoroutineTemplate<Coroutine_Delay_32bit_Impl<
+    Coroutine_Pool_Impl<Coroutine_Queue_Impl<UnnamedCoroutine>>,
+    TestableClockInterface>>;
+using QueuedScheduler = CoroutineSchedulerTemplate<QueuedCoroutine>;
+
+uint16_t numFinished = 0;
+uint16_t numDestroyed = 0;
+
+// A job which yields 'mSteps' times, then ends.
+template <typename T_COROUTINE>
+class Job : public T_COROUTINE {
+  public:
+    Job(uint8_t steps) : mSteps(steps) {}
+
+    ~Job() { numDestroyed++; }
+
+    int runCoroutine() override {
+      COROUTINE_BEGIN();
+      for (mCount = 0; mCount < mSteps; mCount++) {
+        COROUTINE_YIELD();
+      }
+      numFinished++;
+      COROUTINE_END();
+    }
+
+    uint8_t mSteps;
+    uint8_t mCount;
+};
+
+// A static coroutine, which is never reclaimed.
+class Forever : public PolledCoroutine {
+  public:
+    int runCoroutine() override {
+      COROUTINE_BEGIN();
+      COROUTINE_END();
+    }
+};
+
+Forever forever;
+
+CoroutinePool<Job<PolledCoroutine>, 3> polledPool;
+CoroutinePool<Job<QueuedCoroutine>, 3> queuedPool;
+
+uint8_t countPolled() {
+  uint8_t count = 0;
+  for (PolledCoroutine** p = PolledCoroutine::getRoot(); *p != nullptr;
+      p = (*p)->getNext()) {
+    count++;
+  }
+  return count;
+}
+
+test(CoroutinePoolTest, spawnUntilFull) {
+  numFinished = 0;
+  numDestroyed = 0;
+  PolledScheduler::setup();
+
+  auto* a = polledPool.spawn(1);
+  auto* b = polledPool.spawn(2);
+  auto* c = polledPool.spawn(3);
+  assertTrue(a != nullptr);
+  assertTrue(b != nullptr);
+  assertTrue(c != nullptr);
+  assertTrue(polledPool.spawn(1) == nullptr);
+  assertEqual(0, (int) polledPool.getNumFree());
+  assertEqual(4, (int) countPolled());
+
+  // Each pass over 'c', 'b', 'a', 'forever' advances each job by one step.
+  // Ending jobs are terminated then reclaimed on the following pass.
+  for (int i = 0; i < 40; i++) PolledScheduler::loop();
+  assertEqual(3, (int) numFinished);
+  assertEqual(3, (int) numDestroyed);
+  assertEqual(3, (int) polledPool.getNumFree());
+  assertEqual(1, (int) countPolled());
+  assertTrue(forever.isTerminated());
+
+  // The slots are reused.
+  auto* d = polledPool.spawn(0);
+  assertTrue(d == c || d == b || d == a);
+  assertEqual(2, (int) countPolled());
+  for (int i = 0; i < 6; i++) PolledScheduler::loop();
+  assertEqual(4, (int) numFinished);
+  assertEqual(1, (int) countPolled());
+}
+
+test(CoroutinePoolTest, runAll) {
+  numFinished = 0;
+  numDestroyed = 0;
+  PolledScheduler::setup();
+
+  polledPool.spawn(0);
+  polledPool.spawn(1);
+  // Pass 1: the first job ends, the second yields.
+  // Pass 2: the first is terminated and reclaimed, the second ends.
+  // Pass 3: the second is terminated and reclaimed.
+  PolledScheduler::runAll();
+  PolledScheduler::runAll();
+  assertEqual(1, (int) numDestroyed);
+  PolledScheduler::runAll();
+  assertEqual(2, (int) numDestroyed);
+  assertEqual(3, (int) polledPool.getNumFree());
+  assertEqual(1, (int) countPolled());
+}
+
+test(CoroutinePoolTest, queued) {
+  numFinished = 0;
+  numDestroyed = 0;
+  QueuedScheduler::setup();
+
+  queuedPool.spawn(0);
+  queuedPool.spawn(2);
+  assertEqual(1, (int) queuedPool.getNumFree());
+
+  // The pooled coroutines are not in the singly-linked list.
+  assertTrue(*QueuedCoroutine::getRoot() == nullptr);
+
+  for (int i = 0; i < 10; i++) QueuedScheduler::loop();
+  assertEqual(2, (int) numFinished);
+  assertEqual(2, (int) numDestroyed);
+  assertEqual(3, (int) queuedPool.getNumFree());
+  assertTrue(RunQueues<QueuedCoroutine>::getInstance()->isReadyEmpty());
+
+  // Spawn many more jobs than slots.
+  uint16_t spawned = 0;
+  for (int i = 0; i < 1000 && spawned < 100; i++) {
+    if (queuedPool.spawn(1) != nullptr) spawned++;
+    QueuedScheduler::loop();
+  }
+  for (int i = 0; i < 20; i++) QueuedScheduler::loop();
+  assertEqual(100, (int) spawned);
+  assertEqual(102, (int) numDestroyed);
+  assertEqual(3, (int) queuedPool.getNumFree());
+}
+
+//----------------------------------------------------------------------------
+
+void setup() {
+#if ! defined(EPOXY_DUINO)
+  delay(1000); // wait to prevent garbage on SERIAL_PORT_MONITOR
+#endif
+
+  SERIAL_PORT_MONITOR.begin(115200);
+  while (!SERIAL_PORT_MONITOR); // Leonardo/Micro
+}
+
+void loop() {
+  TestRunner::run();
+}
@@ -0,0 +1,134 @@
+#line 2 "CoroutineStateTest.ino"
+
+#include <AceRoutine.h>
+#include <AUnitVerbose.h>
+#include "ace_routine/testing/TestableClockInterface.h"
+
+using namespace aunit;
+using namespace ace_routine;
+using ace_routine::testing::TestableClockInterface;
+
+// The state is stored inside each coroutine.
+using InlineCoroutine = CoroutineTemplate<Coroutine_Delay_16bit_Impl<
+    Coroutine_State_Impl<UnnamedCoroutine, 8>, TestableClockInterface>>;
+
+// The state is allocated from a shared arena.
+using ArenaCoroutine = CoroutineTemplate<Coroutine_Delay_16bit_Impl<
+    Coroutine_StateArena_Impl<UnnamedCoroutine>, TestableClockInterface>>;
+
+// Count from 'mStart' in steps of 1, yielding after each step, 3 times.
+template <typename T_COROUTINE>
+class Counter : public T_COROUTINE {
+  public:
+    explicit Counter(int start) : mStart(start) {}
+
+    int runCoroutine() override {
+      COROUTINE_STATE(struct { int count; uint8_t i; });
+      COROUTINE_BEGIN();
+      state.count = mStart;
+      for (state.i = 0; state.i < 3; state.i++) {
+        state.count++;
+        mCount = state.count;
+        COROUTINE_YIELD();
+      }
+      COROUTINE_END();
+    }
+
+    int mStart;
+    int mCount = 0;
+};
+
+Counter<InlineCoroutine> inline1(0);
+Counter<InlineCoroutine> inline2(100);
+
+FrameArenaTemplate<8, 1> arena;
+Counter<ArenaCoroutine> arena1(0);
+Counter<ArenaCoroutine> arena2(100);
+
+int initializedValue = 0;
+
+// Uses the default member initializer of its state.
+COROUTINE(InlineCoroutine, initialized) {
+  COROUTINE_STATE(struct { int value = 42; });
+  COROUTINE_BEGIN();
+  initializedValue = state.value;
+  COROUTINE_YIELD();
+  state.value++;
+  initializedValue = state.value;
+  COROUTINE_END();
+}
+
+test(CoroutineStateTest, perInstance) {
+  inline1.runCoroutine();
+  inline2.runCoroutine();
+  assertEqual(1, inline1.mCount);
+  assertEqual(101, inline2.mCount);
+
+  inline1.runCoroutine();
+  inline2.runCoroutine();
+  inline1.runCoroutine();
+  assertEqual(3, inline1.mCount);
+  assertEqual(102, inline2.mCount);
+
+  inline1.runCoroutine();
+  assertTrue(inline1.isEnding());
+
+  // The state is created again after a reset().
+  inline1.reset();
+  inline1.runCoroutine();
+  assertEqual(1, inline1.mCount);
+}
+
+test(CoroutineStateTest, initialized) {
+  initialized.runCoroutine();
+  assertEqual(42, initializedValue);
+  initialized.runCoroutine();
+  assertEqual(43, initializedValue);
+  assertTrue(initialized.isEnding());
+}
+
+test(CoroutineStateTest, arena) {
+  ArenaCoroutine::setStateArena(&arena);
+
+  // The arena has room for a single state.
+  arena1.runCoroutine();
+  arena2.runCoroutine();
+  assertEqual(1, arena1.mCount);
+  assertEqual(0, arena2.mCount);
+  assertTrue(arena2.isYielding());
+  assertEqual(0, (int) arena.getNumFree());
+
+  // The state of 'arena1' is released when it ends.
+  arena1.runCoroutine();
+  arena1.runCoroutine();
+  arena1.runCoroutine();
+  assertTrue(arena1.isEnding());
+  assertEqual(3, arena1.mCount);
+  assertEqual(1, (int) arena.getNumFree());
+  arena1.runCoroutine();
+  assertEqual(1, (int) arena.getNumFree());
+
+  // Then 'arena2' can start.
+  arena2.runCoroutine();
+  assertEqual(101, arena2.mCount);
+  assertEqual(0, (int) arena.getNumFree());
+
+  // A reset() releases the state.
+  arena2.reset();
+  assertEqual(1, (int) arena.getNumFree());
+}
+
+//----------------------------------------------------------------------------
+
+void setup() {
+#if ! defined(EPOXY_DUINO)
+  delay(1000); // wait to prevent garbage on SERIAL_PORT_MONITOR
+#endif
+
+  SERIAL_PORT_MONITOR.begin(115200);
+  while (!SERIAL_PORT_MONITOR); // Leonardo/Micro
+}
+
+void loop() {
+  TestRunner::run();
+}
@@ -0,0 +1,113 @@
+#line 2 "CycleClockTest.ino"
+
+#include <AceRoutine.h>
+#include <AUnitVerbose.h>
+
+using namespace aunit;
+using namespace ace_routine;
+
+Profiler* Profiler::root;
+
+// The profiled coroutines of the selectable clock.
+using CycleCoroutine = CoroutineTemplate<
+    Coroutine_Delay_32bit_Profiler_Impl<NamedCoroutine, CycleClockInterface>>;
+
+class Busy : public CycleCoroutine {
+  public:
+    int runCoroutine() override {
+      COROUTINE_LOOP() {
+        // Spin for 1 ms of micros(), whatever the cycle clock.
+        unsigned long start = micros();
+        while ((unsigned long) (micros() - start) < 1000) {}
+        COROUTINE_YIELD();
+      }
+    }
+};
+
+Busy busy;
+HdrHistogramCoroutineProfiler<3> runProfiler;
+
+// Return the cycles of T_CLOCK elapsed while micros() advances by
+// 'waitMicros'. The cycles are read first, so that the interval which they
+// measure contains the interval of micros().
+template <typename T_CLOCK>
+unsigned long measureCycles(unsigned long waitMicros) {
+  unsigned long startCycles = T_CLOCK::cycles();
+  unsigned long startMicros = micros();
+  while ((unsigned long) (micros() - startMicros) < waitMicros) {}
+  return T_CLOCK::cycles() - startCycles;
+}
+
+// ---------------------------------------------------------------------------
+
+test(CycleClockTest, clockInterface) {
+  // The portable clock counts micros.
+  assertEqual(1000000UL, ClockInterface::cycles_per_second());
+  unsigned long cycles = measureCycles<ClockInterface>(2000);
+  assertMoreOrEqual(cycles, 2000UL);
+}
+
+#if ACE_ROUTINE_MONOTONIC_RAW_CLOCK
+
+test(CycleClockTest, monotonicRaw) {
+  assertEqual(1000000000UL, MonotonicRawClockInterface::cycles_per_second());
+
+  // 2 ms of micros() are about 2,000,000 nanoseconds, allowing for a slow
+  // machine.
+  unsigned long cycles = measureCycles<MonotonicRawClockInterface>(2000);
+  assertMoreOrEqual(cycles, 1900000UL);
+  assertLess(cycles, 100000000UL);
+}
+
+#endif
+
+#if ACE_ROUTINE_TSC_CLOCK
+
+test(CycleClockTest, tsc) {
+  // Calibrated at run time, somewhere between 100 MHz and 4 GHz.
+  unsigned long hz = TscClockInterface::cycles_per_second();
+  assertMoreOrEqual(hz, 100000000UL);
+  assertLess(hz, 4000000000UL);
+
+  // Saved by the first call.
+  assertEqual(hz, TscClockInterface::cycles_per_second());
+
+  // 2 ms of micros() are about 2 ms of the counter.
+  unsigned long cycles = measureCycles<TscClockInterface>(2000);
+  unsigned long micros = (unsigned long) ((uint64_t) cycles * 1000000 / hz);
+  assertMoreOrEqual(micros, 1900UL);
+  assertLess(micros, 100000UL);
+}
+
+#endif
+
+test(CycleClockTest, profiler) {
+  // The run profiler is given the rate of the selected clock.
+  busy.setRunProfiler(&runProfiler);
+  assertEqual(CycleClockInterface::cycles_per_second(),
+      runProfiler.getCyclesPerSecond());
+
+  // The first run yields immediately, the second one spins for 1 ms.
+  busy.runCoroutine();
+  runProfiler.clear();
+  busy.runCoroutine();
+  assertEqual((uint32_t) 1, runProfiler.getCount());
+  unsigned long micros = (unsigned long) ((uint64_t) runProfiler.getMax()
+      * 1000000 / CycleClockInterface::cycles_per_second());
+  assertMoreOrEqual(micros, 900UL);
+}
+
+//----------------------------------------------------------------------------
+
+void setup() {
+#if ! defined(EPOXY_DUINO)
+  delay(1000); // wait to prevent garbage on SERIAL_PORT_MONITOR
+#endif
+
+  SERIAL_PORT_MONITOR.begin(115200);
+  while (!SERIAL_PORT_MONITOR); // Leonardo/Micro
+}
+
+void loop() {
+  TestRunner::run();
+}
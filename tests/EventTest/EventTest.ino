@@ -0,0 +1,190 @@
+#line 2 "EventTest.ino"
+
+#include <AceRoutine.h>
+#include <AUnitVerbose.h>
+#include "ace_routine/testing/TestableClockInterface.h"
+
+using namespace aunit;
+using namespace ace_routine;
+using ace_routine::testing::TestableClockInterface;
+
+// A queued Coroutine type, so that the waiting coroutines are moved out of the
+// ready list.
+using QueuedCoroutine = CoroutineTemplate<Coroutine_Delay_32bit_Impl<
+    Coroutine_Queue_Impl<UnnamedCoroutine>, TestableClockInterface>>;
+using QueuedScheduler = CoroutineSchedulerTemplate<QueuedCoroutine>;
+using QueuedEvent = EventTemplate<QueuedCoroutine>;
+
+// A separate queued Coroutine type for the Channel test, so that its
+// coroutines are not run by the QueuedScheduler.
+using ChannelCoroutine = CoroutineTemplate<Coroutine_Delay_32bit_Impl<
+    Coroutine_Queue_Impl<NamedCoroutine>, TestableClockInterface>>;
+using ChannelScheduler = CoroutineSchedulerTemplate<ChannelCoroutine>;
+
+// ---------------------------------------------------------------------------
+
+QueuedEvent event;
+
+// Count the number of times runCoroutine() is called, and the number of times
+// the event woke it up.
+class Waiter : public QueuedCoroutine {
+  public:
+    int runCoroutine() override {
+      mRuns++;
+      COROUTINE_LOOP() {
+        COROUTINE_AWAIT_EVENT(event);
+        mWakes++;
+      }
+    }
+
+    uint16_t mRuns = 0;
+    uint16_t mWakes = 0;
+};
+
+Waiter waiterA;
+Waiter waiterB;
+
+void runPasses(int n) {
+  for (int i = 0; i < n; i++) {
+    QueuedScheduler::loop();
+  }
+}
+
+test(EventTest, notifyAllWakesAll) {
+  runPasses(5);
+  assertEqual(2, event.getNumWaiters());
+  uint16_t wakesA = waiterA.mWakes;
+  uint16_t wakesB = waiterB.mWakes;
+
+  event.notifyAll();
+  assertEqual(0, event.getNumWaiters());
+  runPasses(5);
+  assertEqual(wakesA + 1, waiterA.mWakes);
+  assertEqual(wakesB + 1, waiterB.mWakes);
+  assertEqual(2, event.getNumWaiters());
+}
+
+test(EventTest, notifyWakesOldestFirst) {
+  runPasses(5);
+  uint16_t wakesA = waiterA.mWakes;
+  uint16_t wakesB = waiterB.mWakes;
+
+  // Each notify() wakes one waiter, which then waits again at the back of the
+  // wait list, so two notifications wake both waiters once.
+  event.notify();
+  assertEqual(1, event.getNumWaiters());
+  runPasses(5);
+  assertEqual(wakesA + wakesB + 1, waiterA.mWakes + waiterB.mWakes);
+
+  event.notify();
+  runPasses(5);
+  assertEqual(wakesA + 1, waiterA.mWakes);
+  assertEqual(wakesB + 1, waiterB.mWakes);
+}
+
+test(EventTest, suspendRemovesWaiter) {
+  runPasses(5);
+  uint16_t wakesA = waiterA.mWakes;
+  uint16_t wakesB = waiterB.mWakes;
+
+  waiterA.suspend();
+  assertEqual(1, event.getNumWaiters());
+  event.notifyAll();
+  runPasses(5);
+  assertEqual(wakesA, waiterA.mWakes);
+  assertEqual(wakesB + 1, waiterB.mWakes);
+
+  // After resume(), the coroutine wakes up without a notification, then waits
+  // again.
+  waiterA.resume();
+  runPasses(5);
+  assertEqual(wakesA + 1, waiterA.mWakes);
+  assertTrue(waiterA.isWaiting());
+  assertEqual(2, event.getNumWaiters());
+}
+
+test(EventTest, waitersAreNotPolled) {
+  runPasses(5);
+  assertTrue(waiterA.isWaiting());
+  assertTrue(waiterB.isWaiting());
+  uint16_t runsA = waiterA.mRuns;
+  uint16_t runsB = waiterB.mRuns;
+
+  runPasses(100);
+  assertEqual(runsA, waiterA.mRuns);
+  assertEqual(runsB, waiterB.mRuns);
+
+  event.notifyAll();
+  runPasses(100);
+  assertEqual(runsA + 1, waiterA.mRuns);
+  assertEqual(runsB + 1, waiterB.mRuns);
+}
+
+// ---------------------------------------------------------------------------
+
+Channel<int, ChannelCoroutine> channel;
+
+class Writer : public ChannelCoroutine {
+  public:
+    int runCoroutine() override {
+      COROUTINE_BEGIN();
+      for (mValue = 1; mValue <= 3; mValue++) {
+        COROUTINE_CHANNEL_WRITE(channel, mValue);
+      }
+      COROUTINE_END();
+    }
+
+    int mValue;
+};
+
+class Reader : public ChannelCoroutine {
+  public:
+    int runCoroutine() override {
+      mRuns++;
+      COROUTINE_LOOP() {
+        COROUTINE_CHANNEL_READ(channel, mValue);
+        mSum += mValue;
+      }
+    }
+
+    int mValue;
+    int mSum = 0;
+    uint16_t mRuns = 0;
+};
+
+Writer writer;
+Reader reader;
+
+test(EventTest, channelReaderIsNotPolled) {
+  for (int i = 0; i < 20; i++) {
+    ChannelScheduler::loop();
+  }
+  assertTrue(writer.isDone());
+  assertEqual(6, reader.mSum);
+  assertTrue(reader.isWaiting());
+
+  // Nobody writes to the channel anymore, so the reader is never run again.
+  uint16_t runs = reader.mRuns;
+  for (int i = 0; i < 100; i++) {
+    ChannelScheduler::loop();
+  }
+  assertEqual(runs, reader.mRuns);
+}
+
+// ---------------------------------------------------------------------------
+
+void setup() {
+#if defined(ARDUINO)
+  delay(1000); // some boards reboot twice
+#endif
+
+  Serial.begin(115200);
+  while (!Serial); // Leonardo/Micro
+
+  QueuedScheduler::setup();
+  ChannelScheduler::setup();
+}
+
+void loop() {
+  TestRunner::run();
+}
@@ -0,0 +1,116 @@
+#line 2 "GeneratorTest.ino"
+
+#include <AceRoutine.h>
+#include <AUnitVerbose.h>
+
+using namespace aunit;
+using namespace ace_routine;
+
+// Yields 0, 1, ..., mCount - 1, then ends.
+class Range : public Generator<uint32_t> {
+  public:
+    Range(uint32_t count) : mCount(count) {}
+
+    int runCoroutine() override {
+      COROUTINE_BEGIN();
+      for (mI = 0; mI < mCount; mI++) {
+        COROUTINE_YIELD_VALUE(mI);
+      }
+      COROUTINE_END();
+    }
+
+  private:
+    uint32_t mCount;
+    uint32_t mI;
+};
+
+// Pulls from another generator, and yields the squares of its even values.
+class EvenSquares : public Generator<uint32_t> {
+  public:
+    EvenSquares(Generator<uint32_t>& source) : mSource(source) {}
+
+    int runCoroutine() override {
+      COROUTINE_BEGIN();
+      while (mSource.next(mValue)) {
+        if (mValue % 2 != 0) continue;
+        COROUTINE_YIELD_VALUE(mValue * mValue);
+      }
+      COROUTINE_END();
+    }
+
+  private:
+    Generator<uint32_t>& mSource;
+    uint32_t mValue;
+};
+
+// An infinite generator.
+class Toggle : public Generator<bool> {
+  public:
+    int runCoroutine() override {
+      COROUTINE_LOOP() {
+        COROUTINE_YIELD_VALUE(true);
+        COROUTINE_YIELD_VALUE(false);
+      }
+    }
+};
+
+test(GeneratorTest, range) {
+  Range range(3);
+  uint32_t value = 99;
+  assertTrue(range.next(value));
+  assertEqual((uint32_t) 0, value);
+  assertTrue(range.next(value));
+  assertEqual((uint32_t) 1, value);
+  assertTrue(range.next(value));
+  assertEqual((uint32_t) 2, value);
+  assertFalse(range.isDone());
+
+  assertFalse(range.next(value));
+  assertEqual((uint32_t) 2, value);
+  assertTrue(range.isDone());
+  assertFalse(range.next(value));
+
+  range.reset();
+  assertTrue(range.next(value));
+  assertEqual((uint32_t) 0, value);
+}
+
+test(GeneratorTest, pipeline) {
+  Range range(7);
+  EvenSquares squares(range);
+  uint32_t sum = 0;
+  uint32_t count = 0;
+  uint32_t value;
+  while (squares.next(value)) {
+    sum += value;
+    count++;
+  }
+  assertEqual((uint32_t) 4, count);
+  assertEqual((uint32_t) (0 + 4 + 16 + 36), sum);
+  assertTrue(range.isDone());
+}
+
+test(GeneratorTest, forever) {
+  Toggle toggle;
+  bool value;
+  for (int i = 0; i < 10; i++) {
+    assertTrue(toggle.next(value));
+    assertEqual(i % 2 == 0, value);
+  }
+  assertFalse(toggle.isDone());
+}
+
+//----------------------------------------------------------------------------
+
+void setup() {
+#if ! defined(EPOXY_DUINO)
+  delay(1000); // wait to prevent garbage on SERIAL_PORT_MONITOR
+#endif
+
+  SERIAL_PORT_MONITOR.begin(115200);
+  while (!SERIAL_PORT_MONITOR); // Leonardo/Micro
+}
+
+void loop() {
+  TestRunner::run();
+}
@@ -0,0 +1,185 @@
+#line 2 "IdleHookTest.ino"
+
+#include <AceRoutine.h>
+#include <AUnitVerbose.h>
+#include "ace_routine/testing/TestableClockInterface.h"
+
+using namespace aunit;
+using namespace ace_routine;
+using ace_routine::testing::TestableClockInterface;
+
+using PolledCoroutine = CoroutineTemplate<
+    Coroutine_Delay_32bit_Impl<UnnamedCoroutine, TestableClockInterface>>;
+using PolledScheduler = CoroutineSchedulerTemplate<PolledCoroutine>;
+
+using QueuedCoroutine = CoroutineTemplate<Coroutine_Delay_32bit_Impl<
+    Coroutine_Queue_Impl<UnnamedCoroutine>, TestableClockInterface>>;
+using QueuedScheduler = CoroutineSchedulerTemplate<QueuedCoroutine>;
+
+// A separate list of coroutines, for the budget of runFor().
+using BudgetCoroutine = CoroutineTemplate<Coroutine_Delay_32bit_Impl<
+    Coroutine_Queue_Impl<NamedCoroutine>, TestableClockInterface>>;
+using BudgetScheduler = CoroutineSchedulerTemplate<BudgetCoroutine>;
+
+// ---------------------------------------------------------------------------
+
+// Record the wake time, and simulate the sleep by advancing the clock.
+uint16_t idleCount = 0;
+uint32_t idleWakeMicros = 0;
+
+void idleHook(uint32_t wakeMicros) {
+  idleCount++;
+  idleWakeMicros = wakeMicros;
+  TestableClockInterface::setMicros(wakeMicros);
+}
+
+template <typename T_COROUTINE>
+class Sleeper : public T_COROUTINE {
+  public:
+    Sleeper(uint16_t delayMillis) : mDelayMillis(delayMillis) {}
+
+    int runCoroutine() override {
+      mCount++;
+      COROUTINE_LOOP() {
+        COROUTINE_DELAY(mDelayMillis);
+      }
+    }
+
+    uint16_t mDelayMillis;
+    uint16_t mCount = 0;
+};
+
+Sleeper<PolledCoroutine> polledSlow(20);
+Sleeper<PolledCoroutine> polledFast(5);
+
+Sleeper<QueuedCoroutine> queuedSlow(20);
+Sleeper<QueuedCoroutine> queuedFast(5);
+
+Sleeper<BudgetCoroutine> budgetSleeper(20);
+
+test(IdleHookTest, polled) {
+  TestableClockInterface::setMicros(0);
+  idleCount = 0;
+  PolledScheduler::setIdleHook(idleHook);
+
+  // Before the first run, both coroutines are runnable now.
+  uint32_t wakeMicros = 0;
+  assertTrue(PolledScheduler::getNextWakeMicros(wakeMicros));
+  assertEqual((uint32_t) 0, wakeMicros);
+
+  // The first pass starts both delays.
+  PolledScheduler::loop();
+  PolledScheduler::loop();
+  assertTrue(PolledScheduler::getNextWakeMicros(wakeMicros));
+  assertEqual((uint32_t) 5000, wakeMicros);
+  assertEqual(0, idleCount);
+
+  // At the end of the pass, the scheduler sleeps until the fast one wakes.
+  PolledScheduler::loop();
+  assertEqual(1, idleCount);
+  assertEqual((uint32_t) 5000, idleWakeMicros);
+
+  // Suspended coroutines are ignored.
+  polledFast.suspend();
+  polledSlow.suspend();
+  assertFalse(PolledScheduler::getNextWakeMicros(wakeMicros));
+  polledFast.resume();
+  polledSlow.resume();
+
+  PolledScheduler::setIdleHook(nullptr);
+}
+
+test(IdleHookTest, queued) {
+  TestableClockInterface::setMicros(0);
+  idleCount = 0;
+  QueuedScheduler::setIdleHook(idleHook);
+
+  uint32_t wakeMicros = 0;
+  assertTrue(QueuedScheduler::getNextWakeMicros(wakeMicros));
+  assertEqual((uint32_t) 0, wakeMicros);
+
+  QueuedScheduler::loop();
+  QueuedScheduler::loop();
+  assertTrue(QueuedScheduler::getNextWakeMicros(wakeMicros));
+  assertEqual((uint32_t) 5000, wakeMicros);
+
+  // Nothing is ready, so the scheduler sleeps until the fast one wakes.
+  QueuedScheduler::loop();
+  assertEqual(1, idleCount);
+  assertEqual((uint32_t) 5000, idleWakeMicros);
+  assertEqual(1, queuedFast.mCount);
+
+  // Then runs it.
+  QueuedScheduler::loop();
+  assertEqual(2, queuedFast.mCount);
+  assertEqual(1, queuedSlow.mCount);
+
+  // Sleep until 10000, run fast; sleep until 15000, run fast; sleep until
+  // 20000.
+  for (int i = 0; i < 5; i++) {
+    QueuedScheduler::loop();
+  }
+  assertEqual(4, idleCount);
+  assertEqual((uint32_t) 20000, idleWakeMicros);
+  assertEqual(4, queuedFast.mCount);
+  assertEqual(1, queuedSlow.mCount);
+
+  // Both are due, and run without sleeping.
+  QueuedScheduler::loop();
+  QueuedScheduler::loop();
+  assertEqual(4, idleCount);
+  assertEqual(5, queuedFast.mCount);
+  assertEqual(2, queuedSlow.mCount);
+
+  queuedFast.suspend();
+  queuedSlow.suspend();
+  assertFalse(QueuedScheduler::getNextWakeMicros(wakeMicros));
+
+  QueuedScheduler::setIdleHook(nullptr);
+}
+
+test(IdleHookTest, queuedRunFor) {
+  TestableClockInterface::setMicros(0);
+  idleCount = 0;
+  BudgetScheduler::setIdleHook(idleHook);
+
+  // The sleeper starts its delay until 20000, then the hook sleeps until the
+  // end of the budget instead.
+  assertEqual((uint32_t) 0, BudgetScheduler::runFor(1000));
+  assertEqual(1, budgetSleeper.mCount);
+  assertEqual(1, idleCount);
+  assertEqual((uint32_t) 1000, idleWakeMicros);
+
+  // The budget ends after the wake time, which is not clamped.
+  assertEqual((uint32_t) 11000, BudgetScheduler::runFor(30000));
+  assertEqual(2, idleCount);
+  assertEqual((uint32_t) 20000, idleWakeMicros);
+
+  // Outside of runFor(), the wake time is not clamped either.
+  BudgetScheduler::loop();
+  assertEqual(2, budgetSleeper.mCount);
+  BudgetScheduler::loop();
+  assertEqual(3, idleCount);
+  assertEqual((uint32_t) 40000, idleWakeMicros);
+
+  BudgetScheduler::setIdleHook(nullptr);
+}
+
+// ---------------------------------------------------------------------------
+
+void setup() {
+#if defined(ARDUINO)
+  delay(1000); // some boards reboot twice
+#endif
+
+  Serial.begin(115200);
+  while (!Serial); // Leonardo/Micro
+
+  PolledScheduler::setup();
+  QueuedScheduler::setup();
+  BudgetScheduler::setup();
+}
+
+void loop() {
+  TestRunner::run();
+}
@@ -0,0 +1,213 @@
+#line 2 "JoinTest.ino"
+
+#include <AceRoutine.h>
+#include <AUnitVerbose.h>
+#include "ace_routine/testing/TestableClockInterface.h"
+
+using namespace aunit;
+using namespace ace_routine;
+using ace_routine::testing::TestableClockInterface;
+
+// Polling mode.
+using PolledCoroutine = CoroutineTemplate<Coroutine_Delay_16bit_Impl<
+    UnnamedCoroutine, TestableClockInterface>>;
+using PolledScheduler = CoroutineSchedulerTemplate<PolledCoroutine>;
+
+// Queued mode.
+using QueuedCoroutine = CoroutineTemplate<Coroutine_Delay_32bit_Impl<
+    Coroutine_Queue_Impl<UnnamedCoroutine>, TestableClockInterface>>;
+using QueuedScheduler = CoroutineSchedulerTemplate<QueuedCoroutine>;
+
+// Queued mode, with a separate list of coroutines for the shared child.
+using SharedCoroutine = CoroutineTemplate<Coroutine_Delay_32bit_Impl<
+    Coroutine_Queue_Impl<NamedCoroutine>, TestableClockInterface>>;
+using SharedScheduler = CoroutineSchedulerTemplate<SharedCoroutine>;
+
+// A child which yields 'mSteps' times, then ends with a result.
+template <typename T_COROUTINE>
+class Worker : public T_COROUTINE {
+  public:
+    Worker(uint8_t steps) : mSteps(steps) {}
+
+    int runCoroutine() override {
+      COROUTINE_BEGIN();
+      for (mCount = 0; mCount < mSteps; mCount++) {
+        COROUTINE_YIELD();
+      }
+      mResult = mSteps * 10;
+      COROUTINE_END();
+    }
+
+    uint8_t mSteps;
+    uint8_t mCount;
+    int mResult = 0;
+};
+
+// A parent which joins 'a', then both 'b' and 'c', and counts its resumptions.
+template <typename T_COROUTINE>
+class Parent : public T_COROUTINE {
+  public:
+    Parent(Worker<T_COROUTINE>& a, Worker<T_COROUTINE>& b,
+        Worker<T_COROUTINE>& c) : mA(a), mB(b), mC(c) {}
+
+    int runCoroutine() override {
+      mNumRuns++;
+      COROUTINE_BEGIN();
+      COROUTINE_JOIN(mA);
+      mJoinedA = true;
+      mSum = mA.mResult;
+      COROUTINE_JOIN_ALL(mB, mC);
+      mSum += mB.mResult + mC.mResult;
+      COROUTINE_END();
+    }
+
+    Worker<T_COROUTINE>& mA;
+    Worker<T_COROUTINE>& mB;
+    Worker<T_COROUTINE>& mC;
+    uint16_t mNumRuns = 0;
+    bool mJoinedA = false;
+    int mSum = 0;
+};
+
+Worker<PolledCoroutine> polledA(2);
+Worker<PolledCoroutine> polledB(5);
+Worker<PolledCoroutine> polledC(1);
+Parent<PolledCoroutine> polledParent(polledA, polledB, polledC);
+
+Worker<QueuedCoroutine> queuedA(2);
+Worker<QueuedCoroutine> queuedB(5);
+Worker<QueuedCoroutine> queuedC(1);
+Parent<QueuedCoroutine> queuedParent(queuedA, queuedB, queuedC);
+
+test(JoinTest, polled) {
+  PolledScheduler::setup();
+  for (int i = 0; i < 10; i++) PolledScheduler::runAll();
+
+  assertTrue(polledParent.isDone());
+  assertEqual(20 + 50 + 10, polledParent.mSum);
+  // The parent is polled on every pass until the children are done.
+  assertMore((int) polledParent.mNumRuns, 5);
+}
+
+test(JoinTest, queued) {
+  QueuedScheduler::setup();
+  RunQueues<QueuedCoroutine>* queues = RunQueues<QueuedCoroutine>::getInstance();
+
+  // The parent runs once, then waits in the join list.
+  QueuedScheduler::runAll();
+  assertTrue(queuedParent.isWaiting());
+  assertEqual(1, (int) queues->getJoiningSize());
+  assertEqual(1, (int) queuedParent.mNumRuns);
+
+  // Woken up exactly when 'a' ends, then waits for 'b' and 'c'. It is
+  // woken up again when 'c' ends, and then when 'b' ends.
+  for (int i = 0; i < 3; i++) QueuedScheduler::runAll();
+  assertTrue(queuedA.isDone());
+  assertTrue(queuedParent.mJoinedA);
+  assertEqual(2, (int) queuedParent.mNumRuns);
+  assertEqual(1, (int) queues->getJoiningSize());
+
+  for (int i = 0; i < 10; i++) QueuedScheduler::runAll();
+  assertTrue(queuedParent.isDone());
+  assertEqual(20 + 50 + 10, queuedParent.mSum);
+  assertEqual(3, (int) queuedParent.mNumRuns);
+  assertEqual(0, (int) queues->getJoiningSize());
+  assertTrue(queues->isReadyEmpty());
+}
+
+// A coroutine which joins a child which has already ended does not yield.
+class LateJoiner : public PolledCoroutine {
+  public:
+    LateJoiner(PolledCoroutine& child) : mChild(child) {}
+
+    int runCoroutine() override {
+      COROUTINE_BEGIN();
+      COROUTINE_JOIN(mChild);
+      mJoined = true;
+      COROUTINE_END();
+    }
+
+    PolledCoroutine& mChild;
+    bool mJoined = false;
+};
+
+Worker<PolledCoroutine> lateChild(0);
+LateJoiner lateJoiner(lateChild);
+
+test(JoinTest, alreadyDone) {
+  lateChild.runCoroutine();
+  assertTrue(lateChild.isDone());
+
+  lateJoiner.runCoroutine();
+  assertTrue(lateJoiner.mJoined);
+  assertTrue(lateJoiner.isDone());
+}
+
+// A parent which joins a single child, and counts its resumptions.
+template <typename T_COROUTINE>
+class SingleJoiner : public T_COROUTINE {
+  public:
+    SingleJoiner(Worker<T_COROUTINE>& child) : mChild(child) {}
+
+    int runCoroutine() override {
+      mNumRuns++;
+      COROUTINE_BEGIN();
+      COROUTINE_JOIN(mChild);
+      mJoined = true;
+      COROUTINE_END();
+    }
+
+    Worker<T_COROUTINE>& mChild;
+    uint16_t mNumRuns = 0;
+    bool mJoined = false;
+};
+
+Worker<SharedCoroutine> sharedChild(3);
+SingleJoiner<SharedCoroutine> firstJoiner(sharedChild);
+SingleJoiner<SharedCoroutine> secondJoiner(sharedChild);
+
+test(JoinTest, sharedChild) {
+  SharedScheduler::setup();
+  RunQueues<SharedCoroutine>* queues =
+      RunQueues<SharedCoroutine>::getInstance();
+
+  // Only one of the parents waits in the join list, the other one polls.
+  SharedScheduler::runAll();
+  assertEqual(1, (int) queues->getJoiningSize());
+  assertTrue(firstJoiner.isWaiting());
+  assertTrue(secondJoiner.isWaiting());
+
+  // Both are resumed when the child ends.
+  for (int i = 0; i < 10; i++) SharedScheduler::runAll();
+  assertTrue(sharedChild.isDone());
+  assertTrue(firstJoiner.mJoined);
+  assertTrue(secondJoiner.mJoined);
+  assertTrue(firstJoiner.isDone());
+  assertTrue(secondJoiner.isDone());
+  assertEqual(0, (int) queues->getJoiningSize());
+  assertTrue(queues->isReadyEmpty());
+
+  // The waiting parent ran twice, the polling one on every pass.
+  bool firstWaited = firstJoiner.mNumRuns < secondJoiner.mNumRuns;
+  SingleJoiner<SharedCoroutine>& waiter =
+      firstWaited ? firstJoiner : secondJoiner;
+  SingleJoiner<SharedCoroutine>& poller =
+      firstWaited ? secondJoiner : firstJoiner;
+  assertEqual(2, (int) waiter.mNumRuns);
+  assertMore((int) poller.mNumRuns, 2);
+}
+
+//----------------------------------------------------------------------------
+
+void setup() {
+#if ! defined(EPOXY_DUINO)
+  delay(1000); // wait to prevent garbage on SERIAL_PORT_MONITOR
+#endif
+
+  SERIAL_PORT_MONITOR.begin(115200);
+  while (!SERIAL_PORT_MONITOR); // Leonardo/Micro
+}
+
+void loop() {
+  TestRunner::run();
+}
@@ -0,0 +1,191 @@
+#line 2 "LazySetupTest.ino"
+
+#include <AceRoutine.h>
+#include <AUnitVerbose.h>
+#include "ace_routine/testing/TestableClockInterface.h"
+
+using namespace aunit;
+using namespace ace_routine;
+using ace_routine::testing::TestableClockInterface;
+
+// Each test uses its own Coroutine type, hence its own scheduler.
+class LazyClock : public TestableClockInterface {};
+class StagedClock : public TestableClockInterface {};
+class QueuedClock : public TestableClockInterface {};
+
+using LazyCoroutine = CoroutineTemplate<Coroutine_Delay_16bit_Impl<
+    Coroutine_LazySetup_Impl<UnnamedCoroutine>, LazyClock>>;
+using LazyScheduler = CoroutineSchedulerTemplate<LazyCoroutine>;
+
+using StagedCoroutine = CoroutineTemplate<Coroutine_Delay_16bit_Impl<
+    Coroutine_LazySetup_Impl<UnnamedCoroutine>, StagedClock>>;
+using StagedScheduler = CoroutineSchedulerTemplate<StagedCoroutine>;
+
+using QueuedCoroutine = CoroutineTemplate<Coroutine_Delay_32bit_Impl<
+    Coroutine_LazySetup_Impl<Coroutine_Queue_Impl<UnnamedCoroutine>>,
+    QueuedClock>>;
+using QueuedScheduler = CoroutineSchedulerTemplate<QueuedCoroutine>;
+
+// Records the order of the setups, as a string of ids.
+char setupOrder[8];
+uint8_t numSetups = 0;
+
+template <typename T_COROUTINE>
+class Device : public T_COROUTINE {
+  public:
+    Device(char id, uint8_t priority = 0) : mId(id) {
+      this->setSetupPriority(priority);
+    }
+
+    void setupCoroutine() override {
+      setupOrder[numSetups++] = mId;
+      setupOrder[numSetups] = '\0';
+      mNumSetups++;
+    }
+
+    int runCoroutine() override {
+      // Must never run before its setup.
+      if (mNumSetups == 0) mRanEarly = true;
+      mNumRuns++;
+      return 0;
+    }
+
+    char mId;
+    uint8_t mNumSetups = 0;
+    uint16_t mNumRuns = 0;
+    bool mRanEarly = false;
+};
+
+void resetSetups() {
+  numSetups = 0;
+  setupOrder[0] = '\0';
+}
+
+// The coroutines are inserted at the root of their list, so the scheduler
+// visits them in the reverse order of their definitions.
+Device<LazyCoroutine> lazyB('b');
+Device<LazyCoroutine> lazyA('a');
+
+test(LazySetupTest, lazy) {
+  resetSetups();
+  LazyScheduler::setup();
+  assertFalse(lazyA.isSetUp());
+  assertFalse(lazyB.isSetUp());
+
+  // Each coroutine is set up just before its first dispatch.
+  LazyScheduler::loop();
+  assertTrue(lazyA.isSetUp());
+  assertFalse(lazyB.isSetUp());
+  assertEqual(1, (int) lazyA.mNumRuns);
+
+  LazyScheduler::loop();
+  assertTrue(lazyB.isSetUp());
+  assertEqual("ab", (const char*) setupOrder);
+
+  // And only once.
+  for (int i = 0; i < 4; i++) LazyScheduler::loop();
+  assertEqual(1, (int) lazyA.mNumSetups);
+  assertEqual(1, (int) lazyB.mNumSetups);
+  assertEqual(3, (int) lazyA.mNumRuns);
+}
+
+Device<StagedCoroutine> stagedLow('l', 0);
+Device<StagedCoroutine> stagedHigh('h', 9);
+Device<StagedCoroutine> stagedMid('m', 5);
+Device<StagedCoroutine> stagedMid2('n', 5);
+Device<StagedCoroutine> stagedSuspended('s', 20);
+
+test(LazySetupTest, staged) {
+  resetSetups();
+  stagedSuspended.suspend();
+  StagedScheduler::setSetupBudget(1);
+  StagedScheduler::setup();
+
+  // One setup per pass, highest priority first. A suspended coroutine does
+  // not hold back the others.
+  StagedScheduler::runAll();
+  assertEqual("h", (const char*) setupOrder);
+  assertEqual(1, (int) stagedHigh.mNumRuns);
+  assertEqual(0, (int) stagedMid.mNumRuns);
+
+  StagedScheduler::runAll();
+  StagedScheduler::runAll();
+  StagedScheduler::runAll();
+  assertEqual("hnml", (const char*) setupOrder);
+  assertEqual(4, (int) stagedHigh.mNumRuns);
+  assertEqual(1, (int) stagedLow.mNumRuns);
+
+  stagedSuspended.resume();
+  StagedScheduler::runAll();
+  assertEqual("hnmls", (const char*) setupOrder);
+
+  assertFalse(stagedLow.mRanEarly);
+  assertFalse(stagedMid.mRanEarly);
+  assertFalse(stagedMid2.mRanEarly);
+  assertFalse(stagedSuspended.mRanEarly);
+}
+
+Device<QueuedCoroutine> queuedLow('l', 0);
+Device<QueuedCoroutine> queuedHigh('h', 1);
+
+test(LazySetupTest, queued) {
+  resetSetups();
+  QueuedScheduler::setSetupBudget(1);
+  QueuedScheduler::setup();
+
+  // A pass of loop() lasts 2 dispatches, one per coroutine, so the low one
+  // is not set up in the first pass, and does not run.
+  QueuedScheduler::loop();
+  assertEqual("h", (const char*) setupOrder);
+  QueuedScheduler::loop();
+  assertEqual("h", (const char*) setupOrder);
+  assertEqual(0, (int) queuedLow.mNumRuns);
+
+  // It is set up in the second pass.
+  QueuedScheduler::loop();
+  QueuedScheduler::loop();
+  assertEqual("hl", (const char*) setupOrder);
+  assertEqual(1, (int) queuedLow.mNumRuns);
+  assertEqual(2, (int) queuedHigh.mNumRuns);
+
+  for (int i = 0; i < 6; i++) QueuedScheduler::loop();
+  assertEqual("hl", (const char*) setupOrder);
+  assertFalse(queuedLow.mRanEarly);
+  assertEqual(4, (int) queuedLow.mNumRuns);
+}
+
+// setupCoroutines() sets up all coroutines eagerly, and they are not set up
+// again on their first dispatch.
+class EagerClock : public TestableClockInterface {};
+using EagerCoroutine = CoroutineTemplate<Coroutine_Delay_16bit_Impl<
+    Coroutine_LazySetup_Impl<UnnamedCoroutine>, EagerClock>>;
+using EagerScheduler = CoroutineSchedulerTemplate<EagerCoroutine>;
+
+Device<EagerCoroutine> eagerA('a');
+Device<EagerCoroutine> eagerB('b');
+
+test(LazySetupTest, eager) {
+  resetSetups();
+  EagerScheduler::setup();
+  EagerScheduler::setupCoroutines();
+  assertTrue(eagerA.isSetUp());
+  assertTrue(eagerB.isSetUp());
+  EagerScheduler::runAll();
+  assertEqual(1, (int) eagerA.mNumSetups);
+  assertEqual(1, (int) eagerB.mNumSetups);
+}
+
+//----------------------------------------------------------------------------
+
+void setup() {
+#if ! defined(EPOXY_DUINO)
+  delay(1000); // wait to prevent garbage on SERIAL_PORT_MONITOR
+#endif
+
+  SERIAL_PORT_MONITOR.begin(115200);
+  while (!SERIAL_PORT_MONITOR); // Leonardo/Micro
+}
+
+void loop() {
+  TestRunner::run();
+}
@@ -0,0 +1,244 @@
+#line 2 "NativeCoroutineTest.ino"
+
+#include <AceRoutine.h>
+#include <AUnitVerbose.h>
+#include "ace_routine/testing/TestableClockInterface.h"
+
+using namespace aunit;
+using namespace ace_routine;
+using ace_routine::testing::TestableClockInterface;
+
+// The C++20 coroutines are available only with a C++20 compiler (see
+// Makefile). Otherwise, this test is empty.
+#if ACE_ROUTINE_NATIVE_COROUTINE
+
+using TestableNativeCoroutine = NativeCoroutineTemplate<
+    Coroutine_Delay_16bit_Impl<UnnamedCoroutine, TestableClockInterface>>;
+using TestableNativeScheduler = CoroutineSchedulerTemplate<
+    CoroutineTemplate<Coroutine_Delay_16bit_Impl<
+        UnnamedCoroutine, TestableClockInterface>>>;
+
+FrameArenaTemplate<256, 3> arena;
+
+// Counts in a local variable, which lives in the frame of each instance.
+class Counter : public TestableNativeCoroutine {
+  public:
+    Counter(FrameArena& arena, int step) :
+        TestableNativeCoroutine(arena), mStep(step) {}
+
+    NativeTask run() override {
+      int count = 0;
+      while (count < 3 * mStep) {
+        count += mStep;
+        mCount = count;
+        co_await coroutineYield();
+      }
+    }
+
+    int mStep;
+    int mCount = 0;
+};
+
+// Waits 10 millis, 20 micros, then 2 seconds, then ends.
+class Sleeper : public TestableNativeCoroutine {
+  public:
+    Sleeper(FrameArena& arena) : TestableNativeCoroutine(arena) {}
+
+    NativeTask run() override {
+      mStage = 1;
+      co_await coroutineDelay(10);
+      mStage = 2;
+      co_await coroutineDelayMicros(20);
+      mStage = 3;
+      co_await coroutineDelaySeconds(2);
+      mStage = 4;
+    }
+
+    uint8_t mStage = 0;
+};
+
+// Waits longer than the 16-bit delay policy allows.
+class LongSleeper : public TestableNativeCoroutine {
+  public:
+    LongSleeper(FrameArena& arena) : TestableNativeCoroutine(arena) {}
+
+    NativeTask run() override {
+      co_await coroutineDelay(70000);
+      mWoken = true;
+    }
+
+    bool mWoken = false;
+};
+
+Counter one(arena, 1);
+Counter ten(arena, 10);
+Sleeper sleeper(arena);
+
+test(NativeCoroutineTest, instances) {
+  one.reset();
+  ten.reset();
+
+  one.runCoroutine();
+  ten.runCoroutine();
+  assertEqual(1, one.mCount);
+  assertEqual(10, ten.mCount);
+  assertTrue(one.isYielding());
+  assertEqual(1, (int) arena.getNumFree());
+
+  one.runCoroutine();
+  ten.runCoroutine();
+  assertEqual(2, one.mCount);
+  assertEqual(20, ten.mCount);
+
+  one.runCoroutine();
+  one.runCoroutine();
+  assertEqual(3, one.mCount);
+  assertTrue(one.isEnding());
+  assertEqual(2, (int) arena.getNumFree());
+
+  // A reset() restarts from the beginning, with a new frame.
+  ten.reset();
+  assertEqual(3, (int) arena.getNumFree());
+  ten.runCoroutine();
+  assertEqual(10, ten.mCount);
+  ten.reset();
+}
+
+test(NativeCoroutineTest, delays) {
+  TestableClockInterface::setMillis(0);
+  TestableClockInterface::setMicros(0);
+  TestableClockInterface::setSeconds(0);
+  sleeper.reset();
+
+  sleeper.runCoroutine();
+  assertEqual(1, sleeper.mStage);
+  assertTrue(sleeper.isDelaying());
+
+  TestableClockInterface::setMillis(9);
+  sleeper.runCoroutine();
+  assertEqual(1, sleeper.mStage);
+
+  TestableClockInterface::setMillis(10);
+  sleeper.runCoroutine();
+  assertEqual(2, sleeper.mStage);
+
+  TestableClockInterface::setMicros(19);
+  sleeper.runCoroutine();
+  assertEqual(2, sleeper.mStage);
+
+  TestableClockInterface::setMicros(20);
+  sleeper.runCoroutine();
+  assertEqual(3, sleeper.mStage);
+
+  TestableClockInterface::setSeconds(1);
+  sleeper.runCoroutine();
+  assertEqual(3, sleeper.mStage);
+
+  TestableClockInterface::setSeconds(2);
+  sleeper.runCoroutine();
+  assertEqual(4, sleeper.mStage);
+  assertTrue(sleeper.isEnding());
+  assertEqual(3, (int) arena.getNumFree());
+}
+
+test(NativeCoroutineTest, arenaFull) {
+  FrameArenaTemplate<256, 1> small;
+  Counter a(small, 1);
+  Counter b(small, 1);
+
+  a.runCoroutine();
+  b.runCoroutine();
+  assertEqual(1, a.mCount);
+  assertTrue(b.isEnding());
+  assertEqual(1, (int) small.getNumFailures());
+
+  // The frame of 'a' is released when it ends, and reused by 'b'.
+  a.runCoroutine();
+  a.runCoroutine();
+  a.runCoroutine();
+  assertTrue(a.isEnding());
+  b.reset();
+  b.runCoroutine();
+  assertEqual(1, b.mCount);
+  assertEqual(0, (int) small.getNumFree());
+
+  // Remove the local coroutines from the singly-linked list.
+  b.reset();
+  *TestableNativeCoroutine::getRoot() = &sleeper;
+}
+
+test(NativeCoroutineTest, longDelayIsClamped) {
+  FrameArenaTemplate<256, 1> small;
+  LongSleeper longSleeper(small);
+  TestableClockInterface::setMillis(0);
+
+  // 70000 millis would be truncated to 4464 by the 16-bit policy, instead of
+  // being clamped to its maximum of 32767.
+  longSleeper.runCoroutine();
+  TestableClockInterface::setMillis(5000);
+  longSleeper.runCoroutine();
+  assertFalse(longSleeper.mWoken);
+
+  TestableClockInterface::setMillis(32767);
+  longSleeper.runCoroutine();
+  assertTrue(longSleeper.mWoken);
+
+  // Remove the local coroutine from the singly-linked list.
+  longSleeper.reset();
+  *TestableNativeCoroutine::getRoot() = &sleeper;
+}
+
+test(NativeCoroutineTest, frameTooLarge) {
+  FrameArenaTemplate<8, 1> tiny;
+  Counter a(tiny, 1);
+
+  a.runCoroutine();
+  assertTrue(a.isEnding());
+  assertEqual(1, (int) tiny.getNumFailures());
+  assertEqual(1, (int) tiny.getNumFree());
+  assertMore((int) tiny.getMaxFrameSize(), 8);
+
+  *TestableNativeCoroutine::getRoot() = &sleeper;
+}
+
+test(NativeCoroutineTest, scheduler) {
+  one.reset();
+  ten.reset();
+  sleeper.reset();
+  TestableClockInterface::setMillis(0);
+  TestableNativeScheduler::setup();
+
+  // One pass runs the 3 coroutines.
+  for (int i = 0; i < 3; i++) TestableNativeScheduler::loop();
+  assertEqual(1, one.mCount);
+  assertEqual(10, ten.mCount);
+  assertEqual(1, sleeper.mStage);
+
+  for (int i = 0; i < 9; i++) TestableNativeScheduler::loop();
+  assertEqual(3, one.mCount);
+  assertEqual(30, ten.mCount);
+  assertEqual(1, sleeper.mStage);
+
+  TestableClockInterface::setMillis(10);
+  for (int i = 0; i < 3; i++) TestableNativeScheduler::loop();
+  assertEqual(2, sleeper.mStage);
+  assertTrue(one.isDone());
+  assertTrue(ten.isDone());
+}
+
+#endif
+
+//----------------------------------------------------------------------------
+
+void setup() {
+#if ! defined(EPOXY_DUINO)
+  delay(1000); // wait to prevent garbage on SERIAL_PORT_MONITOR
+#endif
+
+  SERIAL_PORT_MONITOR.begin(115200);
+  while (!SERIAL_PORT_MONITOR); // Leonardo/Micro
+}
+
+void loop() {
+  TestRunner::run();
+}
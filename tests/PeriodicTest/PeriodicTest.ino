@@ -0,0 +1,133 @@
+#line 2 "PeriodicTest.ino"
+
+#include <AceRoutine.h>
+#include <AUnitVerbose.h>
+#include "ace_routine/testing/TestableClockInterface.h"
+
+using namespace aunit;
+using namespace ace_routine;
+using ace_routine::testing::TestableClockInterface;
+
+template <uint8_t T_CATCH_UP>
+using PeriodicCoroutine = CoroutineTemplate<Coroutine_Periodic_Impl<
+    Coroutine_Delay_32bit_Impl<UnnamedCoroutine, TestableClockInterface>,
+    T_CATCH_UP>>;
+
+// Each run of the coroutine takes 300 micros, and the period is 10 millis.
+template <uint8_t T_CATCH_UP>
+class Sampler : public PeriodicCoroutine<T_CATCH_UP> {
+  public:
+    int runCoroutine() override {
+      COROUTINE_LOOP() {
+        mCount++;
+        TestableClockInterface::setMicros(TestableClockInterface::micros() + 300);
+        COROUTINE_DELAY_PERIODIC(10);
+      }
+    }
+
+    uint16_t mCount = 0;
+};
+
+// Run the coroutine directly, once per simulated micros.
+template <typename T>
+void runUntil(T& coroutine, uint32_t untilMicros) {
+  while ((int32_t) (TestableClockInterface::micros() - untilMicros) < 0) {
+    coroutine.runCoroutine();
+    TestableClockInterface::setMicros(TestableClockInterface::micros() + 1);
+  }
+}
+
+// ---------------------------------------------------------------------------
+
+Sampler<PeriodicCatchUp::kSkip> skipper;
+Sampler<PeriodicCatchUp::kBurst> burster;
+Sampler<PeriodicCatchUp::kCount> counter;
+
+test(PeriodicTest, noDrift) {
+  TestableClockInterface::setMicros(0);
+  skipper.reset();
+  skipper.mCount = 0;
+
+  // The first period is anchored at the first delay, at 300 micros. Despite
+  // the 300 micros of run time and 1 micros of lateness per run, there is no
+  // drift: exactly 100 runs in 1 second, and the deadline stays in phase.
+  runUntil(skipper, 1000000);
+  assertEqual(100, skipper.mCount);
+  assertEqual((uint32_t) 1000300, skipper.getPeriodDeadline());
+}
+
+test(PeriodicTest, skip) {
+  TestableClockInterface::setMicros(0);
+  skipper.reset();
+  skipper.mCount = 0;
+  runUntil(skipper, 1);
+  assertEqual((uint32_t) 10300, skipper.getPeriodDeadline());
+
+  // Run the period of 10300 late at 35000. The deadlines at 20300 and 30300
+  // are missed, so the next deadline is 40300, in phase with the original
+  // schedule.
+  TestableClockInterface::setMicros(35000);
+  skipper.runCoroutine();
+  assertEqual(2, skipper.mCount);
+  assertEqual((uint32_t) 40300, skipper.getPeriodDeadline());
+  assertEqual(0, skipper.getPeriodOverruns());
+}
+
+test(PeriodicTest, burst) {
+  TestableClockInterface::setMicros(0);
+  burster.reset();
+  burster.mCount = 0;
+  runUntil(burster, 1);
+
+  // Run the period of 10300 late at 35000. The missed periods at 20300 and
+  // 30300 are run back to back, then the schedule continues at 40300.
+  TestableClockInterface::setMicros(35000);
+  runUntil(burster, 36000);
+  assertEqual(4, burster.mCount);
+  assertEqual((uint32_t) 40300, burster.getPeriodDeadline());
+}
+
+test(PeriodicTest, count) {
+  TestableClockInterface::setMicros(0);
+  counter.reset();
+  counter.mCount = 0;
+  counter.clearPeriodOverruns();
+  runUntil(counter, 1);
+
+  TestableClockInterface::setMicros(35000);
+  counter.runCoroutine();
+  assertEqual(2, counter.mCount);
+  assertEqual((uint32_t) 40300, counter.getPeriodDeadline());
+  assertEqual(2, counter.getPeriodOverruns());
+}
+
+test(PeriodicTest, dueNow) {
+  TestableClockInterface::setMicros(0);
+  counter.reset();
+  counter.mCount = 0;
+  counter.clearPeriodOverruns();
+  runUntil(counter, 1);
+
+  // The run of the period of 10300 ends at 20300, exactly on the next
+  // deadline, which is due now but not missed.
+  TestableClockInterface::setMicros(20000);
+  counter.runCoroutine();
+  assertEqual(2, counter.mCount);
+  assertEqual((uint32_t) 20300, counter.getPeriodDeadline());
+  assertEqual(0, counter.getPeriodOverruns());
+}
+
+// ---------------------------------------------------------------------------
+
+void setup() {
+#if defined(ARDUINO)
+  delay(1000); // some boards reboot twice
+#endif
+
+  Serial.begin(115200);
+  while (!Serial); // Leonardo/Micro
+}
+
+void loop() {
+  TestRunner::run();
+}
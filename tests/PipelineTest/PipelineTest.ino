@@ -0,0 +1,174 @@
+#line 2 "PipelineTest.ino"
+
+#include <AceRoutine.h>
+#include <AUnitVerbose.h>
+#include "ace_routine/testing/TestableClockInterface.h"
+
+using namespace aunit;
+using namespace ace_routine;
+using ace_routine::testing::TestableClockInterface;
+
+using QueuedCoroutine = CoroutineTemplate<Coroutine_Delay_32bit_Impl<
+    Coroutine_Queue_Impl<UnnamedCoroutine>, TestableClockInterface>>;
+using QueuedScheduler = CoroutineSchedulerTemplate<QueuedCoroutine>;
+
+// Yields 1, 2, ..., mCount, then ends.
+class Range : public Generator<int> {
+  public:
+    Range(int count) : mCount(count) {}
+
+    int runCoroutine() override {
+      COROUTINE_BEGIN();
+      for (mI = 1; mI <= mCount; mI++) {
+        COROUTINE_YIELD_VALUE(mI);
+      }
+      COROUTINE_END();
+    }
+
+  private:
+    int mCount;
+    int mI;
+};
+
+int sum = 0;
+int numBatches = 0;
+int lastBatchSize = 0;
+
+Range range(7);
+
+// 1..7 -> 10..70 -> 10, 30, 50, 70 -> {10, 30, 50}, {70}
+PIPELINE(fused,
+    pipe::from(range)
+    | pipe::map([](int x) { return x * 10; })
+    | pipe::filter([](int x) { return (x / 10) % 2 == 1; })
+    | pipe::batch<3>()
+    | pipe::sink([](const pipe::Batch<int, 3>& b) {
+        numBatches++;
+        lastBatchSize = b.size;
+        for (uint8_t i = 0; i < b.size; i++) sum += b.items[i];
+      }));
+
+test(PipelineTest, fused) {
+  for (int i = 0; i < 20 && ! fused.isDone(); i++) {
+    fused.runCoroutine();
+  }
+  assertTrue(fused.isDone());
+  assertEqual(10 + 30 + 50 + 70, sum);
+  assertEqual(2, numBatches);
+  assertEqual(1, lastBatchSize);
+}
+
+// A stage which delays, between two pipes: source -> channelA -> delayer ->
+// channelB -> sink.
+Channel<int> channelA;
+Channel<int> channelB;
+Range shortRange(3);
+int received[3];
+int numReceived = 0;
+
+PIPELINE(head,
+    pipe::from(shortRange)
+    | pipe::map([](int x) { return x + 100; })
+    | pipe::to(channelA));
+
+class Delayer : public Coroutine {
+  public:
+    int runCoroutine() override {
+      COROUTINE_LOOP() {
+        COROUTINE_CHANNEL_READ(channelA, mValue);
+        COROUTINE_DELAY(0);
+        COROUTINE_CHANNEL_WRITE(channelB, mValue);
+      }
+    }
+
+  private:
+    int mValue;
+};
+
+Delayer delayer;
+
+PIPELINE(tail,
+    pipe::from(channelB)
+    | pipe::sink([](int x) { received[numReceived++] = x; }));
+
+test(PipelineTest, channelBoundaries) {
+  for (int i = 0; i < 100 && numReceived < 3; i++) {
+    head.runCoroutine();
+    delayer.runCoroutine();
+    tail.runCoroutine();
+  }
+  assertEqual(3, numReceived);
+  assertEqual(101, received[0]);
+  assertEqual(102, received[1]);
+  assertEqual(103, received[2]);
+
+  for (int i = 0; i < 10; i++) head.runCoroutine();
+  assertTrue(head.isDone());
+  assertFalse(tail.isDone());
+}
+
+// A queued pipeline blocked on its Channel waits on the event of the channel,
+// instead of yielding and being run on every pass.
+Channel<int, QueuedCoroutine> queuedChannel;
+int queuedSum = 0;
+int queuedNumValues = 0;
+
+auto queuedTail_pipe = pipe::from(queuedChannel)
+    | pipe::sink([](int x) { queuedSum += x; queuedNumValues++; });
+PipelineTemplate<QueuedCoroutine, decltype(queuedTail_pipe)> queuedTail(
+    queuedTail_pipe);
+
+class QueuedWriter : public QueuedCoroutine {
+  public:
+    int runCoroutine() override {
+      COROUTINE_BEGIN();
+      COROUTINE_AWAIT(mStart);
+      for (mI = 1; mI <= 3; mI++) {
+        COROUTINE_CHANNEL_WRITE(queuedChannel, mI);
+      }
+      COROUTINE_END();
+    }
+
+    bool mStart = false;
+
+  private:
+    int mI;
+};
+
+QueuedWriter queuedWriter;
+
+test(PipelineTest, queuedWaitsOnChannel) {
+  for (int i = 0; i < 10; i++) QueuedScheduler::loop();
+  assertTrue(queuedTail.isWaiting());
+  assertEqual(0, queuedNumValues);
+
+  queuedWriter.mStart = true;
+  for (int i = 0; i < 50 && ! queuedWriter.isDone(); i++) {
+    QueuedScheduler::loop();
+  }
+  assertTrue(queuedWriter.isDone());
+  assertEqual(3, queuedNumValues);
+  assertEqual(1 + 2 + 3, queuedSum);
+
+  // Back to waiting for the next value.
+  for (int i = 0; i < 10; i++) QueuedScheduler::loop();
+  assertTrue(queuedTail.isWaiting());
+}
+
+//----------------------------------------------------------------------------
+
+void setup() {
+#if ! defined(EPOXY_DUINO)
+  delay(1000); // wait to prevent garbage on SERIAL_PORT_MONITOR
+#endif
+
+  SERIAL_PORT_MONITOR.begin(115200);
+  while (!SERIAL_PORT_MONITOR); // Leonardo/Micro
+
+  TestableClockInterface::setMicros(0);
+  QueuedScheduler::setup();
+}
+
+void loop() {
+  TestRunner::run();
+}
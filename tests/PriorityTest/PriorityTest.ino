@@ -0,0 +1,116 @@
+#line 2 "PriorityTest.ino"
+
+#include <AceRoutine.h>
+#include <AUnitVerbose.h>
+#include "ace_routine/testing/TestableClockInterface.h"
+
+using namespace aunit;
+using namespace ace_routine;
+using ace_routine::testing::TestableClockInterface;
+
+// A queued Coroutine type with 3 priority levels.
+using PriorityCoroutine = CoroutineTemplate<Coroutine_Delay_32bit_Impl<
+    Coroutine_Queue_Impl<UnnamedCoroutine, 3>, TestableClockInterface>>;
+using PriorityScheduler = CoroutineSchedulerTemplate<PriorityCoroutine>;
+
+// ---------------------------------------------------------------------------
+
+class Yielder : public PriorityCoroutine {
+  public:
+    Yielder(uint8_t priority) { setPriority(priority); }
+
+    int runCoroutine() override {
+      mCount++;
+      COROUTINE_LOOP() {
+        COROUTINE_YIELD();
+      }
+    }
+
+    uint16_t mCount = 0;
+};
+
+class Sleeper : public PriorityCoroutine {
+  public:
+    int runCoroutine() override {
+      mCount++;
+      COROUTINE_LOOP() {
+        COROUTINE_DELAY(10);
+      }
+    }
+
+    uint16_t mCount = 0;
+};
+
+Yielder high(2);
+Yielder low(0);
+Sleeper sleeper; // priority 0
+
+test(PriorityTest, priorities) {
+  TestableClockInterface::setMicros(0);
+  assertEqual(2, high.getPriority());
+  assertEqual(0, low.getPriority());
+
+  // Only the highest level runs while it is ready.
+  for (int i = 0; i < 10; i++) {
+    PriorityScheduler::loop();
+  }
+  assertEqual(10, high.mCount);
+  assertEqual(0, low.mCount);
+  assertEqual(0, sleeper.mCount);
+
+  // Lower levels run when the higher levels are empty.
+  high.suspend();
+  PriorityScheduler::loop();
+  PriorityScheduler::loop();
+  assertEqual(1, low.mCount);
+  assertEqual(1, sleeper.mCount);
+  assertTrue(sleeper.isDelaying());
+
+  // An expired sleeper does not run ahead of a higher level.
+  high.resume();
+  TestableClockInterface::setMicros(10000);
+  PriorityScheduler::loop();
+  assertEqual(11, high.mCount);
+  assertEqual(1, sleeper.mCount);
+
+  // Raising the priority moves the coroutine ahead of 'high' (round-robin
+  // within level 2).
+  low.setPriority(5); // clamped to 2
+  assertEqual(2, low.getPriority());
+  PriorityScheduler::loop();
+  PriorityScheduler::loop();
+  assertEqual(12, high.mCount);
+  assertEqual(2, low.mCount);
+  assertEqual(1, sleeper.mCount);
+  low.setPriority(0);
+}
+
+test(PriorityTest, priorityAging) {
+  // Dispatch the lower levels once after every 3 dispatches of 'high'.
+  PriorityScheduler::setAgingLimit(3);
+  uint16_t highCount = high.mCount;
+  uint16_t lowCount = low.mCount + sleeper.mCount;
+  for (int i = 0; i < 12; i++) {
+    PriorityScheduler::loop();
+  }
+  assertEqual(highCount + 9, high.mCount);
+  assertEqual(lowCount + 3, low.mCount + sleeper.mCount);
+  PriorityScheduler::setAgingLimit(0);
+}
+
+// ---------------------------------------------------------------------------
+
+void setup() {
+#if defined(ARDUINO)
+  delay(1000); // some boards reboot twice
+#endif
+
+  Serial.begin(115200);
+  while (!Serial); // Leonardo/Micro
+
+  PriorityScheduler::setup();
+}
+
+void loop() {
+  TestRunner::run();
+}
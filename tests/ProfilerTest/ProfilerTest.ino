@@ -0,0 +1,199 @@
+#line 2 "ProfilerTest.ino"
+
+#include <AceRoutine.h>
+#include <AUnitVerbose.h>
+
+using namespace aunit;
+using namespace ace_routine;
+
+Profiler* Profiler::root;
+
+using Hdr2 = HdrHistogramCoroutineProfiler<2>;
+using TruncatedHdr2 = HdrHistogramCoroutineProfiler<2, 16>;
+
+// Profilers register themselves in a global list, so they must not be
+// created on the stack.
+HdrHistogramCoroutineProfiler<3> hdrProfiler;
+TruncatedHdr2 truncatedProfiler;
+LinearHistogramCoroutineProfiler<4, uint8_t> linearProfiler(10);
+Log2HistogramCoroutineProfiler<4, uint16_t> log2Profiler;
+HdrHistogramCoroutineProfiler<2, 16, uint8_t> narrowHdrProfiler;
+
+// ---------------------------------------------------------------------------
+
+test(LinearHistogram, bins) {
+  LinearHistogramCoroutineProfiler<4, uint8_t>& profiler = linearProfiler;
+  profiler.clear();
+  assertEqual(4u, profiler.getNumBins());
+
+  profiler.profileRun(0);
+  profiler.profileRun(9);
+  profiler.profileRun(10);
+  profiler.profileRun(35);
+  profiler.profileRun(1000);
+  assertEqual(2, profiler.getBinCount(0));
+  assertEqual(1, profiler.getBinCount(1));
+  assertEqual(0, profiler.getBinCount(2));
+  assertEqual(2, profiler.getBinCount(3));
+}
+
+test(LinearHistogram, saturation) {
+  // The uint8_t bins stop at 255 instead of wrapping around.
+  LinearHistogramCoroutineProfiler<4, uint8_t>& profiler = linearProfiler;
+  profiler.clear();
+  for (int i = 0; i < 300; i++) {
+    profiler.profileRun(0);
+  }
+  assertEqual(255, profiler.getBinCount(0));
+
+  profiler.clear();
+  assertEqual(0, profiler.getBinCount(0));
+}
+
+test(Log2Histogram, bins) {
+  Log2HistogramCoroutineProfiler<4, uint16_t>& profiler = log2Profiler;
+  profiler.clear();
+  profiler.profileRun(1);
+  profiler.profileRun(3);
+  profiler.profileRun(7);
+  profiler.profileRun(100);
+  assertEqual(1, profiler.getBinCount(0));
+  assertEqual(1, profiler.getBinCount(1));
+  assertEqual(1, profiler.getBinCount(2));
+  assertEqual(1, profiler.getBinCount(3));
+
+  for (uint32_t i = 0; i < 70000; i++) {
+    profiler.profileRun(1);
+  }
+  assertEqual((uint16_t) 65535, profiler.getBinCount(0));
+}
+
+// ---------------------------------------------------------------------------
+
+test(HdrHistogram, binIndex) {
+  // One bin per value below 2^SUB_BITS, and in the first power of 2 above.
+  assertEqual(0u, Hdr2::getBinIndex(0));
+  assertEqual(3u, Hdr2::getBinIndex(3));
+  assertEqual(4u, Hdr2::getBinIndex(4));
+  assertEqual(7u, Hdr2::getBinIndex(7));
+
+  // Then 4 sub-buckets per power of 2.
+  assertEqual(8u, Hdr2::getBinIndex(8));
+  assertEqual(8u, Hdr2::getBinIndex(9));
+  assertEqual(11u, Hdr2::getBinIndex(15));
+  assertEqual(12u, Hdr2::getBinIndex(16));
+  assertEqual(12u, Hdr2::getBinIndex(19));
+  assertEqual(15u, Hdr2::getBinIndex(31));
+
+  // The largest value is in the last bin.
+  assertEqual(Hdr2::kMaxBins - 1, Hdr2::getBinIndex(UINT32_MAX));
+}
+
+test(HdrHistogram, binLowest) {
+  assertEqual((uint32_t) 3, Hdr2::getBinLowest(3));
+  assertEqual((uint32_t) 8, Hdr2::getBinLowest(8));
+  assertEqual((uint32_t) 14, Hdr2::getBinLowest(11));
+  assertEqual((uint32_t) 28, Hdr2::getBinLowest(15));
+  assertEqual((uint32_t) 0xE0000000, Hdr2::getBinLowest(Hdr2::kMaxBins - 1));
+
+  // Every bin starts just after the previous one, so that the bins cover the
+  // whole range of uint32_t without gaps.
+  for (unsigned i = 1; i < Hdr2::kMaxBins; i++) {
+    uint32_t lowest = Hdr2::getBinLowest(i);
+    assertEqual(i, Hdr2::getBinIndex(lowest));
+    assertEqual(i - 1, Hdr2::getBinIndex(lowest - 1));
+  }
+}
+
+test(HdrHistogram, percentiles) {
+  HdrHistogramCoroutineProfiler<3>& profiler = hdrProfiler;
+  profiler.clear();
+  assertEqual((uint32_t) 0, profiler.getPercentile(50));
+
+  // 1..100, so that the percentiles are easy to check.
+  for (uint32_t i = 1; i <= 100; i++) {
+    profiler.profileRun(i);
+  }
+  assertEqual((uint32_t) 100, profiler.getCount());
+  assertEqual((uint32_t) 100, profiler.getMax());
+
+  // 50 is in the bin 48-51, 90 in 88-95, 99 in 96-103 which is clamped to
+  // the maximum.
+  assertEqual((uint32_t) 51, profiler.getPercentile(50));
+  assertEqual((uint32_t) 95, profiler.getPercentile(90));
+  assertEqual((uint32_t) 100, profiler.getPercentile(99));
+  assertEqual((uint32_t) 100, profiler.getPercentile(100));
+  assertEqual((uint32_t) 1, profiler.getPercentile(0));
+
+  profiler.clear();
+  assertEqual((uint32_t) 0, profiler.getCount());
+  assertEqual((uint32_t) 0, profiler.getMax());
+  assertEqual((uint32_t) 0, profiler.getPercentile(99));
+}
+
+test(HdrHistogram, truncatedBins) {
+  // 16 bins cover 0..31, larger values are counted in the last bin.
+  TruncatedHdr2& profiler = truncatedProfiler;
+  profiler.clear();
+  profiler.profileRun(10);
+  profiler.profileRun(1000);
+  profiler.profileRun(100000);
+
+  assertEqual((uint32_t) 3, profiler.getCount());
+  assertEqual((uint32_t) 100000, profiler.getMax());
+  assertEqual((uint32_t) 11, profiler.getPercentile(33));
+  assertEqual((uint32_t) 100000, profiler.getPercentile(50));
+}
+
+test(HdrHistogram, wait) {
+  // The wait profiler records the lateness with respect to the requested
+  // delay.
+  TruncatedHdr2& profiler = truncatedProfiler;
+  profiler.clear();
+  profiler.profileWait(1010, 1000);
+  assertEqual((uint32_t) 1, profiler.getCount());
+  assertEqual((uint32_t) 10, profiler.getMax());
+
+  // The bin is 10-11, but the percentile never exceeds the maximum.
+  assertEqual((uint32_t) 10, profiler.getPercentile(50));
+}
+
+test(HdrHistogram, narrowCounters) {
+  // The bins saturate, but the count and the maximum are exact.
+  HdrHistogramCoroutineProfiler<2, 16, uint8_t>& profiler = narrowHdrProfiler;
+  profiler.clear();
+  for (int i = 0; i < 300; i++) {
+    profiler.profileRun(5);
+  }
+  profiler.profileRun(20);
+  assertEqual(255, profiler.getBinCount(5));
+  assertEqual((uint32_t) 301, profiler.getCount());
+  assertEqual((uint32_t) 20, profiler.getMax());
+  assertEqual((uint32_t) 5, profiler.getPercentile(50));
+
+  // The percentiles are taken from the bins, which still reach their rank.
+  assertEqual((uint32_t) 5, profiler.getPercentile(99));
+  assertEqual((uint32_t) 20, profiler.getPercentile(100));
+}
+
+test(HdrHistogram, cyclesPerSecondAbove32Bits) {
+  // A 5 GHz time stamp counter does not fit in a 32-bit unsigned long.
+  HdrHistogramCoroutineProfiler<3>& profiler = hdrProfiler;
+  profiler.begin("tsc", "run", 5000000000ULL);
+  assertTrue(profiler.getCyclesPerSecond() == 5000000000ULL);
+}
+
+//----------------------------------------------------------------------------
+
+void setup() {
+#if ! defined(EPOXY_DUINO)
+  delay(1000); // wait to prevent garbage on SERIAL_PORT_MONITOR
+#endif
+
+  SERIAL_PORT_MONITOR.begin(115200);
+  while (!SERIAL_PORT_MONITOR); // Leonardo/Micro
+}
+
+void loop() {
+  TestRunner::run();
+}
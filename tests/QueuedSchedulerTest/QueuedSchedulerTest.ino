@@ -0,0 +1,246 @@
+#line 2 "QueuedSchedulerTest.ino"
+
+#include <AceRoutine.h>
+#include <AUnitVerbose.h>
+#include "ace_routine/testing/TestableClockInterface.h"
+
+using namespace aunit;
+using namespace ace_routine;
+using ace_routine::testing::TestableClockInterface;
+
+// A Coroutine type with the Coroutine_Queue_Impl layer and a delay policy which
+// knows the absolute wake time. The CoroutineScheduler of this type uses the
+// SleepQueue instead of polling the delaying coroutines.
+using QueuedCoroutine = CoroutineTemplate<Coroutine_Delay_32bit_Impl<
+    Coroutine_Queue_Impl<UnnamedCoroutine>, TestableClockInterface>>;
+using QueuedScheduler = CoroutineSchedulerTemplate<QueuedCoroutine>;
+
+// A queued Coroutine type whose delay policy does not know the wake time. The
+// Delaying coroutines stay in the ready list, but the Suspended and Terminated
+// coroutines are still parked.
+using ReadyCoroutine = CoroutineTemplate<Coroutine_Delay_16bit_Impl<
+    Coroutine_Queue_Impl<UnnamedCoroutine>, TestableClockInterface>>;
+using ReadyScheduler = CoroutineSchedulerTemplate<ReadyCoroutine>;
+
+// ---------------------------------------------------------------------------
+
+// Count the number of times runCoroutine() is called, to verify that a
+// delaying coroutine is not polled by the scheduler.
+class Sleeper : public QueuedCoroutine {
+  public:
+    Sleeper(uint16_t delayMillis) : mDelayMillis(delayMillis) {}
+
+    int runCoroutine() override {
+      mCount++;
+      COROUTINE_LOOP() {
+        COROUTINE_DELAY(mDelayMillis);
+        mWakes++;
+      }
+    }
+
+    uint16_t mDelayMillis;
+    uint16_t mCount = 0;
+    uint16_t mWakes = 0;
+};
+
+class Yielder : public QueuedCoroutine {
+  public:
+    int runCoroutine() override {
+      mCount++;
+      COROUTINE_LOOP() {
+        COROUTINE_YIELD();
+      }
+    }
+
+    uint16_t mCount = 0;
+};
+
+Sleeper slow(30);
+Sleeper fast(10);
+Yielder yielder;
+
+test(QueuedSchedulerTest, sleepersAreNotPolled) {
+  TestableClockInterface::setMicros(0);
+
+  // The first pass runs every coroutine once. The sleepers enter their delay
+  // and are moved into the SleepQueue.
+  for (int i = 0; i < 3; i++) {
+    QueuedScheduler::loop();
+  }
+  assertEqual(1, slow.mCount);
+  assertEqual(1, fast.mCount);
+  assertEqual(1, yielder.mCount);
+  assertTrue(slow.isDelaying());
+  assertTrue(fast.isDelaying());
+
+  // Before any wake time, only the yielder is dispatched. The sleepers are
+  // skipped by the round-robin without calling their runCoroutine().
+  for (int i = 0; i < 30; i++) {
+    QueuedScheduler::loop();
+  }
+  assertEqual(1, slow.mCount);
+  assertEqual(1, fast.mCount);
+  assertEqual(31, yielder.mCount);
+
+  // At 10 millis (the 32-bit delay policy uses micros), the fast sleeper wakes up first, and goes back to sleep.
+  TestableClockInterface::setMicros(10000);
+  QueuedScheduler::loop();
+  assertEqual(2, fast.mCount);
+  assertEqual(1, fast.mWakes);
+  assertEqual(1, slow.mCount);
+  assertTrue(fast.isDelaying());
+
+  for (int i = 0; i < 30; i++) {
+    QueuedScheduler::loop();
+  }
+  assertEqual(2, fast.mCount);
+  assertEqual(1, slow.mCount);
+
+  // At 30 millis, both are due. The fast one (due at 20) runs before the slow
+  // one (due at 30).
+  TestableClockInterface::setMicros(30000);
+  QueuedScheduler::loop();
+  assertEqual(3, fast.mCount);
+  assertEqual(1, slow.mCount);
+  QueuedScheduler::loop();
+  assertEqual(3, fast.mCount);
+  assertEqual(2, slow.mCount);
+  assertEqual(1, slow.mWakes);
+}
+
+class Counter : public ReadyCoroutine {
+  public:
+    int runCoroutine() override {
+      mCount++;
+      COROUTINE_LOOP() {
+        COROUTINE_YIELD();
+      }
+    }
+
+    uint16_t mCount = 0;
+};
+
+class Ender : public ReadyCoroutine {
+  public:
+    int runCoroutine() override {
+      mCount++;
+      COROUTINE_BEGIN();
+      COROUTINE_END();
+    }
+
+    uint16_t mCount = 0;
+};
+
+Counter counter;
+Counter parked;
+Ender ender;
+
+test(QueuedSchedulerTest, readyAndParkedLists) {
+  // 'parked' was suspended in setup(), so only 'counter' and 'ender' run.
+  assertEqual(CoroutineQueueNode::kQueueParked, parked.getQueueId());
+  ReadyScheduler::loop();
+  ReadyScheduler::loop();
+  assertEqual(1, counter.mCount);
+  assertEqual(1, ender.mCount);
+  assertTrue(ender.isEnding());
+
+  // The scheduler terminates 'ender' and parks it.
+  ReadyScheduler::loop();
+  ReadyScheduler::loop();
+  assertTrue(ender.isTerminated());
+  assertEqual(CoroutineQueueNode::kQueueParked, ender.getQueueId());
+  assertEqual(2, counter.mCount);
+
+  // Only 'counter' is runnable now, so it runs on every loop().
+  for (int i = 0; i < 10; i++) {
+    ReadyScheduler::loop();
+  }
+  assertEqual(12, counter.mCount);
+  assertEqual(1, ender.mCount);
+  assertEqual(0, parked.mCount);
+
+  // resume() and reset() move the coroutines back to the ready list.
+  parked.resume();
+  ender.reset();
+  assertEqual(CoroutineQueueNode::kQueueReady, parked.getQueueId());
+  assertEqual(CoroutineQueueNode::kQueueReady, ender.getQueueId());
+  for (int i = 0; i < 3; i++) {
+    ReadyScheduler::loop();
+  }
+  assertEqual(13, counter.mCount);
+  assertEqual(1, parked.mCount);
+  assertEqual(2, ender.mCount);
+
+  // suspend() parks the coroutine immediately. One of the loop() calls is used
+  // to terminate 'ender' again.
+  counter.suspend();
+  assertEqual(CoroutineQueueNode::kQueueParked, counter.getQueueId());
+  for (int i = 0; i < 10; i++) {
+    ReadyScheduler::loop();
+  }
+  assertEqual(13, counter.mCount);
+  assertEqual(10, parked.mCount);
+  assertTrue(ender.isTerminated());
+}
+
+// ---------------------------------------------------------------------------
+
+// A minimal node with a fixed wake time, to test the SleepQueue without
+// registering more coroutines with the scheduler.
+class FakeSleeper : public CoroutineQueueNode {
+  public:
+    FakeSleeper(uint32_t wakeMicros) : mWakeMicros(wakeMicros) {}
+
+    uint32_t getDelayWakeMicros() const { return mWakeMicros; }
+
+    uint32_t mWakeMicros;
+};
+
+test(QueuedSchedulerTest, sleepQueueOrdering) {
+  SleepQueue<FakeSleeper> queue = SleepQueue<FakeSleeper>();
+  assertTrue(queue.isEmpty());
+
+  // s3 and s4 wake up after the rollover of micros().
+  FakeSleeper s1(UINT32_MAX - 1500);
+  FakeSleeper s2(UINT32_MAX - 500);
+  FakeSleeper s3(500);
+  FakeSleeper s4(1500);
+  FakeSleeper s5(UINT32_MAX - 1000);
+  queue.push(&s3);
+  queue.push(&s1);
+  queue.push(&s4);
+  queue.push(&s5);
+  queue.push(&s2);
+  assertEqual((uintptr_t) &s1, (uintptr_t) queue.top());
+  assertTrue(queue.contains(&s4));
+
+  queue.remove(&s5);
+  assertFalse(queue.contains(&s5));
+
+  assertEqual((uintptr_t) &s1, (uintptr_t) queue.pop());
+  assertEqual((uintptr_t) &s2, (uintptr_t) queue.pop());
+  assertEqual((uintptr_t) &s3, (uintptr_t) queue.pop());
+  assertEqual((uintptr_t) &s4, (uintptr_t) queue.pop());
+  assertTrue(queue.isEmpty());
+  assertEqual((uintptr_t) nullptr, (uintptr_t) queue.pop());
+}
+
+// ---------------------------------------------------------------------------
+
+void setup() {
+#if defined(ARDUINO)
+  delay(1000); // some boards reboot twice
+#endif
+
+  Serial.begin(115200);
+  while (!Serial); // Leonardo/Micro
+
+  QueuedScheduler::setup();
+
+  parked.suspend();
+  ReadyScheduler::setup();
+}
+
+void loop() {
+  TestRunner::run();
+}
@@ -0,0 +1,112 @@
+#line 2 "ResumeIndexTest.ino"
+
+// Select the 8-bit resume index backend before including the library.
+#define ACE_ROUTINE_RESUME_INDEX 1
+
+#include <AceRoutine.h>
+#include <AUnitVerbose.h>
+#include "ace_routine/testing/TestableCoroutine.h"
+#include "ace_routine/testing/TestableClockInterface.h"
+
+using namespace ace_routine;
+using namespace ace_routine::testing;
+using namespace aunit;
+
+// ---------------------------------------------------------------------------
+
+bool simpleCoroutineFlag = false;
+
+// A coroutine that yields, delays for a millisecond, waits for flag, then ends.
+COROUTINE(TestableCoroutine, simpleCoroutine) {
+  COROUTINE_BEGIN();
+  COROUTINE_YIELD();
+  COROUTINE_DELAY(1);
+  COROUTINE_AWAIT(simpleCoroutineFlag);
+  COROUTINE_END();
+}
+
+test(ResumeIndexTest, simpleCoroutine) {
+  simpleCoroutineFlag = false;
+  TestableClockInterface::setMillis(0);
+
+  simpleCoroutine.runCoroutine();
+  assertTrue(simpleCoroutine.isYielding());
+
+  simpleCoroutine.runCoroutine();
+  assertTrue(simpleCoroutine.isDelaying());
+
+  simpleCoroutine.runCoroutine();
+  assertTrue(simpleCoroutine.isDelaying());
+
+  TestableClockInterface::setMillis(1);
+  simpleCoroutine.runCoroutine();
+  assertTrue(simpleCoroutine.isYielding());
+
+  simpleCoroutineFlag = true;
+  simpleCoroutine.runCoroutine();
+  assertTrue(simpleCoroutine.isEnding());
+
+  // Runs after the end do nothing.
+  simpleCoroutine.runCoroutine();
+  assertTrue(simpleCoroutine.isEnding());
+
+  // reset() goes back to the beginning.
+  simpleCoroutineFlag = false;
+  simpleCoroutine.reset();
+  simpleCoroutine.runCoroutine();
+  assertTrue(simpleCoroutine.isYielding());
+}
+
+// ---------------------------------------------------------------------------
+
+// Counts the number of passes through each continuation point of a loop.
+class Stepper : public TestableCoroutine {
+  public:
+    int runCoroutine() override {
+      COROUTINE_LOOP() {
+        mFirst++;
+        COROUTINE_YIELD();
+        mSecond++;
+        COROUTINE_YIELD();
+      }
+    }
+
+    uint8_t mFirst = 0;
+    uint8_t mSecond = 0;
+};
+
+Stepper stepper;
+
+test(ResumeIndexTest, loop) {
+  stepper.runCoroutine();
+  assertEqual(1, stepper.mFirst);
+  assertEqual(0, stepper.mSecond);
+
+  stepper.runCoroutine();
+  assertEqual(1, stepper.mFirst);
+  assertEqual(1, stepper.mSecond);
+
+  stepper.runCoroutine();
+  assertEqual(2, stepper.mFirst);
+  assertEqual(1, stepper.mSecond);
+
+  stepper.reset();
+  stepper.runCoroutine();
+  assertEqual(3, stepper.mFirst);
+  assertEqual(1, stepper.mSecond);
+}
+
+// ---------------------------------------------------------------------------
+
+void setup() {
+#if defined(ARDUINO)
+  delay(1000); // some boards reboot twice
+#endif
+
+  Serial.begin(115200);
+  while (!Serial); // Leonardo/Micro
+}
+
+void loop() {
+  TestRunner::run();
+}
@@ -0,0 +1,135 @@
+#line 2 "RunForTest.ino"
+
+#include <AceRoutine.h>
+#include <AUnitVerbose.h>
+#include "ace_routine/testing/TestableCoroutine.h"
+#include "ace_routine/testing/TestableCoroutineScheduler.h"
+#include "ace_routine/testing/TestableClockInterface.h"
+
+using namespace aunit;
+using namespace ace_routine;
+using ace_routine::testing::TestableClockInterface;
+using ace_routine::testing::TestableCoroutine;
+using ace_routine::testing::TestableCoroutineScheduler;
+
+using QueuedCoroutine = CoroutineTemplate<Coroutine_Delay_32bit_Impl<
+    Coroutine_Queue_Impl<UnnamedCoroutine>, TestableClockInterface>>;
+using QueuedScheduler = CoroutineSchedulerTemplate<QueuedCoroutine>;
+
+// ---------------------------------------------------------------------------
+
+// Each run of a Worker consumes 100 micros of the fake clock.
+template <typename T_COROUTINE>
+class Worker : public T_COROUTINE {
+  public:
+    int runCoroutine() override {
+      mCount++;
+      TestableClockInterface::setMicros(TestableClockInterface::micros() + 100);
+      COROUTINE_LOOP() {
+        COROUTINE_YIELD();
+      }
+    }
+
+    uint16_t mCount = 0;
+};
+
+Worker<TestableCoroutine> polledA;
+Worker<TestableCoroutine> polledB;
+Worker<TestableCoroutine> polledC;
+
+test(RunForTest, polledRunAll) {
+  TestableClockInterface::setMicros(0);
+  uint16_t a = polledA.mCount;
+  uint16_t b = polledB.mCount;
+  uint16_t c = polledC.mCount;
+
+  TestableCoroutineScheduler::runAll();
+  assertEqual(a + 1, polledA.mCount);
+  assertEqual(b + 1, polledB.mCount);
+  assertEqual(c + 1, polledC.mCount);
+}
+
+test(RunForTest, polledRunFor) {
+  TestableClockInterface::setMicros(0);
+  uint16_t total = polledA.mCount + polledB.mCount + polledC.mCount;
+
+  // 1000 micros is used up by 10 runs.
+  uint32_t remaining = TestableCoroutineScheduler::runFor(1000);
+  assertEqual((uint32_t) 0, remaining);
+  assertEqual(total + 10, polledA.mCount + polledB.mCount + polledC.mCount);
+}
+
+// ---------------------------------------------------------------------------
+
+class Sleeper : public QueuedCoroutine {
+  public:
+    int runCoroutine() override {
+      mCount++;
+      COROUTINE_LOOP() {
+        COROUTINE_DELAY(10);
+      }
+    }
+
+    uint16_t mCount = 0;
+};
+
+Worker<QueuedCoroutine> queuedA;
+Worker<QueuedCoroutine> queuedB;
+Sleeper sleeper;
+
+test(RunForTest, queuedRunAllAndRunFor) {
+  TestableClockInterface::setMicros(0);
+
+  // The first pass runs everything once, and the sleeper goes to sleep until
+  // 10000 micros.
+  QueuedScheduler::runAll();
+  assertEqual(1, queuedA.mCount);
+  assertEqual(1, queuedB.mCount);
+  assertEqual(1, sleeper.mCount);
+  assertTrue(sleeper.isDelaying());
+
+  // Coroutines requeued during the pass are not run twice.
+  QueuedScheduler::runAll();
+  assertEqual(2, queuedA.mCount);
+  assertEqual(2, queuedB.mCount);
+  assertEqual(1, sleeper.mCount);
+
+  // The workers use up the budget, without running the sleeper.
+  uint32_t remaining = QueuedScheduler::runFor(1000);
+  assertEqual((uint32_t) 0, remaining);
+  assertEqual(7, queuedA.mCount);
+  assertEqual(7, queuedB.mCount);
+  assertEqual(1, sleeper.mCount);
+
+  // With only the sleeper left, runFor() returns the unused budget.
+  queuedA.suspend();
+  queuedB.suspend();
+  TestableClockInterface::setMicros(2000);
+  remaining = QueuedScheduler::runFor(1000);
+  assertEqual((uint32_t) 1000, remaining);
+  assertEqual(1, sleeper.mCount);
+
+  // runAll() includes the sleepers whose wake time has passed.
+  TestableClockInterface::setMicros(10000);
+  QueuedScheduler::runAll();
+  assertEqual(2, sleeper.mCount);
+  assertEqual(7, queuedA.mCount);
+}
+
+// ---------------------------------------------------------------------------
+
+void setup() {
+#if defined(ARDUINO)
+  delay(1000); // some boards reboot twice
+#endif
+
+  Serial.begin(115200);
+  while (!Serial); // Leonardo/Micro
+
+  TestableCoroutineScheduler::setup();
+  QueuedScheduler::setup();
+}
+
+void loop() {
+  TestRunner::run();
+}
@@ -0,0 +1,114 @@
+#line 2 "SnapshotClockTest.ino"
+
+#include <AceRoutine.h>
+#include <AUnitVerbose.h>
+#include "ace_routine/testing/TestableClockInterface.h"
+
+using namespace aunit;
+using namespace ace_routine;
+using ace_routine::testing::TestableClockInterface;
+
+using PassClock = SnapshotClockInterface<TestableClockInterface>;
+using DispatchClock = SnapshotClockInterface<TestableClockInterface, true>;
+
+template <typename T_CLOCK>
+using SnapshotCoroutine = CoroutineTemplate<
+    Coroutine_Delay_32bit_Impl<UnnamedCoroutine, T_CLOCK>>;
+
+// Records the clock seen by the coroutine, then spends 10 micros.
+template <typename T_CLOCK>
+class Sampler : public SnapshotCoroutine<T_CLOCK> {
+  public:
+    int runCoroutine() override {
+      COROUTINE_LOOP() {
+        mSeen = T_CLOCK::micros();
+        TestableClockInterface::setMicros(TestableClockInterface::micros() + 10);
+        COROUTINE_YIELD();
+      }
+    }
+
+    unsigned long mSeen = 0;
+};
+
+Sampler<PassClock> passSamplerA;
+Sampler<PassClock> passSamplerB;
+
+Sampler<DispatchClock> dispatchSamplerA;
+Sampler<DispatchClock> dispatchSamplerB;
+
+using PassScheduler = CoroutineSchedulerTemplate<SnapshotCoroutine<PassClock>>;
+using DispatchScheduler =
+    CoroutineSchedulerTemplate<SnapshotCoroutine<DispatchClock>>;
+
+test(SnapshotClockTest, cachedUntilRefresh) {
+  TestableClockInterface::setMicros(100);
+  TestableClockInterface::setMillis(1);
+  PassClock::refreshPass();
+  assertEqual(100UL, PassClock::micros());
+  assertEqual(1UL, PassClock::millis());
+
+  TestableClockInterface::setMicros(2100);
+  TestableClockInterface::setMillis(3);
+  assertEqual(100UL, PassClock::micros());
+  assertEqual(1UL, PassClock::millis());
+
+  // Only a per-dispatch clock is refreshed before each coroutine.
+  PassClock::refreshDispatch();
+  assertEqual(100UL, PassClock::micros());
+
+  PassClock::refreshPass();
+  assertEqual(2100UL, PassClock::micros());
+  assertEqual(3UL, PassClock::millis());
+
+  DispatchClock::refreshPass();
+  assertEqual(2100UL, DispatchClock::micros());
+  TestableClockInterface::setMicros(2200);
+  DispatchClock::refreshDispatch();
+  assertEqual(2200UL, DispatchClock::micros());
+}
+
+test(SnapshotClockTest, schedulerRefreshesOncePerPass) {
+  TestableClockInterface::setMicros(1000);
+  PassScheduler::setup();
+
+  // Both coroutines see the clock of the start of the pass, although the
+  // first one spent 10 micros.
+  PassScheduler::runAll();
+  assertEqual(1000UL, passSamplerA.mSeen);
+  assertEqual(1000UL, passSamplerB.mSeen);
+
+  PassScheduler::runAll();
+  assertEqual(1020UL, passSamplerA.mSeen);
+  assertEqual(1020UL, passSamplerB.mSeen);
+
+  // loop() refreshes the clock when it wraps around to the first coroutine.
+  PassScheduler::loop();
+  PassScheduler::loop();
+  assertEqual(1040UL, passSamplerA.mSeen);
+  assertEqual(1040UL, passSamplerB.mSeen);
+}
+
+test(SnapshotClockTest, schedulerRefreshesPerDispatch) {
+  TestableClockInterface::setMicros(1000);
+  DispatchScheduler::setup();
+
+  // Whichever coroutine runs second sees the 10 micros spent by the first.
+  DispatchScheduler::runAll();
+  assertNotEqual(dispatchSamplerA.mSeen, dispatchSamplerB.mSeen);
+  assertEqual(2010UL, dispatchSamplerA.mSeen + dispatchSamplerB.mSeen);
+}
+
+// ---------------------------------------------------------------------------
+
+void setup() {
+#if defined(ARDUINO)
+  delay(1000); // some boards reboot twice
+#endif
+
+  Serial.begin(115200);
+  while (!Serial); // Leonardo/Micro
+}
+
+void loop() {
+  TestRunner::run();
+}
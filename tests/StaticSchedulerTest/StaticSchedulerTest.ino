@@ -0,0 +1,122 @@
+#line 2 "StaticSchedulerTest.ino"
+
+#include <AceRoutine.h>
+#include <AUnitVerbose.h>
+
+using namespace aunit;
+using namespace ace_routine;
+
+// Record the order in which the coroutines are run.
+char trace[32];
+uint8_t traceSize = 0;
+
+void record(char c) {
+  if (traceSize < sizeof(trace) - 1) {
+    trace[traceSize++] = c;
+    trace[traceSize] = '\0';
+  }
+}
+
+const char* getTrace() { return trace; }
+
+void clearTrace() {
+  traceSize = 0;
+  trace[0] = '\0';
+}
+
+class Looper : public Coroutine {
+  public:
+    int runCoroutine() override {
+      COROUTINE_LOOP() {
+        record('L');
+        COROUTINE_YIELD();
+      }
+    }
+
+    void setupCoroutine() override { mSetup = true; }
+
+    bool mSetup = false;
+};
+
+// Ends after 2 runs.
+class Finisher : public Coroutine {
+  public:
+    int runCoroutine() override {
+      COROUTINE_BEGIN();
+      record('F');
+      COROUTINE_YIELD();
+      record('F');
+      COROUTINE_END();
+    }
+};
+
+class Other : public Coroutine {
+  public:
+    int runCoroutine() override {
+      COROUTINE_LOOP() {
+        record('O');
+        COROUTINE_YIELD();
+      }
+    }
+};
+
+StaticScheduler<Looper, Finisher, Other> scheduler;
+
+test(StaticSchedulerTest, getAndSetup) {
+  assertEqual(3, (int) decltype(scheduler)::kNumCoroutines);
+
+  Looper& looper = scheduler.get<0>();
+  assertFalse(looper.mSetup);
+  scheduler.setupCoroutines();
+  assertTrue(looper.mSetup);
+}
+
+test(StaticSchedulerTest, loopRunsEachInOrder) {
+  Looper& looper = scheduler.get<0>();
+  Finisher& finisher = scheduler.get<1>();
+  Other& other = scheduler.get<2>();
+  looper.reset();
+  finisher.reset();
+  other.reset();
+
+  clearTrace();
+  scheduler.loop();
+  assertEqual("LFO", getTrace());
+
+  // The Finisher ends during the second pass, and is terminated on the third.
+  clearTrace();
+  scheduler.loop();
+  assertEqual("LFO", getTrace());
+  assertTrue(finisher.isEnding());
+
+  clearTrace();
+  scheduler.loop();
+  assertEqual("LO", getTrace());
+  assertTrue(finisher.isTerminated());
+
+  // A suspended coroutine is skipped.
+  other.suspend();
+  clearTrace();
+  scheduler.loop();
+  assertEqual("L", getTrace());
+
+  other.resume();
+  clearTrace();
+  scheduler.loop();
+  assertEqual("LO", getTrace());
+}
+
+// ---------------------------------------------------------------------------
+
+void setup() {
+#if defined(ARDUINO)
+  delay(1000); // some boards reboot twice
+#endif
+
+  Serial.begin(115200);
+  while (!Serial); // Leonardo/Micro
+}
+
+void loop() {
+  TestRunner::run();
+}
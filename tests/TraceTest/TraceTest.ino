@@ -0,0 +1,208 @@
+#line 2 "TraceTest.ino"
+
+#include <AceRoutine.h>
+#include <AUnitVerbose.h>
+#include <AceCommon.h> // PrintStr<N>
+#include "ace_routine/testing/TestableClockInterface.h"
+
+using namespace aunit;
+using namespace ace_routine;
+using ace_common::PrintStr;
+using ace_routine::testing::TestableClockInterface;
+
+// Each test uses its own Coroutine type, hence its own scheduler.
+class PolledClock : public TestableClockInterface {};
+class QueuedClock : public TestableClockInterface {};
+
+using PolledCoroutine = CoroutineTemplate<Coroutine_Delay_16bit_Impl<
+    Coroutine_Trace_Impl<NamedCoroutine>, PolledClock>>;
+using PolledScheduler = CoroutineSchedulerTemplate<PolledCoroutine>;
+
+using QueuedCoroutine = CoroutineTemplate<Coroutine_Delay_32bit_Impl<
+    Coroutine_Trace_Impl<Coroutine_Queue_Impl<UnnamedCoroutine>>,
+    QueuedClock>>;
+using QueuedScheduler = CoroutineSchedulerTemplate<QueuedCoroutine>;
+
+TraceRing<64> traceRing;
+TraceRing<4> smallRing;
+
+// Summarize the events of the ring as a string of the event letter followed
+// by the trace id, e.g. "D1Y1" for a dispatch then a yield of coroutine 1.
+const char* eventsOf(const TraceRingBase& ring) {
+  static char buf[128];
+  static const char kLetters[] = "SYLRETW"; // indexed by kStatusXxx
+  uint8_t pos = 0;
+  for (uint16_t i = 0; i < ring.getNumEvents() && pos < sizeof(buf) - 3; i++) {
+    const TraceEvent& event = ring.getEvent(i);
+    buf[pos++] = (event.event == TraceEvent::kEventDispatch)
+        ? 'D' : kLetters[event.event];
+    buf[pos++] = '0' + event.id;
+  }
+  buf[pos] = '\0';
+  return buf;
+}
+
+// ---------------------------------------------------------------------------
+
+test(TraceTest, ring) {
+  TraceRingBase& ring = smallRing;
+  ring.clear();
+  assertEqual(0, ring.getNumEvents());
+  assertEqual((uint32_t) 0, ring.getLost());
+
+  for (uint8_t i = 0; i < 6; i++) {
+    ring.record(i, TraceEvent::kEventDispatch, 100 + i);
+  }
+
+  // The ring keeps the 4 most recent events, oldest first.
+  assertEqual(4, ring.getNumEvents());
+  assertEqual((uint32_t) 2, ring.getLost());
+  assertEqual((uint32_t) 102, ring.getEvent(0).cycles);
+  assertEqual(2, ring.getEvent(0).id);
+  assertEqual((uint32_t) 105, ring.getEvent(3).cycles);
+
+  ring.clear();
+  assertEqual(0, ring.getNumEvents());
+  assertEqual((uint32_t) 0, ring.getLost());
+}
+
+// ---------------------------------------------------------------------------
+
+class PolledBlinker : public PolledCoroutine {
+  public:
+    int runCoroutine() override {
+      COROUTINE_BEGIN();
+      COROUTINE_YIELD();
+      COROUTINE_DELAY(10);
+      COROUTINE_END();
+    }
+};
+
+// The coroutines are inserted at the root of their list, so the scheduler
+// visits them in the reverse order of their definitions.
+PolledBlinker polledB;
+PolledBlinker polledA;
+
+test(TraceTest, polled) {
+  polledA.setName("a");
+  polledB.setName("b");
+  PolledClock::setMillis(0);
+  PolledClock::setMicros(0);
+  PolledScheduler::setTraceRing(&traceRing);
+  PolledScheduler::setup();
+  traceRing.clear();
+
+  // Numbered in the order of the list.
+  assertEqual(1, polledA.getTraceId());
+  assertEqual(2, polledB.getTraceId());
+
+  // Each dispatch is recorded before the status transitions of the coroutine,
+  // with the time of the dispatch.
+  PolledClock::setMicros(100);
+  PolledScheduler::runAll();
+  assertEqual("D1Y1D2Y2", eventsOf(traceRing));
+  assertEqual((uint32_t) 100, traceRing.getEvent(0).cycles);
+
+  traceRing.clear();
+  PolledClock::setMicros(200);
+  PolledScheduler::runAll();
+  assertEqual("D1R1L1D2R2L2", eventsOf(traceRing));
+
+  // The dispatches which do not change the status, because the delay has not
+  // expired, are not recorded.
+  traceRing.clear();
+  PolledClock::setMillis(5);
+  PolledScheduler::runAll();
+  assertEqual("", eventsOf(traceRing));
+
+  traceRing.clear();
+  PolledClock::setMillis(20);
+  PolledScheduler::runAll();
+  assertEqual("D1R1E1D2R2E2", eventsOf(traceRing));
+
+  // The scheduler terminates the ending coroutines without dispatching them.
+  traceRing.clear();
+  PolledScheduler::runAll();
+  assertEqual("T1T2", eventsOf(traceRing));
+
+  PolledScheduler::setTraceRing(nullptr);
+}
+
+test(TraceTest, printTraceTo) {
+  // Uses the names and trace ids of the polled test.
+  PolledScheduler::setTraceRing(&smallRing);
+  smallRing.clear();
+  smallRing.record(1, TraceEvent::kEventDispatch, 100);
+  smallRing.record(1, 1 /*kStatusYielding*/, 150);
+
+  PrintStr<100> printStr;
+  PolledScheduler::printTraceTo(printStr);
+  assertEqual(
+      "TRACE 1000000 0\r\n"
+      "NAME 1 a\r\n"
+      "NAME 2 b\r\n"
+      "100 1 16\r\n"
+      "150 1 1\r\n"
+      "END\r\n",
+      printStr.cstr());
+
+  PolledScheduler::setTraceRing(nullptr);
+}
+
+// ---------------------------------------------------------------------------
+
+class QueuedLooper : public QueuedCoroutine {
+  public:
+    int runCoroutine() override {
+      COROUTINE_LOOP() {
+        COROUTINE_YIELD();
+      }
+    }
+};
+
+QueuedLooper queuedLooper;
+
+test(TraceTest, queued) {
+  queuedLooper.setTraceId(7);
+  QueuedScheduler::setTraceRing(&traceRing);
+  QueuedScheduler::setup();
+  traceRing.clear();
+
+  // An explicit trace id is kept by setup().
+  assertEqual(7, queuedLooper.getTraceId());
+
+  QueuedScheduler::loop();
+  assertEqual("D7Y7", eventsOf(traceRing));
+
+  // The suspend() and resume() transitions are recorded too.
+  traceRing.clear();
+  queuedLooper.suspend();
+  QueuedScheduler::loop();
+  queuedLooper.resume();
+  assertEqual("S7Y7", eventsOf(traceRing));
+
+  traceRing.clear();
+  QueuedScheduler::loop();
+  assertEqual("D7R7Y7", eventsOf(traceRing));
+
+  // Nothing is recorded without a ring.
+  QueuedScheduler::setTraceRing(nullptr);
+  traceRing.clear();
+  QueuedScheduler::loop();
+  assertEqual(0, traceRing.getNumEvents());
+}
+
+//----------------------------------------------------------------------------
+
+void setup() {
+#if ! defined(EPOXY_DUINO)
+  delay(1000); // wait to prevent garbage on SERIAL_PORT_MONITOR
+#endif
+
+  SERIAL_PORT_MONITOR.begin(115200);
+  while (!SERIAL_PORT_MONITOR); // Leonardo/Micro
+}
+
+void loop() {
+  TestRunner::run();
+}
@@ -0,0 +1,145 @@
+#line 2 "UsageTest.ino"
+
+#include <AceRoutine.h>
+#include <AUnitVerbose.h>
+#include "ace_routine/testing/TestableClockInterface.h"
+
+using namespace aunit;
+using namespace ace_routine;
+using ace_routine::testing::TestableClockInterface;
+
+// Each test uses its own Coroutine type, hence its own scheduler.
+class PolledClock : public TestableClockInterface {};
+class QueuedClock : public TestableClockInterface {};
+
+using PolledCoroutine = CoroutineTemplate<Coroutine_Delay_16bit_Impl<
+    Coroutine_Usage_Impl<UnnamedCoroutine>, PolledClock>>;
+using PolledScheduler = CoroutineSchedulerTemplate<PolledCoroutine>;
+
+using QueuedCoroutine = CoroutineTemplate<Coroutine_Delay_32bit_Impl<
+    Coroutine_Usage_Impl<Coroutine_Queue_Impl<UnnamedCoroutine>>,
+    QueuedClock>>;
+using QueuedScheduler = CoroutineSchedulerTemplate<QueuedCoroutine>;
+
+// Advances the clock by 'busyMicros' on each run, then delays for 10 ms.
+template <typename T_COROUTINE, typename T_CLOCK>
+class Worker : public T_COROUTINE {
+  public:
+    Worker(unsigned long busyMicros) : mBusyMicros(busyMicros) {}
+
+    int runCoroutine() override {
+      COROUTINE_LOOP() {
+        T_CLOCK::setMicros(T_CLOCK::micros() + mBusyMicros);
+        COROUTINE_DELAY(10);
+      }
+    }
+
+  private:
+    unsigned long mBusyMicros;
+};
+
+// ---------------------------------------------------------------------------
+
+Worker<PolledCoroutine, PolledClock> polledB(10);
+Worker<PolledCoroutine, PolledClock> polledA(30);
+
+test(UsageTest, polled) {
+  PolledClock::setMillis(0);
+  PolledClock::setMicros(1000);
+  PolledScheduler::setup();
+  PolledScheduler::clearUsage();
+
+  PolledScheduler::runAll();
+
+  // The delays have not expired, so these dispatches are idle passes.
+  PolledClock::setMillis(5);
+  PolledScheduler::runAll();
+
+  PolledClock::setMillis(10);
+  PolledScheduler::runAll();
+
+  CoroutineUsage usageA = polledA.getUsage();
+  assertEqual((uint32_t) 3, usageA.dispatches);
+  assertEqual((uint32_t) 1, usageA.idlePasses);
+  assertEqual((unsigned long) 60, usageA.busyCycles);
+
+  CoroutineUsage usageB = polledB.getUsage();
+  assertEqual((uint32_t) 3, usageB.dispatches);
+  assertEqual((uint32_t) 1, usageB.idlePasses);
+  assertEqual((unsigned long) 20, usageB.busyCycles);
+
+  SchedulerUsage usage;
+  PolledScheduler::getUsage(usage);
+  assertEqual((uint32_t) 3, usage.loops);
+  assertEqual((uint32_t) 6, usage.dispatches);
+  assertEqual((uint32_t) 2, usage.idlePasses);
+  assertEqual((unsigned long) 80, usage.busyCycles);
+  assertEqual((unsigned long) 80, usage.loopCycles);
+  assertEqual((unsigned long) 0, usage.sleepCycles);
+  assertEqual((unsigned long) 0, usage.getOverheadCycles());
+
+  PolledScheduler::clearUsage();
+  assertEqual((uint32_t) 0, polledA.getUsage().dispatches);
+  assertEqual((unsigned long) 0, polledA.getUsage().busyCycles);
+  PolledScheduler::getUsage(usage);
+  assertEqual((uint32_t) 0, usage.loops);
+  assertEqual((unsigned long) 0, usage.loopCycles);
+}
+
+// ---------------------------------------------------------------------------
+
+Worker<QueuedCoroutine, QueuedClock> queuedWorker(20);
+
+// Sleeps until the wake time.
+void sleepUntil(uint32_t wakeMicros) {
+  QueuedClock::setMicros(wakeMicros);
+}
+
+test(UsageTest, queued) {
+  QueuedClock::setMillis(0);
+  QueuedClock::setMicros(0);
+  QueuedScheduler::setup();
+  QueuedScheduler::setIdleHook(sleepUntil);
+  QueuedScheduler::clearUsage();
+
+  // Runs for 20 micros, then delays until 10020.
+  QueuedScheduler::loop();
+
+  // Nothing is ready, so the idle hook sleeps for 10000 micros.
+  QueuedScheduler::loop();
+
+  QueuedClock::setMillis(10);
+  QueuedScheduler::loop();
+
+  // The sleeping coroutine is not dispatched, so there are no idle passes.
+  CoroutineUsage workerUsage = queuedWorker.getUsage();
+  assertEqual((uint32_t) 2, workerUsage.dispatches);
+  assertEqual((uint32_t) 0, workerUsage.idlePasses);
+  assertEqual((unsigned long) 40, workerUsage.busyCycles);
+
+  SchedulerUsage usage;
+  QueuedScheduler::getUsage(usage);
+  assertEqual((uint32_t) 3, usage.loops);
+  assertEqual((uint32_t) 2, usage.dispatches);
+  assertEqual((unsigned long) 40, usage.busyCycles);
+  assertEqual((unsigned long) 10000, usage.sleepCycles);
+  assertEqual((unsigned long) 10040, usage.loopCycles);
+  assertEqual((unsigned long) 0, usage.getOverheadCycles());
+
+  QueuedScheduler::setIdleHook(nullptr);
+}
+
+//----------------------------------------------------------------------------
+
+void setup() {
+#if ! defined(EPOXY_DUINO)
+  delay(1000); // wait to prevent garbage on SERIAL_PORT_MONITOR
+#endif
+
+  SERIAL_PORT_MONITOR.begin(115200);
+  while (!SERIAL_PORT_MONITOR); // Leonardo/Micro
+}
+
+void loop() {
+  TestRunner::run();
+}
@@ -0,0 +1,240 @@
+#line 2 "WakeRingTest.ino"
+
+#include <AceRoutine.h>
+#include <AUnitVerbose.h>
+#include "ace_routine/testing/TestableClockInterface.h"
+
+using namespace aunit;
+using namespace ace_routine;
+using ace_routine::testing::TestableClockInterface;
+
+using QueuedCoroutine = CoroutineTemplate<Coroutine_Delay_32bit_Impl<
+    Coroutine_Queue_Impl<UnnamedCoroutine>, TestableClockInterface>>;
+using QueuedScheduler = CoroutineSchedulerTemplate<QueuedCoroutine>;
+
+using PolledCoroutine = CoroutineTemplate<Coroutine_Delay_32bit_Impl<
+    UnnamedCoroutine, TestableClockInterface>>;
+using PolledScheduler = CoroutineSchedulerTemplate<PolledCoroutine>;
+
+// ---------------------------------------------------------------------------
+
+test(WakeRingTest, postAndPop) {
+  WakeRing<QueuedCoroutine, 4> ring;
+  QueuedCoroutine* a = reinterpret_cast<QueuedCoroutine*>(0x10);
+  QueuedCoroutine* b = reinterpret_cast<QueuedCoroutine*>(0x20);
+
+  assertTrue(ring.isEmpty());
+  assertTrue(ring.pop() == nullptr);
+
+  assertTrue(ring.post(a));
+  assertTrue(ring.post(b));
+  assertTrue(ring.post(a));
+  assertTrue(ring.post(b));
+  assertFalse(ring.post(a)); // full
+  assertEqual(1, ring.getOverflows());
+
+  assertTrue(ring.pop() == a);
+  assertTrue(ring.pop() == b);
+  assertTrue(ring.pop() == a);
+  assertTrue(ring.pop() == b);
+  assertTrue(ring.pop() == nullptr);
+  assertTrue(ring.isEmpty());
+
+  ring.clearOverflows();
+  assertEqual(0, ring.getOverflows());
+}
+
+test(WakeRingTest, indexRollover) {
+  WakeRing<QueuedCoroutine, 2> ring;
+  QueuedCoroutine* a = reinterpret_cast<QueuedCoroutine*>(0x10);
+  QueuedCoroutine* b = reinterpret_cast<QueuedCoroutine*>(0x20);
+
+  // Cross the rollover of the 8-bit indexes several times.
+  for (int i = 0; i < 1000; i++) {
+    assertTrue(ring.post(a));
+    assertTrue(ring.post(b));
+    assertFalse(ring.post(a));
+    assertTrue(ring.pop() == a);
+    assertTrue(ring.pop() == b);
+    assertTrue(ring.pop() == nullptr);
+  }
+  assertEqual(255, ring.getOverflows()); // saturated
+}
+
+// ---------------------------------------------------------------------------
+
+EventTemplate<QueuedCoroutine> neverNotified;
+WakeRing<QueuedCoroutine, 4> queuedRing;
+WakeRing<QueuedCoroutine, 2> secondRing;
+
+// Waits for the interrupt, which is never notified other than by the ring.
+class Handler : public QueuedCoroutine {
+  public:
+    int runCoroutine() override {
+      mRuns++;
+      COROUTINE_LOOP() {
+        COROUTINE_AWAIT_EVENT(neverNotified);
+        mWakes++;
+      }
+    }
+
+    uint16_t mRuns = 0;
+    uint16_t mWakes = 0;
+};
+
+class Yielder : public QueuedCoroutine {
+  public:
+    int runCoroutine() override {
+      mRuns++;
+      COROUTINE_LOOP() {
+        COROUTINE_YIELD();
+      }
+    }
+
+    uint16_t mRuns = 0;
+};
+
+class Sleeper : public QueuedCoroutine {
+  public:
+    int runCoroutine() override {
+      mRuns++;
+      COROUTINE_LOOP() {
+        COROUTINE_DELAY(1000);
+        mWakes++;
+      }
+    }
+
+    uint16_t mRuns = 0;
+    uint16_t mWakes = 0;
+};
+
+Handler handler;
+Yielder yielderA;
+Yielder yielderB;
+Sleeper sleeper;
+
+test(WakeRingTest, queuedPostRunsNext) {
+  for (int i = 0; i < 10; i++) QueuedScheduler::loop();
+  assertTrue(handler.isWaiting());
+  uint16_t runs = handler.mRuns;
+  uint16_t wakes = handler.mWakes;
+
+  // The next loop() runs the posted coroutine, ahead of the yielders.
+  queuedRing.post(&handler);
+  QueuedScheduler::loop();
+  assertEqual(runs + 1, handler.mRuns);
+  assertEqual(wakes + 1, handler.mWakes);
+  assertTrue(handler.isWaiting());
+
+  for (int i = 0; i < 10; i++) QueuedScheduler::loop();
+  assertEqual(runs + 1, handler.mRuns);
+}
+
+test(WakeRingTest, queuedSecondRingIsDrained) {
+  for (int i = 0; i < 10; i++) QueuedScheduler::loop();
+  assertTrue(handler.isWaiting());
+  uint16_t wakes = handler.mWakes;
+
+  // A post into the second ring is not lost, and neither is one posted into
+  // each ring before the same loop().
+  secondRing.post(&handler);
+  QueuedScheduler::loop();
+  assertEqual(wakes + 1, handler.mWakes);
+
+  uint16_t sleeperRuns = sleeper.mRuns;
+  queuedRing.post(&handler);
+  secondRing.post(&sleeper);
+  QueuedScheduler::loop();
+  QueuedScheduler::loop();
+  assertEqual(wakes + 2, handler.mWakes);
+  assertEqual(sleeperRuns + 1, sleeper.mRuns);
+  assertTrue(secondRing.isEmpty());
+}
+
+test(WakeRingTest, queuedSleeperGoesBackToSleep) {
+  for (int i = 0; i < 10; i++) QueuedScheduler::loop();
+  assertTrue(sleeper.isDelaying());
+  uint16_t runs = sleeper.mRuns;
+  uint16_t wakes = sleeper.mWakes;
+
+  // Woken up early, it finds that its delay has not expired.
+  queuedRing.post(&sleeper);
+  QueuedScheduler::loop();
+  assertEqual(runs + 1, sleeper.mRuns);
+  assertEqual(wakes, sleeper.mWakes);
+  assertTrue(sleeper.isDelaying());
+
+  for (int i = 0; i < 10; i++) QueuedScheduler::loop();
+  assertEqual(runs + 1, sleeper.mRuns);
+}
+
+test(WakeRingTest, queuedSuspendedIsNotWoken) {
+  for (int i = 0; i < 10; i++) QueuedScheduler::loop();
+  uint16_t runs = handler.mRuns;
+
+  handler.suspend();
+  queuedRing.post(&handler);
+  for (int i = 0; i < 10; i++) QueuedScheduler::loop();
+  assertEqual(runs, handler.mRuns);
+  assertTrue(handler.isSuspended());
+
+  handler.resume();
+  for (int i = 0; i < 10; i++) QueuedScheduler::loop();
+  assertEqual(runs + 1, handler.mRuns);
+}
+
+// ---------------------------------------------------------------------------
+
+WakeRing<PolledCoroutine, 4> polledRing;
+
+class PolledSleeper : public PolledCoroutine {
+  public:
+    int runCoroutine() override {
+      mRuns++;
+      COROUTINE_LOOP() {
+        COROUTINE_DELAY(1000);
+      }
+    }
+
+    uint16_t mRuns = 0;
+};
+
+PolledSleeper polledA;
+PolledSleeper polledB;
+
+test(WakeRingTest, polledPostRunsImmediately) {
+  // Each loop() runs one coroutine of the round-robin.
+  PolledScheduler::loop();
+  PolledScheduler::loop();
+  uint16_t runsA = polledA.mRuns;
+  uint16_t runsB = polledB.mRuns;
+
+  // The posted coroutine runs in addition to the next one in the round-robin.
+  polledRing.post(&polledA);
+  PolledScheduler::loop();
+  assertEqual(runsA + 1 + runsB + 1, polledA.mRuns + polledB.mRuns);
+  assertTrue(polledA.mRuns > runsA);
+}
+
+// ---------------------------------------------------------------------------
+
+void setup() {
+#if defined(ARDUINO)
+  delay(1000); // some boards reboot twice
+#endif
+
+  Serial.begin(115200);
+  while (!Serial); // Leonardo/Micro
+
+  TestableClockInterface::setMicros(0);
+  QueuedScheduler::addWakeRing(&queuedRing);
+  QueuedScheduler::addWakeRing(&secondRing);
+  QueuedScheduler::addWakeRing(&queuedRing); // no effect
+  QueuedScheduler::setup();
+  PolledScheduler::addWakeRing(&polledRing);
+  PolledScheduler::setup();
+}
+
+void loop() {
+  TestRunner::run();
+}